@@ -0,0 +1,306 @@
+#include <bts/blockchain/account_operations.hpp>
+#include <bts/blockchain/address_filter.hpp>
+#include <bts/blockchain/balance_operations.hpp>
+#include <bts/blockchain/chain_interface.hpp>
+#include <bts/blockchain/feed_operations.hpp>
+#include <bts/blockchain/market_operations.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+
+namespace bts { namespace blockchain {
+
+   namespace detail
+   {
+      /** maps an element to [0, range) using a hash keyed by the block id */
+      uint64_t hash_element( const block_id_type& block_id, const string& element, uint64_t range )
+      {
+         fc::sha256::encoder enc;
+         fc::raw::pack( enc, block_id );
+         enc.write( element.data(), element.size() );
+         const fc::sha256 digest = enc.result();
+         uint64_t value = 0;
+         memcpy( &value, digest.data(), sizeof( value ) );
+         return value % range;
+      }
+
+      class bit_writer
+      {
+         public:
+            bit_writer( vector<char>& out ):_out( out ){}
+
+            void write_bit( bool bit )
+            {
+               if( _bit_position == 0 ) _out.push_back( 0 );
+               if( bit ) _out.back() |= char( 1 << ( 7 - _bit_position ) );
+               _bit_position = ( _bit_position + 1 ) % 8;
+            }
+
+            void write_bits( uint64_t value, uint8_t count )
+            {
+               while( count > 0 )
+                  write_bit( ( value >> --count ) & 1 );
+            }
+
+         private:
+            vector<char>& _out;
+            uint8_t       _bit_position = 0;
+      };
+
+      class bit_reader
+      {
+         public:
+            bit_reader( const vector<char>& in ):_in( in ){}
+
+            bool read_bit()
+            {
+               FC_ASSERT( _byte < _in.size(), "address filter is truncated" );
+               const bool bit = ( uint8_t( _in[ _byte ] ) >> ( 7 - _bit_position ) ) & 1;
+               if( ++_bit_position == 8 ) { _bit_position = 0; ++_byte; }
+               return bit;
+            }
+
+            uint64_t read_bits( uint8_t count )
+            {
+               uint64_t value = 0;
+               while( count-- > 0 )
+                  value = ( value << 1 ) | uint64_t( read_bit() );
+               return value;
+            }
+
+         private:
+            const vector<char>& _in;
+            size_t              _byte = 0;
+            uint8_t             _bit_position = 0;
+      };
+   }
+
+   string address_filter::address_element( const address& owner )
+   {
+      const auto packed = fc::raw::pack( owner );
+      return "a" + string( packed.begin(), packed.end() );
+   }
+
+   string address_filter::account_element( const account_id_type& account_id )
+   {
+      const auto packed = fc::raw::pack( account_id );
+      return "i" + string( packed.begin(), packed.end() );
+   }
+
+   bool address_filter::matches_any( const block_id_type& block_id, const vector<string>& elements )const
+   { try {
+      if( element_count == 0 || elements.empty() )
+         return false;
+
+      const uint64_t range = uint64_t( element_count ) * inverse_false_positive_rate;
+      vector<uint64_t> queries;
+      queries.reserve( elements.size() );
+      for( const string& element : elements )
+         queries.push_back( detail::hash_element( block_id, element, range ) );
+      std::sort( queries.begin(), queries.end() );
+
+      // both sides are sorted, so a single merge pass over the decoded set answers every query
+      detail::bit_reader reader( data );
+      auto query_itr = queries.begin();
+      uint64_t value = 0;
+      for( uint32_t i = 0; i < element_count; ++i )
+      {
+         uint64_t quotient = 0;
+         while( reader.read_bit() ) ++quotient;
+         value += ( quotient << golomb_rice_bits ) | reader.read_bits( golomb_rice_bits );
+
+         while( query_itr != queries.end() && *query_itr < value ) ++query_itr;
+         if( query_itr == queries.end() ) return false;
+         if( *query_itr == value ) return true;
+      }
+      return false;
+   } FC_CAPTURE_AND_RETHROW( (block_id)(element_count) ) }
+
+   void address_filter_builder::add_address( const address& owner )
+   {
+      _elements.insert( address_filter::address_element( owner ) );
+   }
+
+   void address_filter_builder::add_account( const account_id_type& account_id )
+   {
+      _elements.insert( address_filter::account_element( account_id ) );
+   }
+
+   void address_filter_builder::add_condition( const withdraw_condition& condition )
+   {
+      switch( withdraw_condition_types( condition.type ) )
+      {
+         case withdraw_signature_type:
+         {
+            const auto signature_condition = condition.as<withdraw_with_signature>();
+            add_address( signature_condition.owner );
+            if( signature_condition.memo.valid() )
+               _has_unfiltered_deposits = true;
+            break;
+         }
+         case withdraw_multi_sig_type:
+         {
+            const auto multi_sig_condition = condition.as<withdraw_with_multi_sig>();
+            for( const address& owner : multi_sig_condition.owners )
+               add_address( owner );
+            if( multi_sig_condition.memo.valid() )
+               _has_unfiltered_deposits = true;
+            break;
+         }
+         case withdraw_escrow_type:
+         {
+            const auto escrow_condition = condition.as<withdraw_with_escrow>();
+            add_address( escrow_condition.sender );
+            add_address( escrow_condition.receiver );
+            add_address( escrow_condition.escrow );
+            if( escrow_condition.memo.valid() )
+               _has_unfiltered_deposits = true;
+            break;
+         }
+         case withdraw_password_type:
+         {
+            const auto password_condition = condition.as<withdraw_with_password>();
+            add_address( password_condition.payee );
+            add_address( password_condition.payor );
+            if( password_condition.memo.valid() )
+               _has_unfiltered_deposits = true;
+            break;
+         }
+         default:
+            _has_unfiltered_deposits = true;
+            break;
+      }
+   }
+
+   void address_filter_builder::add_transaction( const signed_transaction& trx, const chain_interface& state )
+   {
+      for( const operation& op : trx.operations )
+      {
+         switch( operation_type_enum( op.type ) )
+         {
+            case deposit_op_type:
+               add_condition( op.as<deposit_operation>().condition );
+               break;
+            case withdraw_op_type:
+            case withdraw_all_op_type:
+            {
+               const balance_id_type balance_id = operation_type_enum( op.type ) == withdraw_op_type
+                                                ? op.as<withdraw_operation>().balance_id
+                                                : op.as<withdraw_all_operation>().balance_id;
+               add_address( balance_id );
+               const obalance_record balance = state.get_balance_record( balance_id );
+               if( balance.valid() )
+                  add_condition( balance->condition );
+               break;
+            }
+            case release_escrow_op_type:
+            {
+               const auto release_op = op.as<release_escrow_operation>();
+               add_address( release_op.escrow_id );
+               add_address( release_op.released_by );
+               const obalance_record escrow_balance = state.get_balance_record( release_op.escrow_id );
+               if( escrow_balance.valid() )
+                  add_condition( escrow_balance->condition );
+               break;
+            }
+            case register_account_op_type:
+            {
+               const auto register_op = op.as<register_account_operation>();
+               add_address( address( register_op.owner_key ) );
+               add_address( address( register_op.active_key ) );
+               break;
+            }
+            case update_account_op_type:
+            {
+               const auto update_op = op.as<update_account_operation>();
+               add_account( update_op.account_id );
+               if( update_op.active_key.valid() )
+                  add_address( address( *update_op.active_key ) );
+               break;
+            }
+            case withdraw_pay_op_type:
+               add_account( op.as<withdraw_pay_operation>().account_id );
+               break;
+            case link_account_op_type:
+            {
+               const auto link_op = op.as<link_account_operation>();
+               add_account( link_op.source_account );
+               add_account( link_op.destination_account );
+               break;
+            }
+            case burn_op_type:
+               add_account( op.as<burn_operation>().account_id );
+               break;
+            case update_feed_op_type:
+               add_account( op.as<update_feed_operation>().feed.delegate_id );
+               break;
+            case bid_op_type:
+               add_address( op.as<bid_operation>().bid_index.owner );
+               break;
+            case ask_op_type:
+               add_address( op.as<ask_operation>().ask_index.owner );
+               break;
+            case short_op_v2_type:
+               add_address( op.as<short_operation>().short_index.owner );
+               break;
+            case cover_op_type:
+               add_address( op.as<cover_operation>().cover_index.owner );
+               break;
+            case add_collateral_op_type:
+               add_address( op.as<add_collateral_operation>().cover_index.owner );
+               break;
+            case remove_collateral_op_type:
+               add_address( op.as<remove_collateral_operation>().owner );
+               break;
+            case create_asset_op_type:
+               add_account( op.as<create_asset_operation>().issuer_account_id );
+               break;
+            case update_asset_op_type:
+               add_account( op.as<update_asset_operation>().issuer_account_id );
+               break;
+            default:
+               // claims and anything else without an indexed owner
+               _has_unfiltered_deposits = true;
+               break;
+         }
+      }
+   }
+
+   void address_filter_builder::add_market_transaction( const market_transaction& trx )
+   {
+      add_address( trx.bid_owner );
+      add_address( trx.ask_owner );
+   }
+
+   address_filter address_filter_builder::build( const block_id_type& block_id )const
+   { try {
+      address_filter filter;
+      filter.has_unfiltered_deposits = _has_unfiltered_deposits;
+      filter.element_count = uint32_t( _elements.size() );
+      if( filter.element_count == 0 )
+         return filter;
+
+      const uint64_t range = uint64_t( filter.element_count ) * address_filter::inverse_false_positive_rate;
+      vector<uint64_t> values;
+      values.reserve( _elements.size() );
+      for( const string& element : _elements )
+         values.push_back( detail::hash_element( block_id, element, range ) );
+      std::sort( values.begin(), values.end() );
+
+      detail::bit_writer writer( filter.data );
+      uint64_t previous = 0;
+      for( const uint64_t value : values )
+      {
+         const uint64_t delta = value - previous;
+         previous = value;
+         for( uint64_t quotient = delta >> address_filter::golomb_rice_bits; quotient > 0; --quotient )
+            writer.write_bit( true );
+         writer.write_bit( false );
+         writer.write_bits( delta, address_filter::golomb_rice_bits );
+      }
+      return filter;
+   } FC_CAPTURE_AND_RETHROW( (block_id) ) }
+
+} } // bts::blockchain
@@ -1,20 +1,19 @@
 #include <bts/blockchain/block.hpp>
+#include <bts/db/pack_buffer.hpp>
 #include <algorithm>
 
 namespace bts { namespace blockchain {
 
    digest_type block_header::digest()const
    {
-      fc::sha256::encoder enc;
-      fc::raw::pack( enc, *this );
-      return enc.result();
+      const bts::db::pack_buffer buffer( *this );
+      return fc::sha256::hash( buffer.data(), (uint32_t)buffer.size() );
    }
 
    block_id_type signed_block_header::id()const
    {
-      fc::sha512::encoder enc;
-      fc::raw::pack( enc, *this );
-      return fc::ripemd160::hash( enc.result() );
+      const bts::db::pack_buffer buffer( *this );
+      return fc::ripemd160::hash( fc::sha512::hash( buffer.data(), (uint32_t)buffer.size() ) );
    }
 
    bool signed_block_header::validate_signee( const fc::ecc::public_key& expected_signee )const
@@ -41,9 +40,8 @@ namespace bts { namespace blockchain {
 
    digest_type digest_block::calculate_transaction_digest()const
    {
-      fc::sha512::encoder enc;
-      fc::raw::pack( enc, user_transaction_ids );
-      return fc::sha256::hash( enc.result() );
+      const bts::db::pack_buffer buffer( user_transaction_ids );
+      return fc::sha256::hash( fc::sha512::hash( buffer.data(), (uint32_t)buffer.size() ) );
    }
 
    full_block::operator digest_block()const
@@ -42,6 +42,8 @@ namespace bts { namespace blockchain {
       void chain_database_impl::revalidate_pending()
       {
             _pending_fee_index.clear();
+            clear_pending_pool();
+            _pending_pool_dirty = false;
 
             vector<transaction_id_type> trx_to_discard;
 
@@ -58,6 +60,7 @@ namespace bts { namespace blockchain {
                   transaction_evaluation_state_ptr eval_state = self->evaluate_transaction( trx, _relay_fee );
                   share_type fees = eval_state->get_fees();
                   _pending_fee_index[ fee_index( fees, trx_id ) ] = eval_state;
+                  add_to_pending_pool( trx_id, make_pending_pool_entry( trx, fees ) );
                   wlog("revalidated pending transaction id ${id}", ("id", trx_id));
                 }
                 catch ( const fc::canceled_exception& )
@@ -76,11 +79,307 @@ namespace bts { namespace blockchain {
 
             for( const auto& item : trx_to_discard )
                 _pending_transaction_db.remove( item );
+
+            // only a lowered cap can leave the rebuilt pool over it; the next intake schedules another rebuild
+            if( evict_pending_overflow( optional<transaction_id_type>() ) > 0 )
+                _pending_pool_dirty = true;
+
             wlog("revalidate_pending complete, there are now ${pending_count} evaluated transactions, ${num_pending_transaction_considered} raw transactions",
                  ("pending_count", _pending_fee_index.size())
                  ("num_pending_transaction_considered", num_pending_transaction_considered));
       }
 
+      /** extending the chain at block_num drops anything the index still held past it */
+      void chain_database_impl::store_main_chain_block_id( uint32_t block_num, const block_id_type& block_id )
+      {
+         FC_ASSERT( block_num > 0 && block_num <= _main_chain_block_ids.size() + 1,
+                    "gap in the main chain block index", ("block_num",block_num)("size",_main_chain_block_ids.size()) );
+         _main_chain_block_ids.resize( block_num - 1 );
+         _main_chain_block_ids.push_back( block_id );
+      }
+
+      /** records the producer in the block record and indexes the block under it */
+      void chain_database_impl::index_block_signee( const block_id_type& block_id, const account_id_type& signee_id )
+      {
+         block_record record = _block_id_to_block_record_db.fetch( block_id );
+         if( record.signee_id != signee_id )
+         {
+            record.signee_id = signee_id;
+            _block_id_to_block_record_db.store( block_id, record );
+         }
+         _delegate_block_index_db.store( std::make_pair( signee_id, record.block_num ), block_id );
+      }
+
+      /** a genesis balance stays unclaimed until the first withdraw or deposit moves its last_update past genesis */
+      void chain_database_impl::index_unclaimed_genesis_balance( const balance_record& record )
+      {
+         if( !record.genesis_info.valid() )
+            return;
+
+         const balance_id_type balance_id = record.id();
+         const auto previous_amount = _unclaimed_genesis_balance_db.fetch_optional( balance_id );
+         if( previous_amount.valid() )
+         {
+            _unclaimed_genesis_total -= *previous_amount;
+            _unclaimed_genesis_balance_db.remove( balance_id );
+         }
+
+         // the genesis timestamp comes from the base asset, which isn't registered yet while the genesis balances are stored
+         if( self->get_asset_record( asset_id_type() ).valid() && record.last_update > self->get_genesis_timestamp() )
+            return;
+
+         const share_type amount = record.get_balance().amount;
+         _unclaimed_genesis_balance_db.store( balance_id, amount );
+         _unclaimed_genesis_total += amount;
+      }
+
+      /** folds in the produced and missed slots written by update_delegate_production_info, once the block is applied */
+      void chain_database_impl::record_block_slots( const pending_chain_state_ptr& pending_state )
+      {
+         for( const auto& item : pending_state->slots )
+            if( !item.second.is_null() )
+               record_delegate_slot( item.second );
+      }
+
+      void chain_database_impl::record_delegate_slot( const slot_record& slot )
+      {
+         delegate_production_tracker& tracker = _delegate_production[ slot.block_producer_id ];
+         tracker.produced_in_window.resize( _delegate_reliability_windows.size() );
+
+         delegate_production_tracker::slot_outcome outcome;
+         outcome.slot_time = slot.start_time;
+         outcome.produced = slot.block_id.valid();
+         if( outcome.produced )
+         {
+            const oblock_record record = self->get_block_record( *slot.block_id );
+            if( record.valid() )
+               outcome.latency = record->latency;
+            tracker.total_latency_us += outcome.latency.count();
+            ++tracker.latency_samples;
+            tracker.missed_in_a_row = 0;
+         }
+         else
+         {
+            ++tracker.missed_in_a_row;
+         }
+
+         tracker.recent_slots.push_back( outcome );
+         const size_t slot_count = tracker.recent_slots.size();
+         for( size_t i = 0; i < _delegate_reliability_windows.size(); ++i )
+         {
+            const uint32_t window = _delegate_reliability_windows[ i ];
+            if( slot_count > window && tracker.recent_slots[ slot_count - 1 - window ].produced )
+               --tracker.produced_in_window[ i ];
+            if( outcome.produced )
+               ++tracker.produced_in_window[ i ];
+         }
+
+         // the windows are sorted, so anything older than the last one has left all of them
+         while( tracker.recent_slots.size() > _delegate_reliability_windows.back() )
+         {
+            const auto& oldest = tracker.recent_slots.front();
+            if( oldest.produced )
+            {
+               tracker.total_latency_us -= oldest.latency.count();
+               --tracker.latency_samples;
+            }
+            tracker.recent_slots.pop_front();
+         }
+
+         rank_delegate_reliability( slot.block_producer_id, tracker );
+      }
+
+      /** removes the slots after head_time, which belonged to blocks that were just popped */
+      void chain_database_impl::unwind_delegate_production( const time_point_sec& head_time )
+      {
+         for( auto& item : _delegate_production )
+         {
+            delegate_production_tracker& tracker = item.second;
+            if( tracker.recent_slots.empty() || tracker.recent_slots.back().slot_time <= head_time )
+               continue;
+
+            while( !tracker.recent_slots.empty() && tracker.recent_slots.back().slot_time > head_time )
+            {
+               const delegate_production_tracker::slot_outcome removed = tracker.recent_slots.back();
+               tracker.recent_slots.pop_back();
+               if( removed.produced )
+               {
+                  tracker.total_latency_us -= removed.latency.count();
+                  --tracker.latency_samples;
+               }
+
+               const size_t slot_count = tracker.recent_slots.size();
+               for( size_t i = 0; i < _delegate_reliability_windows.size(); ++i )
+               {
+                  const uint32_t window = _delegate_reliability_windows[ i ];
+                  if( removed.produced )
+                     --tracker.produced_in_window[ i ];
+                  if( slot_count >= window && tracker.recent_slots[ slot_count - window ].produced )
+                     ++tracker.produced_in_window[ i ];
+               }
+            }
+
+            tracker.missed_in_a_row = 0;
+            for( auto itr = tracker.recent_slots.rbegin(); itr != tracker.recent_slots.rend() && !itr->produced; ++itr )
+               ++tracker.missed_in_a_row;
+
+            rank_delegate_reliability( item.first, tracker );
+         }
+      }
+
+      void chain_database_impl::rebuild_delegate_production()
+      {
+         _delegate_production.clear();
+         _delegate_reliability_index.clear();
+         _delegate_reliability_index.resize( _delegate_reliability_windows.size() );
+         if( _head_block_header.block_num == 0 )
+            return;
+
+         // each active delegate is scheduled once per round
+         const uint32_t head_time = _head_block_header.timestamp.sec_since_epoch();
+         const uint32_t history_sec = _delegate_reliability_windows.back() * BTS_BLOCKCHAIN_NUM_DELEGATES
+                                      * uint32_t( BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC );
+         const time_point_sec start_time( head_time > history_sec ? head_time - history_sec : 0 );
+         for( auto itr = _slot_record_db.lower_bound( start_time ); itr.valid() && itr.key() <= _head_block_header.timestamp; ++itr )
+            record_delegate_slot( itr.value() );
+      }
+
+      void chain_database_impl::rank_delegate_reliability( const account_id_type& delegate_id,
+                                                           delegate_production_tracker& tracker )
+      {
+         tracker.reliability_key.resize( _delegate_reliability_windows.size() );
+         _delegate_reliability_index.resize( _delegate_reliability_windows.size() );
+         for( size_t i = 0; i < _delegate_reliability_windows.size(); ++i )
+         {
+            auto& index = _delegate_reliability_index[ i ];
+            index.erase( std::make_pair( tracker.reliability_key[ i ], delegate_id ) );
+
+            const uint32_t observed = std::min<uint32_t>( _delegate_reliability_windows[ i ], tracker.recent_slots.size() );
+            if( observed == 0 )
+               continue;
+            tracker.reliability_key[ i ] = (tracker.produced_in_window[ i ] * 10000) / observed;
+            index.emplace( tracker.reliability_key[ i ], delegate_id );
+         }
+      }
+
+      void chain_database_impl::schedule_revalidate_pending()
+      {
+         if( !_revalidate_pending.valid() || _revalidate_pending.ready() )
+           _revalidate_pending = fc::async( [=](){ revalidate_pending(); }, "revalidate_pending" );
+      }
+
+      pending_pool_entry chain_database_impl::make_pending_pool_entry( const signed_transaction& trx, const share_type& fees )const
+      {
+         pending_pool_entry entry;
+         entry.size = uint32_t( fc::raw::pack_size( trx ) );
+         entry.fees = fees;
+         for( const operation& op : trx.operations )
+         {
+            switch( operation_type_enum( op.type ) )
+            {
+               case withdraw_op_type:
+                  entry.senders.push_back( op.as<withdraw_operation>().balance_id );
+                  break;
+               case withdraw_all_op_type:
+                  entry.senders.push_back( op.as<withdraw_all_operation>().balance_id );
+                  break;
+               default:
+                  break;
+            }
+         }
+         std::sort( entry.senders.begin(), entry.senders.end() );
+         entry.senders.erase( std::unique( entry.senders.begin(), entry.senders.end() ), entry.senders.end() );
+         return entry;
+      }
+
+      void chain_database_impl::add_to_pending_pool( const transaction_id_type& trx_id, const pending_pool_entry& entry )
+      {
+         if( !_pending_pool_entries.insert( std::make_pair( trx_id, entry ) ).second )
+            return;
+         _pending_pool_bytes += entry.size;
+         _pending_pool_by_fee_rate.insert( std::make_pair( entry.fee_per_kb(), trx_id ) );
+         for( const balance_id_type& sender : entry.senders )
+            ++_pending_pool_sender_counts[ sender ];
+      }
+
+      void chain_database_impl::remove_from_pending_pool( const transaction_id_type& trx_id )
+      {
+         const auto itr = _pending_pool_entries.find( trx_id );
+         if( itr == _pending_pool_entries.end() )
+            return;
+         const pending_pool_entry& entry = itr->second;
+         _pending_pool_bytes -= entry.size;
+         _pending_pool_by_fee_rate.erase( std::make_pair( entry.fee_per_kb(), trx_id ) );
+         for( const balance_id_type& sender : entry.senders )
+         {
+            auto count_itr = _pending_pool_sender_counts.find( sender );
+            if( count_itr != _pending_pool_sender_counts.end() && --count_itr->second == 0 )
+               _pending_pool_sender_counts.erase( count_itr );
+         }
+         _pending_pool_entries.erase( itr );
+      }
+
+      void chain_database_impl::clear_pending_pool()
+      {
+         _pending_pool_entries.clear();
+         _pending_pool_by_fee_rate.clear();
+         _pending_pool_sender_counts.clear();
+         _pending_pool_bytes = 0;
+      }
+
+      /**
+       *  The relay fee is flat until the pool is half full and then rises linearly to
+       *  BTS_BLOCKCHAIN_MAX_RELAY_FEE_MULTIPLIER times.  Once accepting the transaction would
+       *  push the pool over its cap, or while the pending state awaits a rebuild after an
+       *  eviction, it must also outbid the cheapest pending transaction per kilobyte, otherwise
+       *  it would just be evicted again.
+       */
+      share_type chain_database_impl::required_relay_fee( const pending_pool_entry& entry )const
+      {
+         if( _pending_pool_max_bytes == 0 )
+            return _relay_fee;
+
+         const uint64_t fill_permille = std::min<uint64_t>( 1000, (_pending_pool_bytes * 1000) / _pending_pool_max_bytes );
+         share_type required = _relay_fee;
+         if( fill_permille > 500 )
+            required += (_relay_fee * (BTS_BLOCKCHAIN_MAX_RELAY_FEE_MULTIPLIER - 1) * int64_t( fill_permille - 500 )) / 500;
+
+         if( (_pending_pool_dirty || _pending_pool_bytes + entry.size > _pending_pool_max_bytes) && !_pending_pool_by_fee_rate.empty() )
+         {
+            const int64_t lowest_fee_per_kb = _pending_pool_by_fee_rate.begin()->first;
+            required = std::max<share_type>( required, ((lowest_fee_per_kb + 1) * entry.size + 999) / 1000 );
+         }
+         return required;
+      }
+
+      /**
+       *  Drops the lowest fee per kilobyte until the pool fits under its cap again and returns
+       *  how many were dropped.  keep_id, when given, is never dropped.
+       */
+      uint32_t chain_database_impl::evict_pending_overflow( const optional<transaction_id_type>& keep_id )
+      {
+         if( _pending_pool_max_bytes == 0 )
+            return 0;
+
+         uint32_t evicted = 0;
+         auto itr = _pending_pool_by_fee_rate.begin();
+         while( _pending_pool_bytes > _pending_pool_max_bytes && itr != _pending_pool_by_fee_rate.end() )
+         {
+            const transaction_id_type trx_id = itr->second;
+            ++itr;
+            if( keep_id.valid() && *keep_id == trx_id )
+               continue;
+
+            const share_type fees = _pending_pool_entries[ trx_id ].fees;
+            _pending_fee_index.erase( fee_index( fees, trx_id ) );
+            _pending_transaction_db.remove( trx_id );
+            remove_from_pending_pool( trx_id );
+            ++evicted;
+            wlog( "evicted pending transaction ${id} to stay under the pending pool limit", ("id",trx_id) );
+         }
+         return evicted;
+      }
+
       void chain_database_impl::open_database( const fc::path& data_dir )
       { try {
           bool rebuild_index = false;
@@ -124,7 +423,18 @@ namespace bts { namespace blockchain {
 
           _block_id_to_block_record_db.open( data_dir / "index/block_id_to_block_record_db" );
           _block_num_to_id_db.open( data_dir / "raw_chain/block_num_to_id_db" );
+          _main_chain_block_ids.clear();
+          for( auto itr = _block_num_to_id_db.begin(); itr.valid(); ++itr )
+          {
+             if( itr.key() != _main_chain_block_ids.size() + 1 )
+             {
+                elog( "block number index has a gap at ${n}, rebuild the index to repair it", ("n",_main_chain_block_ids.size() + 1) );
+                break;
+             }
+             _main_chain_block_ids.push_back( itr.value() );
+          }
           _block_id_to_block_data_db.open( data_dir / "raw_chain/block_id_to_block_data_db" );
+          _address_filter_db.open( data_dir / "index/address_filter_db" );
           _id_to_transaction_record_db.open( data_dir / "index/id_to_transaction_record_db" );
 
           for( auto itr = _id_to_transaction_record_db.begin(); itr.valid(); ++itr )
@@ -134,6 +444,12 @@ namespace bts { namespace blockchain {
 
           _asset_db.open( data_dir / "index/asset_db" );
           _balance_db.open( data_dir / "index/balance_db" );
+          _owner_balance_index_db.open( data_dir / "index/owner_balance_index_db" );
+          _unclaimed_genesis_balance_db.open( data_dir / "index/unclaimed_genesis_balance_db" );
+          // only genesis balances nobody has claimed yet, so this shrinks as the chain grows
+          _unclaimed_genesis_total = 0;
+          for( auto itr = _unclaimed_genesis_balance_db.begin(); itr.valid(); ++itr )
+             _unclaimed_genesis_total += itr.value();
           _burn_db.open( data_dir / "index/burn_db" );
           _account_db.open( data_dir / "index/account_db" );
           _address_to_account_db.open( data_dir / "index/address_to_account_db" );
@@ -143,11 +459,13 @@ namespace bts { namespace blockchain {
           _delegate_vote_index_db.open( data_dir / "index/delegate_vote_index_db" );
 
           _slot_record_db.open( data_dir / "index/slot_record_db" );
+          _delegate_block_index_db.open( data_dir / "index/delegate_block_index_db" );
 
           _ask_db.open( data_dir / "index/ask_db" );
           _bid_db.open( data_dir / "index/bid_db" );
           _short_db.open( data_dir / "index/short_db" );
           _collateral_db.open( data_dir / "index/collateral_db" );
+          _collateral_expiration_index_db.open( data_dir / "index/collateral_expiration_index_db" );
           _feed_db.open( data_dir / "index/feed_db" );
 
           _market_status_db.open( data_dir / "index/market_status_db" );
@@ -491,6 +809,7 @@ namespace bts { namespace blockchain {
             auto id = trx.id();
             confirmed_trx_ids.insert( id );
             _pending_transaction_db.remove( id );
+            remove_from_pending_pool( id );
          }
 
          _pending_fee_index.clear();
@@ -504,9 +823,8 @@ namespace bts { namespace blockchain {
          uint32_t last_checkpoint_block_num = 0;
          if( !CHECKPOINT_BLOCKS.empty() )
              last_checkpoint_block_num = (--(CHECKPOINT_BLOCKS.end()))->first;
-         if( (!_revalidate_pending.valid() || _revalidate_pending.ready()) &&
-             _head_block_header.block_num >= last_checkpoint_block_num )
-           _revalidate_pending = fc::async( [=](){ revalidate_pending(); }, "revalidate_pending" );
+         if( _head_block_header.block_num >= last_checkpoint_block_num )
+           schedule_revalidate_pending();
 
          _pending_trx_state = std::make_shared<pending_chain_state>( self->shared_from_this() );
       }
@@ -705,7 +1023,8 @@ namespace bts { namespace blockchain {
       } FC_CAPTURE_AND_RETHROW( (block_id) ) }
 
       void chain_database_impl::apply_transactions( const full_block& block,
-                                                    const pending_chain_state_ptr& pending_state )
+                                                    const pending_chain_state_ptr& pending_state,
+                                                    address_filter_builder* filter_builder )
       {
          //ilog( "apply transactions from block: ${block_num}  ${trxs}", ("block_num",block.block_num)("trxs",user_transactions) );
          ilog( "Applying transactions from block: ${n}", ("n",block.block_num) );
@@ -716,6 +1035,10 @@ namespace bts { namespace blockchain {
             for( const auto& trx : block.user_transactions )
             {
                //ilog( "applying   ${trx}", ("trx",trx) );
+               // withdrawn balances are looked up before evaluation may remove them
+               if( filter_builder != nullptr )
+                  filter_builder->add_transaction( trx, *pending_state );
+
                transaction_evaluation_state_ptr trx_eval_state =
                       std::make_shared<transaction_evaluation_state>(pending_state.get(), _chain_id);
                trx_eval_state->evaluate( trx, _skip_signature_verification );
@@ -821,7 +1144,8 @@ namespace bts { namespace blockchain {
       } FC_RETHROW_EXCEPTIONS( warn, "", ("block_id",block_id) ) }
 
 
-      void chain_database_impl::verify_header( const full_block& block_data, const public_key_type& block_signee )
+      void chain_database_impl::verify_header( const full_block& block_data, const public_key_type& block_signee,
+                                               bool digest_verified )
       { try {
             // validate preliminaries:
             if( block_data.block_num > 1 && block_data.block_num != _head_block_header.block_num + 1 )
@@ -838,11 +1162,14 @@ namespace bts { namespace blockchain {
             if( block_data.timestamp >  (now + BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC*2) )
                 FC_CAPTURE_AND_THROW( time_in_future, (block_data.timestamp)(now)(delta_seconds) );
 
-            digest_block digest_data(block_data);
-            if( NOT digest_data.validate_digest() )
-              FC_CAPTURE_AND_THROW( invalid_block_digest );
+            if( !digest_verified )
+            {
+               digest_block digest_data(block_data);
+               if( NOT digest_data.validate_digest() )
+                 FC_CAPTURE_AND_THROW( invalid_block_digest );
 
-            FC_ASSERT( digest_data.validate_unique() );
+               FC_ASSERT( digest_data.validate_unique() );
+            }
 
             // signing delegate:
             auto expected_delegate = self->get_slot_signee( block_data.timestamp, self->get_active_delegates() );
@@ -868,13 +1195,16 @@ namespace bts { namespace blockchain {
        *
        *  Note that produced_block has already been verified by the caller and that updates are
        *  applied to pending_state.
+       *
+       *  Returns the id of the delegate that produced the block.
        */
-      void chain_database_impl::update_delegate_production_info( const full_block& produced_block,
-                                                                 const pending_chain_state_ptr& pending_state,
-                                                                 const public_key_type& block_signee )
+      account_id_type chain_database_impl::update_delegate_production_info( const full_block& produced_block,
+                                                                            const pending_chain_state_ptr& pending_state,
+                                                                            const public_key_type& block_signee )
       {
           /* Update production info for signing delegate */
           auto delegate_id = self->get_delegate_record_for_signee( block_signee ).id;
+          const account_id_type signee_id = delegate_id;
 
           auto delegate_record = pending_state->get_account_record( delegate_id );
           FC_ASSERT( delegate_record.valid() && delegate_record->is_delegate() );
@@ -931,6 +1261,7 @@ namespace bts { namespace blockchain {
              required_confirmations = 3*BTS_BLOCKCHAIN_NUM_DELEGATES;
 
           pending_state->set_property( confirmation_requirement, required_confirmations );
+          return signee_id;
       }
 
       void chain_database_impl::update_random_seed( const secret_hash_type& new_secret,
@@ -991,13 +1322,28 @@ namespace bts { namespace blockchain {
       void chain_database_impl::extend_chain( const full_block& block_data )
       { try {
          auto block_id = block_data.id();
+         try
+         {
+            if( reapply_cached_delta( block_id, block_data ) )
+               return;
+         }
+         catch ( const fc::exception& e )
+         {
+            wlog( "error reapplying block: ${e}", ("e",e.to_detail_string() ));
+            mark_invalid( block_id, e );
+            throw;
+         }
+
          block_summary summary;
          try
          {
             public_key_type block_signee;
+            optional<public_key_type> prevalidated_signee;
             if( CHECKPOINT_BLOCKS.size() > 0 && (--CHECKPOINT_BLOCKS.end())->first > block_data.block_num )
                //Skip signature validation
                block_signee = self->get_slot_signee( block_data.timestamp, self->get_active_delegates() ).active_key();
+            else if( (prevalidated_signee = take_prevalidated_signee( block_id )).valid() )
+               block_signee = *prevalidated_signee;
             else
                /* We need the block_signee's key in several places and computing it is expensive, so compute it here and pass it down */
                block_signee = block_data.signee();
@@ -1007,7 +1353,7 @@ namespace bts { namespace blockchain {
               FC_CAPTURE_AND_THROW( failed_checkpoint_verification, (block_id)(checkpoint_itr->second) );
 
             /* Note: Secret is validated later in update_delegate_production_info() */
-            verify_header( block_data, block_signee );
+            verify_header( block_data, block_signee, prevalidated_signee.valid() );
 
             summary.block_data = block_data;
 
@@ -1018,7 +1364,7 @@ namespace bts { namespace blockchain {
             /** Increment the blocks produced or missed for all delegates. This must be done
              *  before applying transactions because it depends upon the current active delegate order.
              **/
-            update_delegate_production_info( block_data, pending_state, block_signee );
+            const account_id_type signee_id = update_delegate_production_info( block_data, pending_state, block_signee );
 
             // apply any deterministic operations such as market operations before we perturb indexes
             //apply_deterministic_updates(pending_state);
@@ -1030,8 +1376,12 @@ namespace bts { namespace blockchain {
 
             execute_markets( block_data.timestamp, pending_state );
 
+            address_filter_builder filter_builder;
+            for( const market_transaction& market_trx : pending_state->market_transactions )
+               filter_builder.add_market_transaction( market_trx );
+
 //            if( block_data.block_num >= BTSX_MARKET_FORK_2_BLOCK_NUM )
-                apply_transactions( block_data, pending_state );
+                apply_transactions( block_data, pending_state, &filter_builder );
 
             update_active_delegate_list( block_data, pending_state );
 
@@ -1044,6 +1394,8 @@ namespace bts { namespace blockchain {
             // attempt.
             pending_state->apply_changes();
 
+            cache_applied_delta( block_id, pending_state, block_signee );
+
             mark_included( block_id, true );
 
             update_head_block( block_data );
@@ -1051,6 +1403,11 @@ namespace bts { namespace blockchain {
             clear_pending( block_data );
 
             _block_num_to_id_db.store( block_data.block_num, block_id );
+            store_main_chain_block_id( block_data.block_num, block_id );
+            index_block_signee( block_id, signee_id );
+            record_block_slots( pending_state );
+
+            _address_filter_db.store( block_id, filter_builder.build( block_id ) );
 
             // self->sanity_check();
 
@@ -1098,12 +1455,122 @@ namespace bts { namespace blockchain {
             throw;
          }
 
+         notify_block_applied( summary );
+      } FC_RETHROW_EXCEPTIONS( warn, "", ("block",block_data) ) }
+
+      void chain_database_impl::notify_block_applied( const block_summary& summary )
+      {
          //Schedule the observer notifications for later; the chain is in a
          //non-premptable state right now, and observers may yield.
-         if( (now() - block_data.timestamp).to_seconds() < BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC )
+         if( (now() - summary.block_data.timestamp).to_seconds() < BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC )
            for( chain_observer* o : _observers )
               fc::async([o,summary]{o->block_applied( summary );}, "call_block_applied_observer");
-      } FC_RETHROW_EXCEPTIONS( warn, "", ("block",block_data) ) }
+      }
+
+      /**
+       *  Applies the changes block_id made the last time it was applied, skipping evaluation.
+       *  Returns false if the block isn't in the delta cache.
+       */
+      bool chain_database_impl::reapply_cached_delta( const block_id_type& block_id, const full_block& block_data )
+      { try {
+         const auto itr = _applied_delta_cache.find( block_id );
+         if( itr == _applied_delta_cache.end() || block_data.previous != _head_block_id )
+            return false;
+
+         // the delta is only valid for the state it was built on, but the header checks depend on the
+         // current head and clock, so run them again exactly as extend_chain would
+         auto checkpoint_itr = CHECKPOINT_BLOCKS.find( block_data.block_num );
+         if( checkpoint_itr != CHECKPOINT_BLOCKS.end() && checkpoint_itr->second != block_id )
+           FC_CAPTURE_AND_THROW( failed_checkpoint_verification, (block_id)(checkpoint_itr->second) );
+         verify_header( block_data, itr->second.block_signee, true );
+
+         ilog( "reapplying cached changes for block ${n} ${id}", ("n",block_data.block_num)("id",block_id) );
+         const pending_chain_state_ptr pending_state = itr->second.changes;
+         pending_state->set_prev_state( self->shared_from_this() );
+
+         block_summary summary;
+         summary.block_data = block_data;
+         summary.applied_changes = pending_state;
+
+         save_undo_state( block_id, pending_state );
+         pending_state->apply_changes();
+         mark_included( block_id, true );
+         update_head_block( block_data );
+         clear_pending( block_data );
+         _block_num_to_id_db.store( block_data.block_num, block_id );
+         store_main_chain_block_id( block_data.block_num, block_id );
+         const oblock_record record = self->get_block_record( block_id );
+         if( record.valid() && record->signee_id.valid() )
+            index_block_signee( block_id, *record->signee_id );
+         record_block_slots( pending_state );
+
+         notify_block_applied( summary );
+         return true;
+      } FC_CAPTURE_AND_RETHROW( (block_id) ) }
+
+      void chain_database_impl::cache_applied_delta( const block_id_type& block_id,
+                                                     const pending_chain_state_ptr& pending_state,
+                                                     const public_key_type& block_signee )
+      {
+         // blocks behind the last checkpoint can't be forked away from, so don't churn the cache while replaying them
+         if( !CHECKPOINT_BLOCKS.empty() && (--CHECKPOINT_BLOCKS.end())->first > _head_block_header.block_num )
+            return;
+
+         if( !_applied_delta_cache.emplace( block_id, applied_delta{ pending_state, block_signee } ).second )
+            return;
+         _applied_delta_order.push_back( block_id );
+         while( _applied_delta_order.size() > BTS_BLOCKCHAIN_FORK_CACHE_SIZE )
+         {
+            _applied_delta_cache.erase( _applied_delta_order.front() );
+            _applied_delta_order.pop_front();
+         }
+      }
+
+      /**
+       *  Starts checking the digest and recovering the signee of a block that arrived on a side branch.
+       *  This is the part of validation that doesn't depend on chain state, so it can run on a worker
+       *  thread while the block waits to see whether its branch becomes the longest.
+       */
+      void chain_database_impl::prevalidate_fork_block( const full_block& block_data )
+      { try {
+         const block_id_type block_id = block_data.id();
+         if( _prevalidated_signees.count( block_id ) > 0 || _applied_delta_cache.count( block_id ) > 0 )
+            return;
+
+         if( !_fork_validation_thread )
+            _fork_validation_thread.reset( new fc::thread( "fork_validation" ) );
+
+         _prevalidated_signees[ block_id ] = _fork_validation_thread->async( [block_data]() -> public_key_type
+         {
+            digest_block digest_data( block_data );
+            if( NOT digest_data.validate_digest() )
+              FC_CAPTURE_AND_THROW( invalid_block_digest );
+            FC_ASSERT( digest_data.validate_unique() );
+            return block_data.signee();
+         }, "prevalidate_fork_block" );
+         _prevalidated_order.push_back( block_id );
+
+         while( _prevalidated_order.size() > BTS_BLOCKCHAIN_FORK_CACHE_SIZE )
+         {
+            _prevalidated_signees.erase( _prevalidated_order.front() );
+            _prevalidated_order.pop_front();
+         }
+      } FC_CAPTURE_AND_RETHROW( (block_data) ) }
+
+      /**
+       *  Returns the signee recovered in the background for block_id if that work has finished and
+       *  succeeded.  Never waits: callers hold the chain in a non-preemptable state.
+       */
+      optional<public_key_type> chain_database_impl::take_prevalidated_signee( const block_id_type& block_id )
+      {
+         const auto itr = _prevalidated_signees.find( block_id );
+         if( itr == _prevalidated_signees.end() || !itr->second.ready() || itr->second.error() )
+            return optional<public_key_type>();
+
+         const public_key_type block_signee = itr->second.wait();
+         _prevalidated_signees.erase( itr );
+         return block_signee;
+      }
 
       /**
        * Traverse the previous links of all blocks in fork until we find one that is_included
@@ -1156,6 +1623,12 @@ namespace bts { namespace blockchain {
 
          // update the block_num_to_block_id index
          _block_num_to_id_db.remove( _head_block_header.block_num );
+         if( _main_chain_block_ids.size() == _head_block_header.block_num )
+            _main_chain_block_ids.pop_back();
+         const oblock_record head_record = self->get_block_record( _head_block_id );
+         if( head_record.valid() && head_record->signee_id.valid() )
+            _delegate_block_index_db.remove( std::make_pair( *head_record->signee_id, _head_block_header.block_num ) );
+         // the address filter is keyed by the block id, so it is kept for when this block is reapplied
 
          auto previous_block_id = _head_block_header.previous;
 
@@ -1165,6 +1638,7 @@ namespace bts { namespace blockchain {
 
          _head_block_id = previous_block_id;
          _head_block_header = self->get_block_header( _head_block_id );
+         unwind_delegate_production( _head_block_header.timestamp );
 
          //Schedule the observer notifications for later; the chain is in a
          //non-premptable state right now, and observers may yield.
@@ -1242,6 +1716,7 @@ namespace bts { namespace blockchain {
 
    void chain_database::open( const fc::path& data_dir, fc::optional<fc::path> genesis_file, std::function<void(float)> reindex_status_callback )
    { try {
+      _property_cache.clear();
       bool must_rebuild_index = !fc::exists( data_dir / "index" );
       std::exception_ptr error_opening_database;
       try
@@ -1390,6 +1865,8 @@ namespace bts { namespace blockchain {
               FC_THROW_EXCEPTION( wrong_chain_id, "Wrong chain ID!", ("database_id",db_chain_id)("genesis_id",genesis_chain_id) );
           my->_chain_id = db_chain_id;
 
+          my->rebuild_delegate_production();
+
           //  process the pending transactions to cache by fees
           auto pending_itr = my->_pending_transaction_db.begin();
           wlog( "loading pending trx..." );
@@ -1402,6 +1879,7 @@ namespace bts { namespace blockchain {
                 auto eval_state = evaluate_transaction( trx, my->_relay_fee );
                 share_type fees = eval_state->get_fees();
                 my->_pending_fee_index[ fee_index( fees, trx_id ) ] = eval_state;
+                my->add_to_pending_pool( trx_id, my->make_pending_pool_entry( trx, fees ) );
                 my->_pending_transaction_db.store( trx_id, trx );
              }
              catch ( const fc::exception& e )
@@ -1428,6 +1906,7 @@ namespace bts { namespace blockchain {
 
    void chain_database::close()
    { try {
+      _property_cache.clear();
       my->_market_transactions_db.close();
       my->_fork_number_db.close();
       my->_fork_db.close();
@@ -1441,14 +1920,19 @@ namespace bts { namespace blockchain {
       my->_undo_state_db.close();
 
       my->_block_num_to_id_db.close();
+      my->_main_chain_block_ids.clear();
       my->_block_id_to_block_record_db.close();
       my->_block_id_to_block_data_db.close();
+      my->_address_filter_db.close();
       my->_id_to_transaction_record_db.close();
 
       my->_pending_transaction_db.close();
 
       my->_asset_db.close();
       my->_balance_db.close();
+      my->_owner_balance_index_db.close();
+      my->_unclaimed_genesis_balance_db.close();
+      my->_unclaimed_genesis_total = 0;
       my->_burn_db.close();
       my->_account_db.close();
       my->_address_to_account_db.close();
@@ -1458,13 +1942,22 @@ namespace bts { namespace blockchain {
       my->_delegate_vote_index_db.close();
 
       my->_slot_record_db.close();
+      my->_delegate_block_index_db.close();
+      my->_delegate_production.clear();
+      my->_delegate_reliability_index.clear();
 
       my->_ask_db.close();
       my->_bid_db.close();
       my->_short_db.close();
       my->_collateral_db.close();
+      my->_collateral_expiration_index_db.close();
       my->_feed_db.close();
 
+      my->_applied_delta_cache.clear();
+      my->_applied_delta_order.clear();
+      my->_prevalidated_signees.clear();
+      my->_prevalidated_order.clear();
+
       my->_market_history_db.close();
       my->_market_status_db.close();
    } FC_RETHROW_EXCEPTIONS( warn, "" ) }
@@ -1478,8 +1971,13 @@ namespace bts { namespace blockchain {
 
    account_record chain_database::get_block_signee( const block_id_type& block_id )const
    {
-      auto block_header = get_block_header( block_id );
-      auto delegate_record = get_account_record( address( block_header.signee() ) );
+      /* Blocks that have been applied record their producer; only unapplied fork blocks need signature recovery */
+      const oblock_record block_record = get_block_record( block_id );
+      oaccount_record delegate_record;
+      if( block_record.valid() && block_record->signee_id.valid() )
+         delegate_record = get_account_record( *block_record->signee_id );
+      else
+         delegate_record = get_account_record( address( get_block_header( block_id ).signee() ) );
       FC_ASSERT( delegate_record.valid() && delegate_record->is_delegate() );
       return *delegate_record;
    }
@@ -1522,15 +2020,19 @@ namespace bts { namespace blockchain {
       return optional<time_point_sec>();
    } FC_CAPTURE_AND_RETHROW( (delegate_ids) ) }
 
-   transaction_evaluation_state_ptr chain_database::evaluate_transaction( const signed_transaction& trx, const share_type& required_fees )
+   transaction_evaluation_state_ptr chain_database::evaluate_transaction( const signed_transaction& trx, const share_type& required_fees,
+                                                                          const transaction_precheck* precheck )
    { try {
       if( !my->_pending_trx_state )
          my->_pending_trx_state = std::make_shared<pending_chain_state>( shared_from_this() );
 
-      pending_chain_state_ptr          pend_state = std::make_shared<pending_chain_state>(my->_pending_trx_state);
+      // callers such as the pending pool keep the result, so it gets an overlay of its own
+      const pending_chain_state_ptr pend_state = std::make_shared<pending_chain_state>( my->_pending_trx_state );
       transaction_evaluation_state_ptr trx_eval_state = std::make_shared<transaction_evaluation_state>(pend_state.get(), my->_chain_id);
+      trx_eval_state->_owned_state = pend_state;
 
-      trx_eval_state->evaluate( trx );
+      ++my->_pending_evaluation_count;
+      trx_eval_state->evaluate( trx, false, precheck );
       auto fees = trx_eval_state->get_fees() + trx_eval_state->alt_fees_paid.amount;
       if( fees < required_fees )
       {
@@ -1591,9 +2093,17 @@ namespace bts { namespace blockchain {
 
    block_id_type chain_database::get_block_id( uint32_t block_num ) const
    { try {
-      return my->_block_num_to_id_db.fetch( block_num );
+      if( block_num == 0 || block_num > my->_main_chain_block_ids.size() )
+         FC_CAPTURE_AND_THROW( fc::key_not_found_exception, (block_num) );
+      return my->_main_chain_block_ids[ block_num - 1 ];
    } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+   bool chain_database::is_included_block( uint32_t block_num, const block_id_type& block_id )const
+   {
+      return block_num > 0 && block_num <= my->_main_chain_block_ids.size()
+             && my->_main_chain_block_ids[ block_num - 1 ] == block_id;
+   }
+
    vector<transaction_record> chain_database::get_transactions_for_block( const block_id_type& block_id )const
    {
       auto block_record = my->_block_id_to_block_record_db.fetch(block_id);
@@ -1616,10 +2126,14 @@ namespace bts { namespace blockchain {
 
    digest_block chain_database::get_block_digest( uint32_t block_num )const
    {
-      auto block_id = my->_block_num_to_id_db.fetch( block_num );
-      return get_block_digest( block_id );
+      return get_block_digest( get_block_id( block_num ) );
    }
 
+   oaddress_filter chain_database::get_address_filter( const block_id_type& block_id )const
+   { try {
+      return my->_address_filter_db.fetch_optional( block_id );
+   } FC_CAPTURE_AND_RETHROW( (block_id) ) }
+
    full_block chain_database::get_block( const block_id_type& block_id )const
    { try {
       return my->_block_id_to_block_data_db.fetch(block_id);
@@ -1627,8 +2141,7 @@ namespace bts { namespace blockchain {
 
    full_block chain_database::get_block( uint32_t block_num )const
    { try {
-      auto block_id = my->_block_num_to_id_db.fetch( block_num );
-      return get_block( block_id );
+      return get_block( get_block_id( block_num ) );
    } FC_RETHROW_EXCEPTIONS( warn, "", ("block_num",block_num) ) }
 
    signed_block_header chain_database::get_head_block()const
@@ -1697,6 +2210,10 @@ namespace bts { namespace blockchain {
          }
       }
 
+      // a block left on a side branch gets its stateless checks done now, so a switch to it later is cheaper
+      if( !new_fork_data->is_included && !new_fork_data->invalid() )
+         my->prevalidate_fork_block( block_data );
+
       /* Store processing time */
       auto record = get_block_record( block_id );
       FC_ASSERT( record.valid() );
@@ -1808,6 +2325,8 @@ namespace bts { namespace blockchain {
 #endif
        /* Currently we keep all balance records forever so we know the owner and asset ID on wallet rescan */
        my->_balance_db.store( r.id(), r );
+       my->_owner_balance_index_db.store( std::make_pair( r.owner(), r.id() ), 0 );
+       my->index_unclaimed_genesis_balance( r );
 
    } FC_RETHROW_EXCEPTIONS( warn, "", ("record", r) ) }
 
@@ -1943,6 +2462,19 @@ namespace bts { namespace blockchain {
         }
    }
 
+   vector<balance_record> chain_database::get_balances_for_owner( const address& owner )const
+   { try {
+        vector<balance_record> balances;
+        for( auto itr = my->_owner_balance_index_db.lower_bound( std::make_pair( owner, balance_id_type() ) );
+             itr.valid() && itr.key().first == owner; ++itr )
+        {
+           const obalance_record balance = my->_balance_db.fetch_optional( itr.key().second );
+           if( balance.valid() )
+              balances.push_back( *balance );
+        }
+        return balances;
+   } FC_CAPTURE_AND_RETHROW( (owner) ) }
+
    void chain_database::scan_accounts( function<void( const account_record& )> callback )
    {
         auto name_itr = my->_account_db.begin();
@@ -1954,9 +2486,10 @@ namespace bts { namespace blockchain {
    }
 
    /** this should throw if the trx is invalid */
-   transaction_evaluation_state_ptr chain_database::store_pending_transaction( const signed_transaction& trx, bool override_limits )
+   transaction_evaluation_state_ptr chain_database::store_pending_transaction( const signed_transaction& trx, bool override_limits,
+                                                                               const transaction_precheck* precheck )
    { try {
-      auto trx_id = trx.id();
+      auto trx_id = precheck != nullptr ? precheck->id : trx.id();
       if (override_limits)
         wlog("storing new local transaction with id ${id}", ("id", trx_id));
 
@@ -1964,24 +2497,38 @@ namespace bts { namespace blockchain {
       if( current_itr.valid() )
         return nullptr;
 
+      // the fee is not known until evaluation, so size the entry first and fill in the fee after
+      pending_pool_entry entry = my->make_pending_pool_entry( trx, 0 );
+      if( precheck != nullptr )
+         entry.size = precheck->size;
+
       share_type relay_fee = my->_relay_fee;
       if( !override_limits )
       {
-         if( my->_pending_fee_index.size() > BTS_BLOCKCHAIN_MAX_PENDING_QUEUE_SIZE )
+         for( const balance_id_type& sender : entry.senders )
          {
-             auto overage = my->_pending_fee_index.size() - BTS_BLOCKCHAIN_MAX_PENDING_QUEUE_SIZE;
-             relay_fee = my->_relay_fee * overage * overage;
+            const auto count_itr = my->_pending_pool_sender_counts.find( sender );
+            if( count_itr != my->_pending_pool_sender_counts.end() && count_itr->second >= my->_pending_pool_max_per_sender )
+               FC_CAPTURE_AND_THROW( pending_sender_limit, (sender)(count_itr->second) );
          }
+         relay_fee = my->required_relay_fee( entry );
       }
 
-      transaction_evaluation_state_ptr eval_state = evaluate_transaction( trx, relay_fee );
+      transaction_evaluation_state_ptr eval_state = evaluate_transaction( trx, relay_fee, precheck );
       share_type fees = eval_state->get_fees();
-
-      //if( fees < my->_relay_fee )
-      //   FC_CAPTURE_AND_THROW( insufficient_relay_fee, (fees)(my->_relay_fee) );
+      entry.fees = fees;
 
       my->_pending_fee_index[ fee_index( fees, trx_id ) ] = eval_state;
       my->_pending_transaction_db.store( trx_id, trx );
+      my->add_to_pending_pool( trx_id, entry );
+
+      // evicted transactions were already applied to the pending state; rather than re-evaluating
+      // the whole pool on every insert at the cap, it is rebuilt once, after this task yields, and
+      // anything that depended on an evicted transaction is dropped then
+      if( my->evict_pending_overflow( trx_id ) > 0 )
+         my->_pending_pool_dirty = true;
+      if( my->_pending_pool_dirty )
+         my->schedule_revalidate_pending();
 
       return eval_state;
    } FC_RETHROW_EXCEPTIONS( warn, "", ("trx",trx) ) }
@@ -2010,6 +2557,9 @@ namespace bts { namespace blockchain {
       size_t block_size = 0;
       share_type total_fees = 0;
 
+      // one overlay is reset and reused for every transaction instead of building a new one each time
+      const pending_chain_state_ptr pending_trx_state = std::make_shared<pending_chain_state>( pending_state );
+
       // TODO: Sort pending transactions by highest fee
       for( const auto& item : pending_trx )
       {
@@ -2018,7 +2568,7 @@ namespace bts { namespace blockchain {
          block_size += trx_size;
 
          /* Make modifications to temporary state */
-         auto pending_trx_state = std::make_shared<pending_chain_state>( pending_state );
+         pending_trx_state->reset( pending_state );
          auto trx_eval_state = std::make_shared<transaction_evaluation_state>( pending_trx_state.get(), my->_chain_id );
 
          try
@@ -2301,6 +2851,61 @@ namespace bts { namespace blockchain {
         return slot_records;
     }
 
+    vector<block_record> chain_database::get_delegate_produced_blocks( const account_id_type& delegate_id,
+                                                                       uint32_t start_block_num, uint32_t count )const
+    { try {
+        vector<block_record> block_records;
+        block_records.reserve( std::min<uint32_t>( count, 1000 ) );
+
+        for( auto iter = my->_delegate_block_index_db.lower_bound( std::make_pair( delegate_id, start_block_num ) );
+             iter.valid() && block_records.size() < count; ++iter )
+        {
+            if( iter.key().first != delegate_id )
+                break;
+            block_records.push_back( my->_block_id_to_block_record_db.fetch( iter.value() ) );
+        }
+
+        return block_records;
+    } FC_CAPTURE_AND_RETHROW( (delegate_id)(start_block_num)(count) ) }
+
+    vector<delegate_production_stats> chain_database::get_delegates_by_reliability( uint32_t window, uint32_t count )const
+    { try {
+        const vector<uint32_t>& windows = my->_delegate_reliability_windows;
+        if( window == 0 )
+            window = windows.front();
+        const auto window_itr = std::find( windows.begin(), windows.end(), window );
+        FC_ASSERT( window_itr != windows.end(), "window is not one of the tracked reliability windows", ("windows",windows) );
+        const size_t window_index = window_itr - windows.begin();
+        if( window_index >= my->_delegate_reliability_index.size() )
+            return vector<delegate_production_stats>();
+
+        vector<delegate_production_stats> results;
+        const auto& index = my->_delegate_reliability_index[ window_index ];
+        for( auto itr = index.rbegin(); itr != index.rend() && results.size() < count; ++itr )
+        {
+            const delegate_production_tracker& tracker = my->_delegate_production.at( itr->second );
+
+            delegate_production_stats stats;
+            stats.delegate_id = itr->second;
+            const oaccount_record delegate_record = get_account_record( stats.delegate_id );
+            if( delegate_record.valid() && delegate_record->is_delegate() )
+            {
+                stats.delegate_name = delegate_record->name;
+                stats.blocks_produced = delegate_record->delegate_info->blocks_produced;
+                stats.blocks_missed = delegate_record->delegate_info->blocks_missed;
+                stats.last_block_num_produced = delegate_record->delegate_info->last_block_num_produced;
+                stats.pay_balance = delegate_record->delegate_pay_balance();
+            }
+            stats.missed_in_a_row = tracker.missed_in_a_row;
+            for( size_t i = 0; i < windows.size(); ++i )
+                stats.reliability[ windows[ i ] ] = tracker.reliability_key[ i ] / 100.0;
+            if( tracker.latency_samples > 0 )
+                stats.average_latency = fc::microseconds( tracker.total_latency_us / tracker.latency_samples );
+            results.push_back( stats );
+        }
+        return results;
+    } FC_CAPTURE_AND_RETHROW( (window)(count) ) }
+
    fc::variant chain_database::get_property( chain_property_enum property_id )const
    { try {
       return my->_property_db.fetch( property_id );
@@ -2309,6 +2914,7 @@ namespace bts { namespace blockchain {
    void chain_database::set_property( chain_property_enum property_id,
                                                      const fc::variant& property_value )
    {
+      _property_cache.invalidate( property_id );
       if( property_value.is_null() )
          my->_property_db.remove( property_id );
       else
@@ -2430,7 +3036,9 @@ namespace bts { namespace blockchain {
 
    fc::ripemd160 chain_database::get_current_random_seed()const
    {
-      return get_property( last_random_seed_id ).as<fc::ripemd160>();
+      if( !_property_cache.random_seed.valid() )
+         _property_cache.random_seed = get_property( last_random_seed_id ).as<fc::ripemd160>();
+      return *_property_cache.random_seed;
    }
 
    oorder_record chain_database::get_bid_record( const market_index_key&  key )const
@@ -2493,12 +3101,68 @@ namespace bts { namespace blockchain {
 
    void chain_database::store_collateral_record( const market_index_key& key, const collateral_record& collateral )
    {
+      const ocollateral_record previous = my->_collateral_db.fetch_optional( key );
+      if( previous.valid() )
+         my->_collateral_expiration_index_db.remove( expiration_index( key, previous->expiration ) );
+
       if( collateral.is_null() )
+      {
          my->_collateral_db.remove( key );
+      }
       else
+      {
          my->_collateral_db.store( key, collateral );
+         my->_collateral_expiration_index_db.store( expiration_index( key, collateral.expiration ), 0 );
+      }
    }
 
+   vector<market_order> chain_database::get_expired_covers( const asset_id_type& quote_id, const asset_id_type& base_id,
+                                                            const time_point_sec& as_of, uint32_t limit )const
+   { try {
+       vector<market_order> results;
+       for( auto itr = my->_collateral_expiration_index_db.lower_bound( expiration_index( market_index_key( price( 0, quote_id, base_id ) ),
+                                                                                          time_point_sec() ) );
+            itr.valid() && results.size() < limit; ++itr )
+       {
+          const expiration_index index = itr.key();
+          if( index.quote_id != quote_id || index.base_id != base_id || index.expiration > as_of )
+             break;
+          const ocollateral_record collat_record = my->_collateral_db.fetch_optional( index.key );
+          FC_ASSERT( collat_record.valid(), "collateral expiration index out of sync", ("key",index.key) );
+          results.push_back( {cover_order,
+                              index.key,
+                              order_record(collat_record->payoff_balance),
+                              collat_record->collateral_balance,
+                              collat_record->interest_rate,
+                              collat_record->expiration } );
+       }
+       return results;
+   } FC_CAPTURE_AND_RETHROW( (quote_id)(base_id)(as_of)(limit) ) }
+
+   vector<market_order> chain_database::get_covers_called_at( const asset_id_type& quote_id, const asset_id_type& base_id,
+                                                              const price& feed_price, uint32_t limit )const
+   { try {
+       vector<market_order> results;
+       // covers are keyed by call price, so every position a feed at this price would call sits above it
+       for( auto itr = my->_collateral_db.lower_bound( market_index_key( feed_price ) );
+            itr.valid() && results.size() < limit; ++itr )
+       {
+          const market_index_key key = itr.key();
+          if( key.order_price.quote_asset_id != quote_id || key.order_price.base_asset_id != base_id )
+             break;
+          if( !(key.order_price > feed_price) )
+             continue;
+          const collateral_record collat_record = itr.value();
+          results.push_back( {cover_order,
+                              key,
+                              order_record(collat_record.payoff_balance),
+                              collat_record.collateral_balance,
+                              collat_record.interest_rate,
+                              collat_record.expiration } );
+       }
+       return results;
+   } FC_CAPTURE_AND_RETHROW( (quote_id)(base_id)(feed_price)(limit) ) }
+
    string chain_database::get_asset_symbol( const asset_id_type& asset_id )const
    { try {
       auto asset_rec = get_asset_record( asset_id );
@@ -2983,6 +3647,43 @@ namespace bts { namespace blockchain {
       return my->_relay_fee;
    }
 
+   void chain_database::set_pending_pool_limits( uint64_t max_bytes, uint32_t max_per_sender )
+   {
+      my->_pending_pool_max_bytes = max_bytes;
+      my->_pending_pool_max_per_sender = max_per_sender;
+      if( my->evict_pending_overflow( optional<transaction_id_type>() ) > 0 )
+      {
+         my->_pending_pool_dirty = true;
+         my->schedule_revalidate_pending();
+      }
+   }
+
+   void chain_database::set_delegate_reliability_windows( const vector<uint32_t>& windows )
+   { try {
+      vector<uint32_t> sorted_windows = windows;
+      std::sort( sorted_windows.begin(), sorted_windows.end() );
+      sorted_windows.erase( std::unique( sorted_windows.begin(), sorted_windows.end() ), sorted_windows.end() );
+      FC_ASSERT( !sorted_windows.empty() && sorted_windows.front() > 0, "at least one nonzero window is required" );
+      if( sorted_windows == my->_delegate_reliability_windows )
+         return;
+      my->_delegate_reliability_windows = sorted_windows;
+      my->rebuild_delegate_production();
+   } FC_CAPTURE_AND_RETHROW( (windows) ) }
+
+   fc::variant_object chain_database::get_pending_pool_status()const
+   {
+      fc::mutable_variant_object status;
+      status["transaction_count"]       = my->_pending_pool_entries.size();
+      status["bytes"]                   = my->_pending_pool_bytes;
+      status["max_bytes"]               = my->_pending_pool_max_bytes;
+      status["max_per_sender"]          = my->_pending_pool_max_per_sender;
+      status["required_relay_fee"]      = my->required_relay_fee( pending_pool_entry() );
+      status["lowest_fee_per_kb"]       = my->_pending_pool_by_fee_rate.empty() ? 0 : my->_pending_pool_by_fee_rate.begin()->first;
+      status["rebuild_pending"]         = my->_pending_pool_dirty;
+      status["evaluation_count"]        = my->_pending_evaluation_count;
+      return status;
+   }
+
    void chain_database::set_market_transactions( vector<market_transaction> trxs )
    {
       if( trxs.size() == 0 )
@@ -3187,18 +3888,7 @@ namespace bts { namespace blockchain {
 
    asset chain_database::unclaimed_genesis()
    {
-        auto balance = my->_balance_db.begin();
-        asset unclaimed_total(0);
-        auto genesis_date = get_genesis_timestamp();
-
-        while (balance.valid()) {
-            if (balance.value().last_update <= genesis_date)
-                unclaimed_total += balance.value().get_balance();
-
-            ++balance;
-        }
-
-        return unclaimed_total;
+        return asset( my->_unclaimed_genesis_total );
    }
 
    /**
@@ -3404,6 +4094,10 @@ namespace bts { namespace blockchain {
        my->_slot_record_db.export_to_json( next_path );
        ulog( "Dumped ${p}", ("p",next_path) );
 
+       next_path = dir / "_delegate_block_index_db.json";
+       my->_delegate_block_index_db.export_to_json( next_path );
+       ulog( "Dumped ${p}", ("p",next_path) );
+
        next_path = dir / "_ask_db.json";
        my->_ask_db.export_to_json( next_path );
        ulog( "Dumped ${p}", ("p",next_path) );
@@ -3437,15 +4131,103 @@ namespace bts { namespace blockchain {
    {
      fc::mutable_variant_object stats;
 #define CHAIN_DB_DATABASES (_market_transactions_db)(_slate_db)(_fork_number_db)(_fork_db)(_property_db)(_undo_state_db) \
-                           (_block_num_to_id_db)(_block_id_to_block_record_db)(_block_id_to_block_data_db)(_known_transactions) \
+                           (_block_num_to_id_db)(_block_id_to_block_record_db)(_block_id_to_block_data_db)(_address_filter_db)(_known_transactions) \
                            (_id_to_transaction_record_db)(_pending_transaction_db)(_pending_fee_index)(_asset_db)(_balance_db) \
-                           (_burn_db)(_account_db)(_address_to_account_db)(_account_index_db)(_symbol_index_db)(_delegate_vote_index_db) \
-                           (_slot_record_db)(_ask_db)(_bid_db)(_short_db)(_collateral_db)(_feed_db)(_market_status_db)(_market_history_db) \
-                           (_recent_operations)
+                           (_owner_balance_index_db)(_unclaimed_genesis_balance_db)(_burn_db)(_account_db)(_address_to_account_db) \
+                           (_account_index_db)(_symbol_index_db)(_delegate_vote_index_db)(_slot_record_db)(_delegate_block_index_db) \
+                           (_ask_db)(_bid_db)(_short_db)(_collateral_db)(_collateral_expiration_index_db)(_feed_db)(_market_status_db) \
+                           (_market_history_db)(_recent_operations)
 #define GET_DATABASE_SIZE(r, data, elem) stats[BOOST_PP_STRINGIZE(elem)] = my->elem.size();
      BOOST_PP_SEQ_FOR_EACH(GET_DATABASE_SIZE, _, CHAIN_DB_DATABASES)
      return stats;
    }
 
+   /**
+    *  The cached tables are sized by packing their entries, so this walks every one of them.  The
+    *  pending pool keeps a running byte count; with verify set it is recomputed from scratch and
+    *  the difference is reported as drift.  Everything else is sized from element counts, except
+    *  the fork caches which are packed since they are few.
+    */
+   fc::variant_object chain_database::get_memory_usage( bool verify )const
+   {
+     fc::mutable_variant_object tables;
+     uint64_t total_bytes = 0;
+#define CHAIN_DB_CACHED_TABLES (_market_transactions_db)(_slate_db)(_property_db)(_asset_db)(_symbol_index_db)(_account_db) \
+                               (_address_to_account_db)(_account_index_db)(_delegate_vote_index_db)(_ask_db)(_bid_db)(_short_db) \
+                               (_collateral_db)(_feed_db)(_market_status_db)
+#define GET_CACHED_TABLE_USAGE(r, data, elem) \
+     { \
+        fc::mutable_variant_object usage; \
+        usage["entries"] = my->elem.size(); \
+        const uint64_t bytes = my->elem.memory_usage(); \
+        usage["bytes"] = bytes; \
+        total_bytes += bytes; \
+        tables[BOOST_PP_STRINGIZE(elem)] = usage; \
+     }
+     BOOST_PP_SEQ_FOR_EACH(GET_CACHED_TABLE_USAGE, _, CHAIN_DB_CACHED_TABLES)
+
+     const uint64_t node_overhead = 4 * sizeof( void* );
+     const auto add_indexed = [&]( const string& name, uint64_t entries, uint64_t entry_size )
+     {
+        fc::mutable_variant_object usage;
+        usage["entries"] = entries;
+        usage["bytes"] = entries * (entry_size + node_overhead);
+        total_bytes += entries * (entry_size + node_overhead);
+        tables[name] = usage;
+     };
+     {
+        fc::mutable_variant_object usage;
+        usage["entries"] = my->_main_chain_block_ids.size();
+        usage["bytes"] = my->_main_chain_block_ids.capacity() * sizeof( block_id_type );
+        total_bytes += my->_main_chain_block_ids.capacity() * sizeof( block_id_type );
+        tables["_main_chain_block_ids"] = usage;
+     }
+     {
+        uint64_t slot_count = 0;
+        for( const auto& item : my->_delegate_production )
+           slot_count += item.second.recent_slots.size();
+        const uint64_t bytes = my->_delegate_production.size() * (sizeof( delegate_production_tracker ) + node_overhead)
+                               + slot_count * sizeof( delegate_production_tracker::slot_outcome );
+        fc::mutable_variant_object usage;
+        usage["entries"] = my->_delegate_production.size();
+        usage["bytes"] = bytes;
+        total_bytes += bytes;
+        tables["_delegate_production"] = usage;
+     }
+     add_indexed( "_known_transactions", my->_known_transactions.size(), sizeof( transaction_id_type ) );
+     add_indexed( "_prevalidated_signees", my->_prevalidated_signees.size(), sizeof( fc::future<public_key_type> ) );
+
+     {
+        uint64_t delta_bytes = 0;
+        for( const auto& item : my->_applied_delta_cache )
+           delta_bytes += node_overhead + fc::raw::pack_size( *item.second.changes );
+        fc::mutable_variant_object usage;
+        usage["entries"] = my->_applied_delta_cache.size();
+        usage["bytes"] = delta_bytes;
+        total_bytes += delta_bytes;
+        tables["_applied_delta_cache"] = usage;
+     }
+
+     {
+        fc::mutable_variant_object usage;
+        usage["entries"] = my->_pending_pool_entries.size();
+        usage["bytes"] = my->_pending_pool_bytes;
+        if( verify )
+        {
+           uint64_t recomputed = 0;
+           for( const auto& item : my->_pending_pool_entries )
+              recomputed += item.second.size;
+           usage["drift"] = int64_t( my->_pending_pool_bytes ) - int64_t( recomputed );
+        }
+        total_bytes += my->_pending_pool_bytes;
+        tables["_pending_transactions"] = usage;
+     }
+
+     fc::mutable_variant_object result;
+     result["total_bytes"] = total_bytes;
+     result["tables"] = tables;
+     return result;
+   }
+
 
 } } // bts::blockchain
@@ -145,9 +145,41 @@ namespace bts { namespace blockchain {
    }
 #endif
 
+   void chain_property_cache::invalidate( chain_property_enum property_id )
+   {
+      switch( property_id )
+      {
+         case active_delegate_list_id:
+            active_delegates.reset();
+            active_delegate_set.clear();
+            break;
+         case chain_property_enum::dirty_markets:
+            dirty_markets.reset();
+            break;
+         case confirmation_requirement:
+            required_confirmations.reset();
+            break;
+         case last_random_seed_id:
+            random_seed.reset();
+            break;
+         default:
+            break;
+      }
+   }
+
+   void chain_interface::load_active_delegates()const
+   {
+      if( _property_cache.active_delegates.valid() )
+         return;
+      auto delegate_ids = get_property( active_delegate_list_id ).as<std::vector<account_id_type>>();
+      _property_cache.active_delegate_set = std::unordered_set<account_id_type>( delegate_ids.begin(), delegate_ids.end() );
+      _property_cache.active_delegates = std::move( delegate_ids );
+   }
+
    vector<account_id_type> chain_interface::get_active_delegates()const
    { try {
-      return get_property( active_delegate_list_id ).as<std::vector<account_id_type>>();
+      load_active_delegates();
+      return *_property_cache.active_delegates;
    } FC_RETHROW_EXCEPTIONS( warn, "" ) }
 
    void chain_interface::set_active_delegates( const std::vector<account_id_type>& delegate_ids )
@@ -157,8 +189,8 @@ namespace bts { namespace blockchain {
 
    bool chain_interface::is_active_delegate( const account_id_type& id )const
    { try {
-      const auto active = get_active_delegates();
-      return active.end() != std::find( active.begin(), active.end(), id );
+      load_active_delegates();
+      return _property_cache.active_delegate_set.count( id ) != 0;
    } FC_RETHROW_EXCEPTIONS( warn, "", ("id",id) ) }
 
    double chain_interface::to_pretty_price_double( const price& price_to_pretty_print )const
@@ -255,7 +287,9 @@ namespace bts { namespace blockchain {
 
    int64_t chain_interface::get_required_confirmations()const
    {
-      return get_property( confirmation_requirement ).as_int64();
+      if( !_property_cache.required_confirmations.valid() )
+         _property_cache.required_confirmations = get_property( confirmation_requirement ).as_int64();
+      return *_property_cache.required_confirmations;
    }
 
    share_type chain_interface::get_delegate_pay_rate()const
@@ -272,14 +306,18 @@ namespace bts { namespace blockchain {
 
    std::set<std::pair<asset_id_type, asset_id_type>> chain_interface::get_dirty_markets()const
    {
-       try
-       {
-           return get_property( dirty_markets ).as<std::set<std::pair<asset_id_type, asset_id_type>>>();
-       }
-       catch( ... )
+       if( !_property_cache.dirty_markets.valid() )
        {
+           try
+           {
+               _property_cache.dirty_markets = get_property( dirty_markets ).as<std::set<std::pair<asset_id_type, asset_id_type>>>();
+           }
+           catch( ... )
+           {
+               _property_cache.dirty_markets = std::set<std::pair<asset_id_type, asset_id_type>>();
+           }
        }
-       return std::set<std::pair<asset_id_type, asset_id_type>>();
+       return *_property_cache.dirty_markets;
    }
 
 } } // bts::blockchain
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <bts/blockchain/market_records.hpp>
+#include <bts/blockchain/transaction.hpp>
+
+namespace bts { namespace blockchain {
+
+   class chain_interface;
+
+   /**
+    *  A Golomb-coded set over the owner addresses, account ids and balance ids that a block
+    *  touches, stored next to each block so wallets can skip blocks that can't concern them
+    *  without loading and scanning the full block.
+    *
+    *  Membership tests may return false positives (about 1 in 2^golomb_rice_bits per element)
+    *  but never false negatives.  Element hashes are keyed by the block id so a collision in
+    *  one block doesn't repeat in every other block.
+    */
+   struct address_filter
+   {
+      /** bits in each encoded remainder; also sets the false positive rate */
+      static const uint8_t  golomb_rice_bits = 19;
+      static const uint64_t inverse_false_positive_rate = 784931;
+
+      uint32_t      element_count = 0;
+      /**
+       *  The block deposits to titan one-time keys or to conditions whose recipients aren't
+       *  indexed, so wallets still have to scan it to find their deposits.
+       */
+      bool          has_unfiltered_deposits = false;
+      vector<char>  data;
+
+      bool          matches_any( const block_id_type& block_id, const vector<string>& elements )const;
+
+      static string address_element( const address& owner );
+      static string account_element( const account_id_type& account_id );
+   };
+   typedef optional<address_filter> oaddress_filter;
+
+   class address_filter_builder
+   {
+      public:
+         void           add_address( const address& owner );
+         void           add_account( const account_id_type& account_id );
+
+         /** adds everything the operations of trx touch; state must be the chain state before trx is applied */
+         void           add_transaction( const signed_transaction& trx, const chain_interface& state );
+         void           add_market_transaction( const market_transaction& trx );
+
+         address_filter build( const block_id_type& block_id )const;
+
+      private:
+         void           add_condition( const withdraw_condition& condition );
+
+         std::set<string> _elements;
+         bool             _has_unfiltered_deposits = false;
+   };
+
+} } // bts::blockchain
+
+FC_REFLECT( bts::blockchain::address_filter, (element_count)(has_unfiltered_deposits)(data) )
@@ -15,6 +15,7 @@ namespace bts { namespace blockchain {
       uint64_t          block_size = 0; /* Bytes */
       fc::microseconds  latency; /* Time between block timestamp and first push_block */
       fc::microseconds  processing_time; /* Time taken for most recent push_block to run */
+      optional<account_id_type> signee_id; /* Producing delegate, set when the block is first applied */
    };
    typedef optional<block_record> oblock_record;
 
@@ -24,7 +25,11 @@ namespace bts { namespace blockchain {
 
       transaction_record( const transaction_location& loc,
                           const transaction_evaluation_state& s )
-      :transaction_evaluation_state(s),chain_location(loc){}
+      :transaction_evaluation_state(s),chain_location(loc)
+      {
+         // a record is stored in chain states, so it must not keep an evaluation overlay alive
+         _owned_state.reset();
+      }
 
       transaction_location chain_location;
    };
@@ -51,7 +56,8 @@ FC_REFLECT_DERIVED( bts::blockchain::block_record,
                     (random_seed)
                     (block_size)
                     (latency)
-                    (processing_time) )
+                    (processing_time)
+                    (signee_id) )
 
 FC_REFLECT_DERIVED( bts::blockchain::transaction_record,
                     (bts::blockchain::transaction_evaluation_state),
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <bts/blockchain/address_filter.hpp>
 #include <bts/blockchain/chain_interface.hpp>
 #include <bts/blockchain/pending_chain_state.hpp>
 
@@ -69,6 +70,20 @@ namespace bts { namespace blockchain {
    };
    typedef fc::optional<fork_record> ofork_record;
 
+   struct delegate_production_stats
+   {
+       account_id_type              delegate_id;
+       string                       delegate_name;
+       uint32_t                     blocks_produced = 0;
+       uint32_t                     blocks_missed = 0;
+       uint32_t                     last_block_num_produced = 0;
+       share_type                   pay_balance = 0;
+       uint32_t                     missed_in_a_row = 0;
+       /** window size in the delegate's own slots -> percent of its most recent slots in that window it produced */
+       std::map<uint32_t, double>   reliability;
+       fc::microseconds             average_latency;
+   };
+
    class chain_observer
    {
       public:
@@ -105,6 +120,12 @@ namespace bts { namespace blockchain {
          void set_relay_fee( share_type shares );
          share_type get_relay_fee();
 
+         /** caps the pending pool at max_bytes (0 for no cap) and the pending withdrawals from any one balance */
+         void set_pending_pool_limits( uint64_t max_bytes, uint32_t max_per_sender );
+         /** sets the windows, in each delegate's own slots, that production reliability is tracked and ranked over */
+         void set_delegate_reliability_windows( const vector<uint32_t>& windows );
+         fc::variant_object get_pending_pool_status()const;
+
          void sanity_check()const;
 
          time_point_sec get_genesis_timestamp()const;
@@ -124,12 +145,14 @@ namespace bts { namespace blockchain {
          pending_chain_state_ptr                  get_pending_state()const;
 
          /**
-          *  @param override_limits - stores the transaction even if the pending queue is full,
-          *                           if false then it will require exponential fee increases
-          *                           as the queue fills.
+          *  @param override_limits - stores the transaction even if the pending pool is full,
+          *                           if false then the relay fee rises as the pool fills, the
+          *                           per-sender limit applies and the lowest fee per kilobyte
+          *                           is evicted once the pool is over its memory cap.
           */
          transaction_evaluation_state_ptr         store_pending_transaction( const signed_transaction& trx,
-                                                                             bool override_limits = true );
+                                                                             bool override_limits = true,
+                                                                             const transaction_precheck* precheck = nullptr );
 
          vector<transaction_evaluation_state_ptr> get_pending_transactions()const;
          bool                                     is_known_transaction( const transaction_id_type& trx_id );
@@ -148,6 +171,8 @@ namespace bts { namespace blockchain {
          optional<block_fork_data>   get_block_fork_data( const block_id_type& )const; //is_known_block( const block_id_type& block_id )const;
          bool                        is_known_block( const block_id_type& id )const;
          bool                        is_included_block( const block_id_type& id )const;
+         /** true if block_id is the main chain block at block_num, answered without touching the database */
+         bool                        is_included_block( uint32_t block_num, const block_id_type& block_id )const;
          //optional<block_fork_data> is_included_block( const block_id_type& block_id )const;
 
          fc::ripemd160               get_current_random_seed()const override;
@@ -175,6 +200,8 @@ namespace bts { namespace blockchain {
          block_id_type               get_block_id( uint32_t block_num )const;
          oblock_record               get_block_record( const block_id_type& block_id )const;
          oblock_record               get_block_record( uint32_t block_num )const;
+         /** null for blocks applied before the address filter index existed */
+         oaddress_filter             get_address_filter( const block_id_type& block_id )const;
 
          /**
           *  searches all balances for a given owner, used for block explorers.
@@ -213,6 +240,11 @@ namespace bts { namespace blockchain {
 
          std::vector<slot_record> get_delegate_slot_records( const account_id_type& delegate_id,
                                                              int64_t start_block_num, uint32_t count )const;
+         /** main chain blocks produced by delegate_id, in block order starting at start_block_num */
+         std::vector<block_record> get_delegate_produced_blocks( const account_id_type& delegate_id,
+                                                                 uint32_t start_block_num, uint32_t count )const;
+         /** delegates with recent slots, most reliable over window first; window 0 means the shortest configured window */
+         vector<delegate_production_stats> get_delegates_by_reliability( uint32_t window, uint32_t count )const;
 
          std::map<uint32_t, std::vector<fork_record> > get_forks_list()const;
          std::string export_fork_graph( uint32_t start_block = 1, uint32_t end_block = -1, const fc::path& filename = "" )const;
@@ -230,7 +262,8 @@ namespace bts { namespace blockchain {
          /**
           *  Evaluate the transaction and return the results.
           */
-         virtual transaction_evaluation_state_ptr   evaluate_transaction( const signed_transaction& trx, const share_type& required_fees = 0 );
+         virtual transaction_evaluation_state_ptr   evaluate_transaction( const signed_transaction& trx, const share_type& required_fees = 0,
+                                                                         const transaction_precheck* precheck = nullptr );
          optional<fc::exception>                    get_transaction_error( const signed_transaction& transaction, const share_type& min_fee );
 
          /** return the timestamp from the head block */
@@ -261,6 +294,17 @@ namespace bts { namespace blockchain {
 
          share_type                         get_asset_collateral( const string& symbol );
 
+         /** margin positions in the market that have expired as of the given time, soonest expiration first */
+         vector<market_order>               get_expired_covers( const asset_id_type& quote_id,
+                                                                const asset_id_type& base_id,
+                                                                const time_point_sec& as_of,
+                                                                uint32_t limit = uint32_t(-1) )const;
+         /** margin positions whose call price is above feed_price, lowest call price first */
+         vector<market_order>               get_covers_called_at( const asset_id_type& quote_id,
+                                                                  const asset_id_type& base_id,
+                                                                  const price& feed_price,
+                                                                  uint32_t limit = uint32_t(-1) )const;
+
          virtual omarket_order              get_lowest_ask_record( const asset_id_type& quote_id,
                                                                    const asset_id_type& base_id )override;
          optional<market_order>             get_market_ask( const market_index_key& )const;
@@ -274,6 +318,8 @@ namespace bts { namespace blockchain {
 
          void                               scan_assets( function<void( const asset_record& )> callback );
          void                               scan_balances( function<void( const balance_record& )> callback );
+         /** point lookup of the signature-condition balances owned by owner, without scanning every balance */
+         vector<balance_record>             get_balances_for_owner( const address& owner )const;
          void                               scan_accounts( function<void( const account_record& )> callback );
 
          virtual variant                    get_property( chain_property_enum property_id )const override;
@@ -349,6 +395,8 @@ namespace bts { namespace blockchain {
 
          void                               dump_state( const fc::path& path )const;
          fc::variant_object                 get_stats() const;
+         /** approximate bytes held in memory per table, with bookkeeping drift when verify is set */
+         fc::variant_object                 get_memory_usage( bool verify = false ) const;
 
          // TODO: Only call on pending chain state
          virtual void                       set_market_dirty( const asset_id_type& quote_id, const asset_id_type& base_id )override
@@ -366,3 +414,5 @@ namespace bts { namespace blockchain {
 
 FC_REFLECT( bts::blockchain::block_fork_data, (next_blocks)(is_linked)(is_valid)(invalid_reason)(is_included)(is_known) )
 FC_REFLECT( bts::blockchain::fork_record, (block_id)(signing_delegate)(transaction_count)(latency)(size)(timestamp)(is_valid)(invalid_reason)(is_current_fork) )
+FC_REFLECT( bts::blockchain::delegate_production_stats, (delegate_id)(delegate_name)(blocks_produced)(blocks_missed)(last_block_num_produced)
+            (pay_balance)(missed_in_a_row)(reliability)(average_latency) )
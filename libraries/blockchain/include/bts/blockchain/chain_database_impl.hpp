@@ -19,6 +19,7 @@
 #include <fc/io/raw_variant.hpp>
 #include <fc/thread/mutex.hpp>
 #include <fc/thread/non_preemptable_scope_check.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/thread/unique_lock.hpp>
 
 #include <boost/random/mersenne_twister.hpp>
@@ -66,6 +67,33 @@ namespace bts { namespace blockchain {
       }
    };
 
+   struct pending_pool_entry
+   {
+      uint32_t                  size = 0;
+      share_type                fees = 0;
+      vector<balance_id_type>   senders;
+
+      int64_t fee_per_kb()const { return (int64_t( fees ) * 1000) / std::max<uint32_t>( size, 1 ); }
+   };
+
+   /** a delegate's most recent slots on the main chain, newest last, kept to the longest reliability window */
+   struct delegate_production_tracker
+   {
+      struct slot_outcome
+      {
+         time_point_sec            slot_time;
+         bool                      produced = false;
+         fc::microseconds          latency;
+      };
+
+      std::deque<slot_outcome>     recent_slots;
+      vector<uint32_t>             produced_in_window;  ///< parallel to the configured windows
+      vector<uint32_t>             reliability_key;     ///< basis points last stored in each ranking index
+      uint32_t                     missed_in_a_row = 0;
+      int64_t                      total_latency_us = 0; ///< over the produced slots in recent_slots
+      uint32_t                     latency_samples = 0;
+   };
+
    namespace detail
    {
       class chain_database_impl
@@ -78,13 +106,22 @@ namespace bts { namespace blockchain {
             void                                        clear_pending(  const full_block& blk );
             void                                        switch_to_fork( const block_id_type& block_id );
             void                                        extend_chain( const full_block& blk );
+            bool                                        reapply_cached_delta( const block_id_type& block_id, const full_block& blk );
+            void                                        cache_applied_delta( const block_id_type& block_id,
+                                                                             const pending_chain_state_ptr& pending_state,
+                                                                             const public_key_type& block_signee );
+            void                                        prevalidate_fork_block( const full_block& blk );
+            optional<public_key_type>                   take_prevalidated_signee( const block_id_type& block_id );
+            void                                        notify_block_applied( const block_summary& summary );
             vector<block_id_type>                       get_fork_history( const block_id_type& id );
             void                                        pop_block();
             void                                        mark_invalid( const block_id_type& id, const fc::exception& reason );
             void                                        mark_included( const block_id_type& id, bool state );
-            void                                        verify_header( const full_block&, const public_key_type& block_signee );
+            void                                        verify_header( const full_block&, const public_key_type& block_signee,
+                                                                           bool digest_verified = false );
             void                                        apply_transactions( const full_block& block,
-                                                                            const pending_chain_state_ptr& );
+                                                                            const pending_chain_state_ptr&,
+                                                                            address_filter_builder* filter_builder = nullptr );
             void                                        pay_delegate( const block_id_type& block_id,
                                                                       const pending_chain_state_ptr&,
                                                                       const public_key_type& block_signee );
@@ -101,11 +138,31 @@ namespace bts { namespace blockchain {
             void                                        update_active_delegate_list(const full_block& block_data,
                                                                                     const pending_chain_state_ptr& pending_state );
 
-            void                                        update_delegate_production_info( const full_block& block_data,
+            account_id_type                             update_delegate_production_info( const full_block& block_data,
                                                                                          const pending_chain_state_ptr& pending_state,
                                                                                          const public_key_type& block_signee );
 
             void                                        revalidate_pending();
+            void                                        store_main_chain_block_id( uint32_t block_num, const block_id_type& block_id );
+            void                                        index_block_signee( const block_id_type& block_id, const account_id_type& signee_id );
+            void                                        index_unclaimed_genesis_balance( const balance_record& record );
+
+            void                                        record_block_slots( const pending_chain_state_ptr& pending_state );
+            void                                        record_delegate_slot( const slot_record& slot );
+            void                                        unwind_delegate_production( const time_point_sec& head_time );
+            void                                        rebuild_delegate_production();
+            void                                        rank_delegate_reliability( const account_id_type& delegate_id,
+                                                                                   delegate_production_tracker& tracker );
+            void                                        schedule_revalidate_pending();
+
+            pending_pool_entry                          make_pending_pool_entry( const signed_transaction& trx,
+                                                                                 const share_type& fees )const;
+            void                                        add_to_pending_pool( const transaction_id_type& trx_id,
+                                                                             const pending_pool_entry& entry );
+            void                                        remove_from_pending_pool( const transaction_id_type& trx_id );
+            void                                        clear_pending_pool();
+            share_type                                  required_relay_fee( const pending_pool_entry& entry )const;
+            uint32_t                                    evict_pending_overflow( const optional<transaction_id_type>& keep_id );
 
             fc::future<void> _revalidate_pending;
             fc::mutex        _push_block_mutex;
@@ -125,6 +182,29 @@ namespace bts { namespace blockchain {
             bool                                                                        _skip_signature_verification;
             share_type                                                                  _relay_fee;
 
+            /**
+             *  The changes each recently applied block made, keyed by block id.  The state a block
+             *  is applied to is fixed by its ancestry, so when a fork switch pops a block and later
+             *  extends it again (including switching back after a failed switch) the delta can be
+             *  applied as is instead of re-evaluating the block.  The recovered signee is kept so the
+             *  header can be checked again against the head it is reapplied on.
+             */
+            struct applied_delta
+            {
+               pending_chain_state_ptr changes;
+               public_key_type         block_signee;
+            };
+            std::unordered_map<block_id_type, applied_delta>                            _applied_delta_cache;
+            std::deque<block_id_type>                                                   _applied_delta_order;
+
+            /**
+             *  Side-branch blocks have their digest checked and signee recovered on a worker thread
+             *  as they arrive, so a later switch to that branch only has to evaluate them.
+             */
+            std::unique_ptr<fc::thread>                                                 _fork_validation_thread;
+            std::unordered_map<block_id_type, fc::future<public_key_type>>              _prevalidated_signees;
+            std::deque<block_id_type>                                                   _prevalidated_order;
+
             bts::db::cached_level_map<uint32_t, std::vector<market_transaction>>        _market_transactions_db;
             bts::db::cached_level_map<slate_id_type, delegate_slate>                    _slate_db;
             bts::db::level_map<uint32_t, std::vector<block_id_type>>                    _fork_number_db;
@@ -140,10 +220,14 @@ namespace bts { namespace blockchain {
 
             // blocks in the current 'official' chain.
             bts::db::level_map<uint32_t,block_id_type>                                  _block_num_to_id_db;
+            /** in-memory copy of _block_num_to_id_db, block n is at index n - 1 */
+            std::vector<block_id_type>                                                  _main_chain_block_ids;
             // all blocks from any fork..
             bts::db::level_map<block_id_type,block_record>                              _block_id_to_block_record_db;
 
             bts::db::level_map<block_id_type,full_block>                                _block_id_to_block_data_db;
+            // compact filters over the addresses each block touches, for wallet rescans
+            bts::db::level_map<block_id_type,address_filter>                            _address_filter_db;
 
             std::unordered_set<transaction_id_type>                                     _known_transactions;
             bts::db::level_map<transaction_id_type,transaction_record>                  _id_to_transaction_record_db;
@@ -154,10 +238,35 @@ namespace bts { namespace blockchain {
             bts::db::level_map<transaction_id_type, signed_transaction>                 _pending_transaction_db;
             std::map<fee_index, transaction_evaluation_state_ptr>                       _pending_fee_index;
 
+            /**
+             *  Size, fee and withdrawn balances of each pending transaction.  The pool is capped at
+             *  _pending_pool_max_bytes by evicting the lowest fee per kilobyte first, and no single
+             *  balance may be withdrawn from by more than _pending_pool_max_per_sender transactions.
+             */
+            std::unordered_map<transaction_id_type, pending_pool_entry>                 _pending_pool_entries;
+            std::set<std::pair<int64_t, transaction_id_type>>                           _pending_pool_by_fee_rate;
+            std::unordered_map<balance_id_type, uint32_t>                               _pending_pool_sender_counts;
+            uint64_t                                                                    _pending_pool_bytes = 0;
+            uint64_t                                                                    _pending_pool_max_bytes = BTS_BLOCKCHAIN_MAX_PENDING_POOL_BYTES;
+            uint32_t                                                                    _pending_pool_max_per_sender = BTS_BLOCKCHAIN_MAX_PENDING_PER_SENDER;
+            /**
+             *  Set when transactions were evicted after being applied to _pending_trx_state.  The state
+             *  is rebuilt once by the deferred revalidate_pending task, and until then intake must
+             *  outbid the cheapest pending transaction.
+             */
+            bool                                                                        _pending_pool_dirty = false;
+            /** transactions evaluated against the pending state, for measuring intake cost */
+            uint64_t                                                                    _pending_evaluation_count = 0;
+
             bts::db::cached_level_map<asset_id_type, asset_record>                      _asset_db;
             bts::db::cached_level_map<string, asset_id_type>                            _symbol_index_db;
 
             bts::db::level_map<balance_id_type, balance_record>                         _balance_db;
+            /** (owner, balance id) pairs over _balance_db, maintained by store_balance_record */
+            bts::db::level_map<std::pair<address, balance_id_type>, int>                _owner_balance_index_db;
+            /** genesis balances never touched since genesis, maintained by store_balance_record; the total is summed on open */
+            bts::db::level_map<balance_id_type, share_type>                             _unclaimed_genesis_balance_db;
+            share_type                                                                  _unclaimed_genesis_total = 0;
 
             bts::db::level_map<burn_record_key, burn_record_value>                      _burn_db;
 
@@ -168,11 +277,24 @@ namespace bts { namespace blockchain {
             bts::db::cached_level_map<vote_del, int>                                    _delegate_vote_index_db;
 
             bts::db::level_map<time_point_sec, slot_record>                             _slot_record_db;
+            /** main chain blocks keyed by (producing delegate, block number) */
+            bts::db::level_map<std::pair<account_id_type,uint32_t>, block_id_type>      _delegate_block_index_db;
+
+            /**
+             *  Rolling production statistics folded in from the slot records of each block as it joins the
+             *  main chain, unwound when it's popped, and rebuilt from _slot_record_db on open.  Each ranking
+             *  index orders delegates by (reliability in basis points, id) over the matching window.
+             */
+            vector<uint32_t>                                                            _delegate_reliability_windows = BTS_BLOCKCHAIN_DELEGATE_RELIABILITY_WINDOWS;
+            std::unordered_map<account_id_type, delegate_production_tracker>            _delegate_production;
+            vector<std::set<std::pair<uint32_t, account_id_type>>>                      _delegate_reliability_index;
 
             bts::db::cached_level_map<market_index_key, order_record>                   _ask_db;
             bts::db::cached_level_map<market_index_key, order_record>                   _bid_db;
             bts::db::cached_level_map<market_index_key, order_record>                   _short_db;
             bts::db::cached_level_map<market_index_key, collateral_record>              _collateral_db;
+            /** secondary index over _collateral_db, maintained by store_collateral_record */
+            bts::db::level_map<expiration_index, int>                                   _collateral_expiration_index_db;
             bts::db::cached_level_map<feed_index, feed_record>                          _feed_db;
 
             bts::db::cached_level_map<std::pair<asset_id_type,asset_id_type>, market_status> _market_status_db;
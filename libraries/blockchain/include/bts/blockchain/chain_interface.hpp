@@ -9,6 +9,8 @@
 #include <bts/blockchain/feed_operations.hpp>
 #include <bts/blockchain/types.hpp>
 
+#include <unordered_set>
+
 namespace bts { namespace blockchain {
 
    enum chain_property_enum
@@ -39,6 +41,27 @@ namespace bts { namespace blockchain {
    };
    typedef uint32_t chain_property_type;
 
+   /**
+    *  Decoded copies of the chain properties that are read inside per-block, per-feed and
+    *  per-market loops, so they aren't converted from their fc::variant form on every call.
+    *
+    *  Each chain_interface only caches the values it stores itself and drops an entry whenever
+    *  set_property() touches it; a pending_chain_state that hasn't set a property defers to the
+    *  cache of its previous state.
+    */
+   struct chain_property_cache
+   {
+      optional<vector<account_id_type>>                             active_delegates;
+      /** same ids as active_delegates, for constant time membership tests */
+      std::unordered_set<account_id_type>                           active_delegate_set;
+      optional<std::set<std::pair<asset_id_type, asset_id_type>>>   dirty_markets;
+      optional<int64_t>                                             required_confirmations;
+      optional<fc::ripemd160>                                       random_seed;
+
+      void invalidate( chain_property_enum property_id );
+      void clear() { *this = chain_property_cache(); }
+   };
+
    const static uint32_t MAX_RECENT_OPERATIONS = 20;
 
    /**
@@ -60,9 +83,9 @@ namespace bts { namespace blockchain {
          share_type                         get_delegate_registration_fee( uint8_t pay_rate )const;
          share_type                         get_asset_registration_fee( uint8_t symbol_length )const;
 
-         std::vector<account_id_type>       get_active_delegates()const;
+         virtual std::vector<account_id_type> get_active_delegates()const;
          void                               set_active_delegates( const std::vector<account_id_type>& id );
-         bool                               is_active_delegate( const account_id_type& id )const;
+         virtual bool                       is_active_delegate( const account_id_type& id )const;
 
          /** converts an asset + asset_id to a more friendly representation using the symbol name */
          string                             to_pretty_asset( const asset& a )const;
@@ -183,6 +206,11 @@ namespace bts { namespace blockchain {
          virtual std::set<std::pair<asset_id_type, asset_id_type>> get_dirty_markets()const;
 
          virtual void                       set_market_transactions( vector<market_transaction> trxs )      = 0;
+
+      protected:
+         void                               load_active_delegates()const;
+
+         mutable chain_property_cache       _property_cache;
    };
    typedef std::shared_ptr<chain_interface> chain_interface_ptr;
 
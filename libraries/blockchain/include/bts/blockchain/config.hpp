@@ -11,7 +11,7 @@
  *  @brief Defines global constants that determine blockchain behavior
  */
 #define BTS_BLOCKCHAIN_VERSION                              1
-#define BTS_BLOCKCHAIN_DATABASE_VERSION                     152
+#define BTS_BLOCKCHAIN_DATABASE_VERSION                     155
 
 /**
  *  The address prepended to string representation of
@@ -40,6 +40,8 @@
 #define BTS_BLOCKCHAIN_MAX_SLATE_SIZE                       (BTS_BLOCKCHAIN_NUM_DELEGATES + (BTS_BLOCKCHAIN_NUM_DELEGATES/10))
 #define BTS_BLOCKCHAIN_MIN_FEEDS                            ((BTS_BLOCKCHAIN_NUM_DELEGATES/2) + 1)
 #define BTS_BLOCKCHAIN_MAX_UNDO_HISTORY                     (BTS_BLOCKCHAIN_NUM_DELEGATES*4)
+/** number of recently applied block deltas and prevalidated side-branch blocks kept to speed up fork switches */
+#define BTS_BLOCKCHAIN_FORK_CACHE_SIZE                      64
 
 #define BTS_BLOCKCHAIN_ENABLE_NEGATIVE_VOTES                false
 
@@ -52,6 +54,16 @@
  */
 #define BTS_MIN_DELEGATE_CONNECTION_COUNT                   1
 
+/**
+ * A delegate logs a warning when the time from starting to build its block until
+ * BTS_BLOCKCHAIN_PRODUCTION_ACKNOWLEDGEMENT_PEERS peers have acknowledged it passes
+ * this fraction of the block interval.  Production timings are kept for the last
+ * BTS_BLOCKCHAIN_PRODUCTION_HISTORY_SIZE blocks the delegate produced.
+ */
+#define BTS_BLOCKCHAIN_PRODUCTION_WARNING_FRACTION          0.5
+#define BTS_BLOCKCHAIN_PRODUCTION_ACKNOWLEDGEMENT_PEERS     3
+#define BTS_BLOCKCHAIN_PRODUCTION_HISTORY_SIZE              100
+
 /**
  * Defines the number of seconds that should elapse between blocks
  */
@@ -113,6 +125,16 @@
 /** defines the maximum block size allowed, 2 MB per hour */
 #define BTS_BLOCKCHAIN_MAX_BLOCK_SIZE                       (10 * BTS_BLOCKCHAIN_AVERAGE_TRX_SIZE * BTS_BLOCKCHAIN_MAX_PENDING_QUEUE_SIZE )
 
+/** bytes of pending transactions kept before the lowest fee per kilobyte is evicted */
+#define BTS_BLOCKCHAIN_MAX_PENDING_POOL_BYTES               (64 * BTS_BLOCKCHAIN_MAX_BLOCK_SIZE)
+/** pending transactions allowed to withdraw from the same balance */
+#define BTS_BLOCKCHAIN_MAX_PENDING_PER_SENDER               16
+/** the relay fee rises linearly from 1x at half full to this multiple when the pool is full */
+#define BTS_BLOCKCHAIN_MAX_RELAY_FEE_MULTIPLIER             10
+
+/** default windows, counted in a delegate's own slots, over which its production reliability is tracked */
+#define BTS_BLOCKCHAIN_DELEGATE_RELIABILITY_WINDOWS         { 10, 100 }
+
 /**
     This constant defines the number of blocks a delegate must produce before
     they are expected to break even on registration costs with their earned income.
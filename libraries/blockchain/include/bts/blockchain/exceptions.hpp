@@ -84,6 +84,7 @@ namespace bts { namespace blockchain {
    FC_DECLARE_DERIVED_EXCEPTION( negative_fee,                      bts::blockchain::evaluation_error, 36003, "negative fee" );
    FC_DECLARE_DERIVED_EXCEPTION( missing_deposit,                   bts::blockchain::evaluation_error, 36004, "missing deposit" );
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_relay_fee,            bts::blockchain::evaluation_error, 36005, "insufficient relay fee" );
+   FC_DECLARE_DERIVED_EXCEPTION( pending_sender_limit,              bts::blockchain::evaluation_error, 36006, "too many pending transactions from sender" );
 
    FC_DECLARE_DERIVED_EXCEPTION( invalid_market,                    bts::blockchain::evaluation_error, 37001, "invalid market" );
    FC_DECLARE_DERIVED_EXCEPTION( unknown_market_order,              bts::blockchain::evaluation_error, 37002, "unknown market order" );
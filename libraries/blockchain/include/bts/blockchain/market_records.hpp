@@ -209,6 +209,32 @@ namespace bts { namespace blockchain {
    };
    typedef fc::optional<collateral_record> ocollateral_record;
 
+   /**
+    *  Orders margin positions within each market by expiration so the ones that are due
+    *  can be found without walking the whole collateral table.  The collateral table
+    *  itself is already ordered by (market, call price).
+    */
+   struct expiration_index
+   {
+      expiration_index(){}
+      expiration_index( const market_index_key& k, const time_point_sec& exp )
+      :quote_id(k.order_price.quote_asset_id),base_id(k.order_price.base_asset_id),expiration(exp),key(k){}
+
+      asset_id_type       quote_id;
+      asset_id_type       base_id;
+      time_point_sec      expiration;
+      market_index_key    key;
+
+      friend bool operator == ( const expiration_index& a, const expiration_index& b )
+      {
+         return std::tie(a.quote_id, a.base_id, a.expiration, a.key) == std::tie(b.quote_id, b.base_id, b.expiration, b.key);
+      }
+      friend bool operator < ( const expiration_index& a, const expiration_index& b )
+      {
+         return std::tie(a.quote_id, a.base_id, a.expiration, a.key) < std::tie(b.quote_id, b.base_id, b.expiration, b.key);
+      }
+   };
+
    struct market_status
    {
        market_status(){} // Null case
@@ -274,6 +300,7 @@ FC_REFLECT( bts::blockchain::market_history_key, (quote_id)(base_id)(granularity
 FC_REFLECT( bts::blockchain::market_history_point, (timestamp)(highest_bid)(lowest_ask)(opening_price)(closing_price)(volume) )
 FC_REFLECT( bts::blockchain::order_record, (balance)(short_price_limit)(last_update) )
 FC_REFLECT( bts::blockchain::collateral_record, (collateral_balance)(payoff_balance)(interest_rate)(expiration) )
+FC_REFLECT( bts::blockchain::expiration_index, (quote_id)(base_id)(expiration)(key) )
 FC_REFLECT( bts::blockchain::market_order, (type)(market_index)(state)(collateral)(interest_rate)(expiration) )
 FC_REFLECT_TYPENAME( std::vector<bts::blockchain::market_transaction> )
 FC_REFLECT_TYPENAME( bts::blockchain::market_history_key::time_granularity_enum ) // http://en.wikipedia.org/wiki/Voodoo_programminqg
@@ -13,6 +13,14 @@ namespace bts { namespace blockchain {
 
          void                           set_prev_state( chain_interface_ptr prev_state );
 
+         /**
+          *  Empties every change so the same state can be reused as the overlay for the next
+          *  transaction of a block-building or validation pass.  The hash tables keep their
+          *  bucket arrays, so reusing an overlay avoids rebuilding a score of containers for
+          *  every transaction.
+          */
+         void                           reset( chain_interface_ptr prev_state );
+
          fc::ripemd160                  get_current_random_seed()const override;
 
          virtual void                   set_feed( const feed_record&  ) override;
@@ -74,6 +82,11 @@ namespace bts { namespace blockchain {
          virtual variant                get_property( chain_property_enum property_id )const override;
          virtual void                   set_property( chain_property_enum property_id, const variant& property_value )override;
 
+         virtual vector<account_id_type> get_active_delegates()const override;
+         virtual bool                   is_active_delegate( const account_id_type& id )const override;
+         virtual int64_t                get_required_confirmations()const override;
+         virtual std::set<std::pair<asset_id_type, asset_id_type>> get_dirty_markets()const override;
+
          virtual void                   store_slot_record( const slot_record& r ) override;
          virtual oslot_record           get_slot_record( const time_point_sec& start_time )const override;
 
@@ -7,6 +7,18 @@ namespace bts { namespace blockchain {
    class chain_interface;
    typedef shared_ptr<chain_interface> chain_interface_ptr;
 
+   /**
+    *  The checks on a transaction that don't depend on chain state: size, expiration window,
+    *  id and signature recovery.  Computing these touches nothing shared, so it can be done
+    *  on a worker thread before the transaction is evaluated on the chain thread.
+    */
+   struct transaction_precheck
+   {
+      transaction_id_type       id;
+      uint32_t                  size = 0;
+      unordered_set<address>    signed_keys;
+   };
+
    /**
     *  While evaluating a transaction there is a lot of intermediate
     *  state that must be tracked.  Any shares withdrawn from the
@@ -32,7 +44,15 @@ namespace bts { namespace blockchain {
 
          virtual void reset();
 
-         virtual void evaluate( const signed_transaction& trx, bool skip_signature_check = false );
+         /** precheck, when given, must come from precheck() on the same transaction and chain id */
+         virtual void evaluate( const signed_transaction& trx, bool skip_signature_check = false,
+                                const transaction_precheck* precheck = nullptr );
+         /**
+          *  throws if the transaction fails a stateless check; safe to call from any thread, so the
+          *  caller reads the clock once and passes it in as now
+          */
+         static transaction_precheck precheck( const signed_transaction& trx, const digest_type& chain_id,
+                                               const fc::time_point_sec& now );
          virtual void evaluate_operation( const operation& op );
 
          /** perform any final operations based upon the current state of
@@ -128,6 +148,8 @@ namespace bts { namespace blockchain {
 
          // not serialized
          chain_interface*                           _current_state;
+         /** keeps _current_state alive when this evaluation outlives the call that created its state */
+         shared_ptr<chain_interface>                _owned_state;
          digest_type                                _chain_id;
          bool                                       _skip_signature_check = false;
 
@@ -22,6 +22,33 @@ namespace bts { namespace blockchain {
       _prev_state = prev_state;
    }
 
+   void pending_chain_state::reset( chain_interface_ptr prev_state )
+   {
+      _prev_state = prev_state;
+      market_transactions.clear();
+      assets.clear();
+      slates.clear();
+      accounts.clear();
+      balances.clear();
+      account_id_index.clear();
+      symbol_id_index.clear();
+      transactions.clear();
+      properties.clear();
+      _property_cache.clear();
+      key_to_account.clear();
+      bids.clear();
+      asks.clear();
+      shorts.clear();
+      collateral.clear();
+      slots.clear();
+      market_history.clear();
+      market_statuses.clear();
+      recent_operations.clear();
+      feeds.clear();
+      burns.clear();
+      _dirty_markets.clear();
+   }
+
    uint32_t pending_chain_state::get_head_block_num()const
    {
       const chain_interface_ptr prev_state = _prev_state.lock();
@@ -364,9 +391,45 @@ namespace bts { namespace blockchain {
    void pending_chain_state::set_property( chain_property_enum property_id,
                                                      const fc::variant& property_value )
    {
+      _property_cache.invalidate( property_id );
       properties[property_id] = property_value;
    }
 
+   // the decoded property getters use this state's cache only for properties it has overridden,
+   // everything else comes from (and is cached by) the previous state
+
+   vector<account_id_type> pending_chain_state::get_active_delegates()const
+   {
+      if( properties.count( active_delegate_list_id ) ) return chain_interface::get_active_delegates();
+      const chain_interface_ptr prev_state = _prev_state.lock();
+      FC_ASSERT( prev_state );
+      return prev_state->get_active_delegates();
+   }
+
+   bool pending_chain_state::is_active_delegate( const account_id_type& id )const
+   {
+      if( properties.count( active_delegate_list_id ) ) return chain_interface::is_active_delegate( id );
+      const chain_interface_ptr prev_state = _prev_state.lock();
+      FC_ASSERT( prev_state );
+      return prev_state->is_active_delegate( id );
+   }
+
+   int64_t pending_chain_state::get_required_confirmations()const
+   {
+      if( properties.count( confirmation_requirement ) ) return chain_interface::get_required_confirmations();
+      const chain_interface_ptr prev_state = _prev_state.lock();
+      FC_ASSERT( prev_state );
+      return prev_state->get_required_confirmations();
+   }
+
+   std::set<std::pair<asset_id_type, asset_id_type>> pending_chain_state::get_dirty_markets()const
+   {
+      if( properties.count( dirty_markets ) ) return chain_interface::get_dirty_markets();
+      const chain_interface_ptr prev_state = _prev_state.lock();
+      if( !prev_state ) return std::set<std::pair<asset_id_type, asset_id_type>>();
+      return prev_state->get_dirty_markets();
+   }
+
 #if 0
    void pending_chain_state::store_proposal_record( const proposal_record& r )
    {
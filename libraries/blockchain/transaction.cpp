@@ -5,6 +5,7 @@
 #include <bts/blockchain/feed_operations.hpp>
 #include <bts/blockchain/time.hpp>
 #include <bts/blockchain/transaction.hpp>
+#include <bts/db/pack_buffer.hpp>
 
 #include <fc/io/raw_variant.hpp>
 
@@ -12,10 +13,10 @@ namespace bts { namespace blockchain {
 
    digest_type transaction::digest( const digest_type& chain_id )const
    {
-      fc::sha256::encoder enc;
-      fc::raw::pack(enc,*this);
-      fc::raw::pack(enc,chain_id);
-      return enc.result();
+      // hash one contiguous pack rather than feeding the encoder field by field
+      bts::db::pack_buffer buffer( *this );
+      buffer.append( chain_id );
+      return fc::sha256::hash( buffer.data(), (uint32_t)buffer.size() );
    }
 
    size_t signed_transaction::data_size()const
@@ -27,9 +28,8 @@ namespace bts { namespace blockchain {
 
    transaction_id_type signed_transaction::id()const
    {
-      fc::sha512::encoder enc;
-      fc::raw::pack(enc,*this);
-      return fc::ripemd160::hash( enc.result() );
+      const bts::db::pack_buffer buffer( *this );
+      return fc::ripemd160::hash( fc::sha512::hash( buffer.data(), (uint32_t)buffer.size() ) );
    }
 
    transaction_id_type signed_transaction::permanent_id()const
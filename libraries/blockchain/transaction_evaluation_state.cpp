@@ -1,5 +1,8 @@
 #include <bts/blockchain/chain_interface.hpp>
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/exceptions.hpp>
 #include <bts/blockchain/operation_factory.hpp>
+#include <bts/blockchain/time.hpp>
 #include <bts/blockchain/transaction_evaluation_state.hpp>
 
 #include <bts/blockchain/fork_blocks.hpp>
@@ -174,7 +177,40 @@ namespace bts { namespace blockchain {
 
    } FC_RETHROW_EXCEPTIONS( warn, "" ) }
 
-   void transaction_evaluation_state::evaluate( const signed_transaction& trx_arg, bool skip_signature_check )
+   namespace detail
+   {
+      void insert_signed_keys( unordered_set<address>& signed_keys, const fc::ecc::public_key_data& key )
+      {
+         signed_keys.insert( address(key) );
+         signed_keys.insert( address(pts_address(key,false,56) ) );
+         signed_keys.insert( address(pts_address(key,true,56) )  );
+         signed_keys.insert( address(pts_address(key,false,0) )  );
+         signed_keys.insert( address(pts_address(key,true,0) )   );
+      }
+   }
+
+   transaction_precheck transaction_evaluation_state::precheck( const signed_transaction& trx, const digest_type& chain_id,
+                                                                const fc::time_point_sec& now )
+   { try {
+      transaction_precheck result;
+      result.size = uint32_t( fc::raw::pack_size( trx ) );
+      if( result.size > BTS_BLOCKCHAIN_MAX_BLOCK_SIZE )
+         FC_CAPTURE_AND_THROW( oversized_transaction, (result.size) );
+
+      if( now >= trx.expiration )
+         FC_CAPTURE_AND_THROW( expired_transaction, (trx.expiration)(now) );
+      if( (now + BTS_BLOCKCHAIN_MAX_TRANSACTION_EXPIRATION_SEC) < trx.expiration )
+         FC_CAPTURE_AND_THROW( invalid_transaction_expiration, (trx.expiration)(now) );
+
+      result.id = trx.id();
+      const auto digest = trx.digest( chain_id );
+      for( const auto& sig : trx.signatures )
+         detail::insert_signed_keys( result.signed_keys, fc::ecc::public_key( sig, digest ).serialize() );
+      return result;
+   } FC_CAPTURE_AND_RETHROW( (trx)(now) ) }
+
+   void transaction_evaluation_state::evaluate( const signed_transaction& trx_arg, bool skip_signature_check,
+                                                const transaction_precheck* precheck )
    { try {
       reset();
       _skip_signature_check = skip_signature_check;
@@ -190,7 +226,7 @@ namespace bts { namespace blockchain {
         if( (_current_state->now() + BTS_BLOCKCHAIN_MAX_TRANSACTION_EXPIRATION_SEC) < trx_arg.expiration )
            FC_CAPTURE_AND_THROW( invalid_transaction_expiration, (trx_arg)(_current_state->now()) );
 
-        auto trx_id = trx_arg.id();
+        auto trx_id = precheck != nullptr ? precheck->id : trx_arg.id();
 
         if( _current_state->is_known_transaction( trx_id ) )
            FC_CAPTURE_AND_THROW( duplicate_transaction, (trx_id) );
@@ -198,15 +234,15 @@ namespace bts { namespace blockchain {
         trx = trx_arg;
         if( !_skip_signature_check )
         {
-           auto digest = trx_arg.digest( _chain_id );
-           for( const auto& sig : trx.signatures )
+           if( precheck != nullptr )
+           {
+              signed_keys = precheck->signed_keys;
+           }
+           else
            {
-              auto key = fc::ecc::public_key( sig, digest ).serialize();
-              signed_keys.insert( address(key) );
-              signed_keys.insert( address(pts_address(key,false,56) ) );
-              signed_keys.insert( address(pts_address(key,true,56) )  );
-              signed_keys.insert( address(pts_address(key,false,0) )  );
-              signed_keys.insert( address(pts_address(key,true,0) )   );
+              auto digest = trx_arg.digest( _chain_id );
+              for( const auto& sig : trx.signatures )
+                 detail::insert_signed_keys( signed_keys, fc::ecc::public_key( sig, digest ).serialize() );
            }
         }
         _current_op_index = 0;
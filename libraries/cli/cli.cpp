@@ -63,6 +63,7 @@ namespace bts { namespace cli {
             bool                                            _quit;
             bool                                            show_raw_output;
             bool                                            _daemon_mode;
+            bool                                            _batch_mode;
 
             boost::iostreams::stream< boost::iostreams::null_sink > nullstream;
 
@@ -77,14 +78,20 @@ namespace bts { namespace cli {
             cli_impl(bts::client::client* client, std::istream* command_script, std::ostream* output_stream);
 
             void process_commands(std::istream* input_stream);
+            void process_batch(std::istream* input_stream);
 
             void start()
             {
                 try
                 {
-                  if (_command_script)
+                  if (_batch_mode)
+                  {
+                    process_batch(_command_script ? _command_script : &std::cin);
+                    _quit = true;
+                  }
+                  else if (_command_script)
                     process_commands(_command_script);
-                  if (_daemon_mode)
+                  if (_daemon_mode && !_batch_mode)
                   {
                     _rpc_server->wait_till_rpc_server_shutdown();
                     return;
@@ -191,8 +198,9 @@ namespace bts { namespace cli {
               }
             } //parse_and_execute_interactive_command
 
-            bool execute_command_line(const string& line)
-            { try {
+            /** splits a command line into the command name and a stream holding its arguments */
+            static string split_command_line(const string& line, fc::istream_ptr& argument_stream)
+            {
               string trimmed_line_to_parse(boost::algorithm::trim_copy(line));
               /**
                *  On some OS X systems, std::stringstream gets corrupted and does not throw eof
@@ -203,36 +211,34 @@ namespace bts { namespace cli {
                *  @todo figure out how to fix things on these OS X systems.
                */
               trimmed_line_to_parse += string(" ") + char(0x04);
-              if (!trimmed_line_to_parse.empty())
+              string::const_iterator iter = std::find_if(trimmed_line_to_parse.begin(), trimmed_line_to_parse.end(), ::isspace);
+              if (iter != trimmed_line_to_parse.end())
               {
-                string::const_iterator iter = std::find_if(trimmed_line_to_parse.begin(), trimmed_line_to_parse.end(), ::isspace);
-                string command;
-                fc::istream_ptr argument_stream;
-                if (iter != trimmed_line_to_parse.end())
-                {
-                  // then there are arguments to this function
-                  size_t first_space_pos = iter - trimmed_line_to_parse.begin();
-                  command = trimmed_line_to_parse.substr(0, first_space_pos);
-                  argument_stream = std::make_shared<fc::stringstream>((trimmed_line_to_parse.substr(first_space_pos + 1)));
-                }
-                else
-                {
-                  command = trimmed_line_to_parse;
-                  argument_stream = std::make_shared<fc::stringstream>();
-                }
-                try
-                {
-                  parse_and_execute_interactive_command(command,argument_stream);
-                }
-                catch (const bts::cli::exit_cli_command&)
-                {
-                  return false;
-                }
-                catch( const bts::cli::abort_cli_command& )
-                {
-                  *_out << "Command aborted\n";
-                }
-              } //end if command line not empty
+                // then there are arguments to this function
+                size_t first_space_pos = iter - trimmed_line_to_parse.begin();
+                argument_stream = std::make_shared<fc::stringstream>((trimmed_line_to_parse.substr(first_space_pos + 1)));
+                return trimmed_line_to_parse.substr(0, first_space_pos);
+              }
+              argument_stream = std::make_shared<fc::stringstream>();
+              return trimmed_line_to_parse;
+            }
+
+            bool execute_command_line(const string& line)
+            { try {
+              fc::istream_ptr argument_stream;
+              string command = split_command_line(line, argument_stream);
+              try
+              {
+                parse_and_execute_interactive_command(command,argument_stream);
+              }
+              catch (const bts::cli::exit_cli_command&)
+              {
+                return false;
+              }
+              catch( const bts::cli::abort_cli_command& )
+              {
+                *_out << "Command aborted\n";
+              }
               return true;
             } FC_RETHROW_EXCEPTIONS( warn, "", ("command",line) ) }
 
@@ -329,6 +335,12 @@ namespace bts { namespace cli {
 
                 if (parse_argument_threw_eof)
                 {
+                  // batch input has no one to answer a prompt, and the next line would be taken as the answer
+                  if (_batch_mode && (method_data.parameters[i].classification == bts::api::required_positional ||
+                                      method_data.parameters[i].classification == bts::api::required_positional_hidden))
+                    FC_THROW("Missing argument ${argument_number} (${name}) of command \"${command}\"; batch mode never prompts",
+                             ("argument_number", i + 1)("name", method_data.parameters[i].name)("command", method_data.name));
+
                   if (method_data.parameters[i].classification != bts::api::required_positional)
                   {
                     return arguments;
@@ -538,10 +550,12 @@ namespace bts { namespace cli {
                 }
                 catch( const rpc_wallet_open_needed_exception& )
                 {
+                  if( _batch_mode ) throw;
                   wallet_open_needed = true;
                 }
                 catch( const rpc_wallet_unlock_needed_exception& )
                 {
+                  if( _batch_mode ) throw;
                   wallet_lock_needed = true;
                 }
 
@@ -682,6 +696,8 @@ namespace bts { namespace cli {
             method_alias_map_type _method_alias_map;
             method_alias_map_type::iterator _command_completion_generator_iter;
             bool _method_data_is_initialized;
+            bool _readline_is_initialized;
+            void initialize_readline_if_necessary();
             void initialize_method_data_if_necessary();
             char* json_command_completion_generator(const char* text, int state);
             char* json_argument_completion_generator(const char* text, int state);
@@ -703,25 +719,35 @@ namespace bts { namespace cli {
     ,_quit(false)
     ,show_raw_output(false)
     ,_daemon_mode(false)
+    ,_batch_mode(false)
     ,nullstream(boost::iostreams::null_sink())
     , _saved_out(nullptr)
     ,_out(output_stream ? output_stream : &nullstream)
     ,_command_script(command_script)
     {
 #ifdef HAVE_READLINE
-      //if( &output_stream == &std::cout ) // readline
+      _readline_is_initialized = false;
+      _method_data_is_initialized = false;
+#endif
+    }
+
+#ifdef HAVE_READLINE
+    // deferred until we actually read from the console, batch mode never needs completion
+    void cli_impl::initialize_readline_if_necessary()
+    {
+      if (!_readline_is_initialized)
       {
+         _readline_is_initialized = true;
          cli_impl_instance = this;
-         _method_data_is_initialized = false;
          rl_attempted_completion_function = &json_completion_function;
          rl_getc_function = &get_character;
-      }
 #ifndef __APPLE__
-      // TODO: find out why this isn't defined on APPL
-      //rl_bind_keyseq("\\C-c", &control_c_handler);
-#endif
+         // TODO: find out why this isn't defined on APPL
+         //rl_bind_keyseq("\\C-c", &control_c_handler);
 #endif
+      }
     }
+#endif
 
 #ifdef HAVE_READLINE
     void cli_impl::initialize_method_data_if_necessary()
@@ -832,7 +858,7 @@ namespace bts { namespace cli {
 #endif
     void cli_impl::display_status_message(const std::string& message)
     {
-      if( !_input_stream || !_out || _daemon_mode )
+      if( !_input_stream || !_out || _daemon_mode || _batch_mode )
         return;
 #ifdef HAVE_READLINE
       if (rl_prompt)
@@ -867,6 +893,9 @@ namespace bts { namespace cli {
     {  try {
       FC_ASSERT( input_stream != nullptr );
       _input_stream = input_stream;
+#ifdef HAVE_READLINE
+      initialize_readline_if_necessary();
+#endif
       //force flushing to console and log file whenever input is read
       _input_stream->tie( _out );
       string line = get_line(get_prompt());
@@ -880,6 +909,80 @@ namespace bts { namespace cli {
       wlog( "process commands exiting" );
     }  FC_CAPTURE_AND_RETHROW() }
 
+    /**
+     *  Reads one command per line, either in CLI syntax or as a JSON object
+     *  {"id":..., "method":..., "params":[...]}, runs them one after another and
+     *  writes one compact JSON response per line.  Results are never table
+     *  formatted, and a command missing a required argument, a passphrase
+     *  included, fails instead of prompting for it.
+     */
+    void cli_impl::process_batch(std::istream* input_stream)
+    {  try {
+      FC_ASSERT( input_stream != nullptr );
+      _input_stream = input_stream;
+
+      uint64_t line_number = 0;
+      string line;
+      while (!_quit && _cin_thread.async([&](){ return bool(std::getline(*_input_stream, line)); }, "getline").wait())
+      {
+        ++line_number;
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+          continue;
+
+        fc::variant id = line_number;
+        string command;
+        fc::variants arguments;
+        fc::optional<fc::exception> parse_error;
+        try
+        {
+          if (line[0] == '{')
+          {
+            const fc::variant_object request = fc::json::from_string(line).get_object();
+            if (request.contains("id"))
+              id = request["id"];
+            command = request["method"].as_string();
+            if (request.contains("params"))
+              arguments = request["params"].as<fc::variants>();
+          }
+          else
+          {
+            fc::istream_ptr argument_stream;
+            command = split_command_line(line, argument_stream);
+            fc::buffered_istream buffered_argument_stream(argument_stream);
+            arguments = _self->parse_interactive_command(buffered_argument_stream, command);
+          }
+        }
+        catch (const fc::exception& e)
+        {
+          parse_error = e;
+        }
+        if (command == "quit" || command == "stop" || command == "exit")
+          break;
+
+        fc::mutable_variant_object response;
+        response["id"] = id;
+        try
+        {
+          if (parse_error)
+            parse_error->dynamic_rethrow_exception();
+          // execute_script reads its follow-up commands from the console
+          FC_ASSERT( command != "execute_script", "execute_script is not available in batch mode" );
+          response["result"] = _rpc_server->direct_invoke_method(command, arguments);
+        }
+        catch (const fc::exception& e)
+        {
+          fc::mutable_variant_object error;
+          error["code"] = e.code();
+          error["message"] = e.to_string();
+          response["error"] = error;
+        }
+        *_out << fc::json::to_string(response) << "\n";
+        _out->flush();
+      }
+      wlog( "process batch exiting" );
+    }  FC_CAPTURE_AND_RETHROW() }
+
   } // end namespace detail
 
    cli::cli( bts::client::client* client, std::istream* command_script, std::ostream* output_stream)
@@ -896,6 +999,9 @@ namespace bts { namespace cli {
   //disable reading from std::cin
   void cli::set_daemon_mode(bool daemon_mode) { my->_daemon_mode = daemon_mode; }
 
+  //read the command script or std::cin as a batch and exit
+  void cli::set_batch_mode(bool batch_mode) { my->_batch_mode = batch_mode; }
+
   void cli::display_status_message(const std::string& message)
   {
     if (my)
@@ -908,6 +1014,12 @@ namespace bts { namespace cli {
     my->process_commands(input_stream);
   }
 
+  void cli::process_batch(std::istream* input_stream)
+  {
+    ilog( "starting to process batch commands" );
+    my->process_batch(input_stream);
+  }
+
   cli::~cli()
   {
     try
@@ -37,8 +37,11 @@ namespace bts { namespace cli {
 
           void set_input_stream_log(boost::optional<std::ostream&> input_stream_log);
           void set_daemon_mode(bool enable_daemon_mode);
+          void set_batch_mode(bool enable_batch_mode);
           void display_status_message(const std::string& message);
           void process_commands(std::istream* input_stream);
+          // newline-delimited commands in, one compact JSON response per line out
+          void process_batch(std::istream* input_stream);
           void enable_output(bool enable_output);
           void filter_output_for_tests(bool enable_flag);
 
@@ -400,6 +400,28 @@ vector<market_order>    client_impl::blockchain_market_list_covers( const string
    return _chain_db->get_market_covers( quote_symbol, limit );
 }
 
+vector<market_order>    client_impl::blockchain_market_list_due_covers( const string& quote_symbol,
+                                                                        uint32_t limit )const
+{
+   const asset_id_type quote_id = _chain_db->get_asset_id( quote_symbol );
+   const asset_id_type base_id = 0;
+
+   vector<market_order> due_covers = _chain_db->get_expired_covers( quote_id, base_id, _chain_db->now(), limit );
+   const oprice feed_price = _chain_db->get_median_delegate_price( quote_id, base_id );
+   if( feed_price.valid() && due_covers.size() < limit )
+   {
+      for( const market_order& cover : _chain_db->get_covers_called_at( quote_id, base_id, *feed_price, limit ) )
+      {
+         if( due_covers.size() >= limit )
+            break;
+         if( cover.expiration.valid() && *cover.expiration <= _chain_db->now() )
+            continue; // already listed as expired
+         due_covers.push_back( cover );
+      }
+   }
+   return due_covers;
+}
+
 share_type              client_impl::blockchain_market_get_asset_collateral( const string& symbol )
 {
    return _chain_db->get_asset_collateral( symbol );
@@ -478,6 +500,21 @@ vector<slot_record> client_impl::blockchain_get_delegate_slot_records( const str
    return _chain_db->get_delegate_slot_records( delegate_record->id, start_block_num, count );
 }
 
+vector<block_record> client_impl::blockchain_get_delegate_blocks( const string& delegate_name,
+                                                                  uint32_t start_block_num, uint32_t count )const
+{
+   FC_ASSERT( count <= 1000 );
+   const auto delegate_record = _chain_db->get_account_record( delegate_name );
+   FC_ASSERT( delegate_record.valid() && delegate_record->is_delegate(), "${n} is not a delegate!", ("n",delegate_name) );
+   return _chain_db->get_delegate_produced_blocks( delegate_record->id, start_block_num, count );
+}
+
+vector<delegate_production_stats> client_impl::blockchain_list_delegates_by_reliability( uint32_t window, uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+   return _chain_db->get_delegates_by_reliability( window, limit );
+}
+
 string client_impl::blockchain_get_block_signee( const string& block )const
 {
    if( block.size() == 40 )
@@ -3,6 +3,7 @@
 #include <bts/client/client.hpp>
 #include <bts/client/client_impl.hpp>
 #include <bts/client/messages.hpp>
+#include <bts/net/config.hpp>
 #include <bts/net/exceptions.hpp>
 #include <bts/net/chain_downloader.hpp>
 #include <bts/blockchain/chain_database.hpp>
@@ -48,7 +49,9 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <limits>
 #include <set>
+#include <thread>
 
 using namespace boost;
 using std::string;
@@ -117,9 +120,12 @@ program_options::variables_map parse_option_variables(int argc, char** argv)
          ("connect-to", program_options::value<std::vector<string> >(), "Set a remote host to connect to")
          ("disable-default-peers", "Disable automatic connection to default peers")
          ("disable-peer-advertising", "Don't let any peers know which other nodes we're connected to")
+         ("delegate-relay-peer", program_options::value<std::vector<string> >(),
+          "Join the delegate relay overlay, keeping a persistent connection to this delegate's node")
 
          ("server", "Enable JSON-RPC server")
          ("daemon", "Run in daemon mode with no CLI and start JSON-RPC server")
+         ("batch", "Execute newline-delimited commands from stdin, print one JSON result per line and exit")
 
          ("rpcuser", program_options::value<string>(), "Set username for JSON-RPC")
          ("rpcpassword", program_options::value<string>(), "Set password for JSON-RPC")
@@ -549,6 +555,8 @@ void client_impl::cancel_delegate_loop()
    {
       ilog( "Canceling delegate loop..." );
       _delegate_loop_complete.cancel_and_wait(__FUNCTION__);
+      if( _block_production_timing_check.valid() && !_block_production_timing_check.ready() )
+         _block_production_timing_check.cancel_and_wait(__FUNCTION__);
       ilog( "Delegate loop canceled" );
    }
    catch( const fc::exception& e )
@@ -559,10 +567,12 @@ void client_impl::cancel_delegate_loop()
 
 void client_impl::delegate_loop()
 {
-   if( !_wallet->is_open() || _wallet->is_locked() )
+   update_block_production_timings();
+
+   if( !_primary_wallet->is_open() || _primary_wallet->is_locked() )
       return;
 
-   vector<wallet_account_record> enabled_delegates = _wallet->get_my_delegates( enabled_delegate_status );
+   vector<wallet_account_record> enabled_delegates = _primary_wallet->get_my_delegates( enabled_delegate_status );
    if( enabled_delegates.empty() )
       return;
 
@@ -575,7 +585,7 @@ void client_impl::delegate_loop()
       _delegate_loop_first_run = false;
    }
 
-   const auto next_block_time = _wallet->get_next_producible_block_timestamp( enabled_delegates );
+   const auto next_block_time = _primary_wallet->get_next_producible_block_timestamp( enabled_delegates );
    if( next_block_time.valid() )
    {
       // delegates don't get to skip this check, they must check up on everyone else
@@ -584,7 +594,7 @@ void client_impl::delegate_loop()
 
 #ifndef DISABLE_DELEGATE_NETWORK
       // sign in to delegate server using private keys of my delegates
-      //_delegate_network.signin( _wallet->get_my_delegate( enabled_delegate_status | active_delegate_status ) );
+      //_delegate_network.signin( _primary_wallet->get_my_delegate( enabled_delegate_status | active_delegate_status ) );
 #endif
 
       if( *next_block_time <= now )
@@ -594,13 +604,19 @@ void client_impl::delegate_loop()
             FC_ASSERT( network_get_connection_count() >= _min_delegate_connection_count,
                        "Client must have ${count} connections before you may produce blocks!",
                        ("count",_min_delegate_connection_count) );
-            FC_ASSERT( _wallet->is_unlocked(), "Wallet must be unlocked to produce blocks!" );
+            FC_ASSERT( _primary_wallet->is_unlocked(), "Wallet must be unlocked to produce blocks!" );
             FC_ASSERT( (now - *next_block_time) < fc::seconds( BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC ),
                        "You missed your slot at time: ${t}!", ("t",*next_block_time) );
 
+            block_production_timing timing;
+            timing.start_time = time_point::now();
             full_block next_block = _chain_db->generate_block( *next_block_time );
-            _wallet->sign_block( next_block );
-            on_new_block( next_block, next_block.id(), false );
+            const time_point template_built_time = time_point::now();
+            _primary_wallet->sign_block( next_block );
+            const time_point signed_time = time_point::now();
+            timing.block_id = next_block.id();
+            on_new_block( next_block, timing.block_id, false );
+            const time_point applied_time = time_point::now();
 
 #ifndef DISABLE_DELEGATE_NETWORK
             _delegate_network.broadcast_block( next_block );
@@ -609,6 +625,16 @@ void client_impl::delegate_loop()
 
             _p2p_node->broadcast( block_message( next_block ) );
             ilog( "Produced block #${n}!", ("n",next_block.block_num) );
+
+            _template_build_stage_stats.record( template_built_time - timing.start_time );
+            _signing_stage_stats.record( signed_time - template_built_time );
+            _local_apply_stage_stats.record( applied_time - signed_time );
+            ++_blocks_produced;
+            timing.block_num = next_block.block_num;
+            timing.broadcast_time = applied_time;
+            timing.peers_to_acknowledge = std::min( _config.block_production_acknowledgement_peers, network_get_connection_count() );
+            _unfinished_block_productions.push_back( timing );
+            schedule_block_production_timing_check();
          }
          catch ( const fc::canceled_exception& )
          {
@@ -799,11 +825,248 @@ block_fork_data client_impl::on_new_block(const full_block& block,
    }
 }
 
+void client_impl::intake_stage_stats::record(const fc::microseconds& latency, bool was_accepted)
+{
+   --queue_depth;
+   if (was_accepted)
+      ++accepted;
+   else
+      ++rejected;
+   total_latency += latency;
+   max_latency = std::max(max_latency, latency);
+}
+
+fc::variant client_impl::intake_stage_stats::to_variant()const
+{
+   const uint64_t processed = accepted + rejected;
+   fc::mutable_variant_object result;
+   result["queue_depth"] = queue_depth;
+   result["accepted"] = accepted;
+   result["rejected"] = rejected;
+   result["average_latency_us"] = processed > 0 ? total_latency.count() / int64_t(processed) : 0;
+   result["max_latency_us"] = max_latency.count();
+   return result;
+}
+
+void client_impl::production_stage_histogram::record(const fc::microseconds& latency)
+{
+   recent_latencies.push_back(latency);
+}
+
+fc::variant client_impl::production_stage_histogram::to_variant()const
+{
+   static const int64_t bucket_limits_ms[] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 };
+   static const size_t bucket_count = sizeof(bucket_limits_ms) / sizeof(bucket_limits_ms[0]);
+
+   vector<int64_t> latencies;
+   latencies.reserve(recent_latencies.size());
+   for (const fc::microseconds& latency : recent_latencies)
+      latencies.push_back(latency.count());
+   std::sort(latencies.begin(), latencies.end());
+
+   fc::mutable_variant_object result;
+   result["count"] = latencies.size();
+   if (latencies.empty())
+      return result;
+
+   const auto percentile = [&](double fraction) {
+      return latencies[std::min(latencies.size() - 1, size_t(fraction * latencies.size()))];
+   };
+   int64_t total_latency = 0;
+   for (int64_t latency : latencies)
+      total_latency += latency;
+   result["average_latency_us"] = total_latency / int64_t(latencies.size());
+   result["p50_latency_us"] = percentile(0.50);
+   result["p90_latency_us"] = percentile(0.90);
+   result["p99_latency_us"] = percentile(0.99);
+   result["max_latency_us"] = latencies.back();
+
+   // cumulative counts, so each bucket reads as "this many finished within the limit"
+   fc::mutable_variant_object buckets;
+   auto next_latency = latencies.begin();
+   for (size_t i = 0; i < bucket_count; ++i)
+   {
+      next_latency = std::upper_bound(next_latency, latencies.end(), bucket_limits_ms[i] * 1000);
+      buckets["<=" + fc::to_string(bucket_limits_ms[i]) + "ms"] = uint64_t(next_latency - latencies.begin());
+   }
+   buckets["all"] = latencies.size();
+   result["histogram"] = buckets;
+   return result;
+}
+
+fc::microseconds client_impl::block_production_warning_threshold()const
+{
+   return fc::microseconds(int64_t(BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC * 1000000 * _config.block_production_warning_fraction));
+}
+
+/**
+ *  Moves blocks we produced out of _unfinished_block_productions once enough peers have acknowledged
+ *  them or a block interval has passed since production started, whichever comes first.  A block
+ *  still short of its acknowledgements when the warning threshold passes is warned about right away
+ *  rather than when it is finished.
+ */
+void client_impl::update_block_production_timings()
+{
+   const time_point now = time_point::now();
+   while (!_unfinished_block_productions.empty())
+   {
+      const block_production_timing& timing = _unfinished_block_productions.front();
+      const optional<bts::net::block_delivery_data> delivery = _p2p_node->get_block_delivery_data(timing.block_id);
+      const bool acknowledged = delivery && delivery->peer_acknowledgement_times.size() >= timing.peers_to_acknowledge;
+      if (!acknowledged && now - timing.start_time < fc::seconds(BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC))
+         break;
+      finish_block_production_timing(timing, delivery);
+      _unfinished_block_productions.pop_front();
+   }
+
+   for (block_production_timing& timing : _unfinished_block_productions)
+   {
+      if (timing.warned || now - timing.start_time < block_production_warning_threshold())
+         continue;
+      // without delivery data there is nothing to say until the block is finished
+      const optional<bts::net::block_delivery_data> delivery = _p2p_node->get_block_delivery_data(timing.block_id);
+      if (!delivery || delivery->peer_acknowledgement_times.size() >= timing.peers_to_acknowledge)
+         continue;
+      timing.warned = true;
+      ++_block_production_warnings;
+      _last_block_production_warning = "Block #" + fc::to_string(timing.block_num) + " has reached " +
+                                       fc::to_string(uint64_t(delivery->peer_acknowledgement_times.size())) + " of " +
+                                       fc::to_string(timing.peers_to_acknowledge) + " peers after " +
+                                       fc::to_string((now - timing.start_time).count() / 1000) + " ms, over the " +
+                                       fc::to_string(block_production_warning_threshold().count() / 1000) +
+                                       " ms warning threshold";
+      wlog("${warning}", ("warning", *_last_block_production_warning));
+   }
+
+   schedule_block_production_timing_check();
+}
+
+/** wakes update_block_production_timings when the next unfinished block crosses its warning threshold or deadline */
+void client_impl::schedule_block_production_timing_check()
+{
+   if (_unfinished_block_productions.empty())
+      return;
+
+   time_point next_check = time_point::maximum();
+   for (const block_production_timing& timing : _unfinished_block_productions)
+      next_check = std::min(next_check, timing.warned ? timing.start_time + fc::seconds(BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC)
+                                                      : timing.start_time + block_production_warning_threshold());
+
+   // a check that's still waiting to run early enough can stay; one that's running now is replaced
+   const time_point now = time_point::now();
+   if (_block_production_timing_check.valid() && !_block_production_timing_check.ready() &&
+       _block_production_timing_check_time > now)
+   {
+      if (_block_production_timing_check_time <= next_check)
+         return;
+      _block_production_timing_check.cancel(__FUNCTION__);
+   }
+
+   _block_production_timing_check_time = std::max(next_check, now);
+   _block_production_timing_check = fc::schedule([=](){ update_block_production_timings(); },
+                                                 _block_production_timing_check_time, "block_production_timing_check");
+}
+
+void client_impl::finish_block_production_timing(const block_production_timing& timing,
+                                                 const optional<bts::net::block_delivery_data>& delivery)
+{
+   // without delivery data (the node no longer tracks the block, or it's a simulated network),
+   // only the local stages can be measured
+   optional<fc::microseconds> total_latency;
+   if (!delivery)
+      total_latency = timing.broadcast_time - timing.start_time;
+   else
+   {
+      if (delivery->first_peer_send_time)
+         _first_peer_send_stage_stats.record(*delivery->first_peer_send_time - delivery->broadcast_time);
+      if (timing.peers_to_acknowledge == 0)
+         total_latency = timing.broadcast_time - timing.start_time;
+      else if (delivery->peer_acknowledgement_times.size() >= timing.peers_to_acknowledge)
+      {
+         const time_point acknowledged_time = delivery->peer_acknowledgement_times[timing.peers_to_acknowledge - 1];
+         _peer_acknowledgement_stage_stats.record(acknowledged_time - delivery->broadcast_time);
+         total_latency = acknowledged_time - timing.start_time;
+      }
+      else
+         ++_blocks_not_acknowledged;
+   }
+   if (total_latency)
+      _total_production_stage_stats.record(*total_latency);
+
+   const fc::microseconds warning_threshold = block_production_warning_threshold();
+   if (timing.warned || (total_latency && *total_latency < warning_threshold))
+      return;
+
+   ++_block_production_warnings;
+   if (total_latency)
+      _last_block_production_warning = "Block #" + fc::to_string(timing.block_num) + " took " +
+                                       fc::to_string(total_latency->count() / 1000) + " ms to produce and reach " +
+                                       fc::to_string(timing.peers_to_acknowledge) + " peers, over the " +
+                                       fc::to_string(warning_threshold.count() / 1000) + " ms warning threshold";
+   else
+      _last_block_production_warning = "Block #" + fc::to_string(timing.block_num) + " was not acknowledged by " +
+                                       fc::to_string(timing.peers_to_acknowledge) + " peers within one block interval";
+   wlog("${warning}", ("warning", *_last_block_production_warning));
+}
+
+/**
+ *  The stateless half of transaction intake: size and expiration checks, the transaction id
+ *  and signature recovery.  All of it, hashing included, runs on a worker thread and this
+ *  fiber yields until it finishes, so the chain thread keeps processing blocks during bursts.
+ *  Duplicates of transactions already in the chain are dropped as soon as the id comes back.
+ */
+transaction_precheck client_impl::precheck_transaction(const signed_transaction& trx)
+{
+   const fc::time_point start_time = fc::time_point::now();
+   ++_precheck_stage_stats.queue_depth;
+   try
+   {
+      if (_transaction_precheck_threads.empty())
+      {
+         const uint32_t thread_count = std::max<uint32_t>(1, std::min<uint32_t>(4, std::thread::hardware_concurrency()));
+         for (uint32_t i = 0; i < thread_count; ++i)
+            _transaction_precheck_threads.emplace_back(new fc::thread("transaction_precheck_" + std::to_string(i)));
+      }
+      fc::thread& worker = *_transaction_precheck_threads[_next_precheck_thread++ % _transaction_precheck_threads.size()];
+
+      // the clock reads unsynchronized ntp and simulated time offsets, so it is only read on the chain thread
+      const digest_type chain_id = _chain_db->chain_id();
+      const fc::time_point_sec now = bts::blockchain::now();
+      transaction_precheck result = worker.async([trx, chain_id, now]() { return transaction_evaluation_state::precheck(trx, chain_id, now); },
+                                                 "transaction_precheck").wait();
+      if (_chain_db->is_known_transaction(result.id))
+         FC_CAPTURE_AND_THROW(duplicate_transaction, (result.id));
+      _precheck_stage_stats.record(fc::time_point::now() - start_time, true);
+      return result;
+   }
+   catch (...)
+   {
+      _precheck_stage_stats.record(fc::time_point::now() - start_time, false);
+      throw;
+   }
+}
+
 bool client_impl::on_new_transaction(const signed_transaction& trx)
 {
    try {
-      // throws exception if invalid trx, don't override limits
-      return !!_chain_db->store_pending_transaction(trx, false);
+      const transaction_precheck precheck = precheck_transaction(trx);
+
+      // the stateful half: evaluation against the pending state and fee ranking, on the chain thread
+      const fc::time_point evaluation_start_time = fc::time_point::now();
+      ++_evaluation_stage_stats.queue_depth;
+      bool accepted = false;
+      try
+      {
+         // throws exception if invalid trx, don't override limits
+         accepted = !!_chain_db->store_pending_transaction(trx, false, &precheck);
+      }
+      catch (...)
+      {
+         _evaluation_stage_stats.record(fc::time_point::now() - evaluation_start_time, false);
+         throw;
+      }
+      _evaluation_stage_stats.record(fc::time_point::now() - evaluation_start_time, true);
+      return accepted;
    }
    catch ( const duplicate_transaction& )
    {
@@ -816,6 +1079,108 @@ bool client_impl::on_new_transaction(const signed_transaction& trx)
    }
 }
 
+/**
+ *  Rebuilds a block from a compact block message using the transactions in our pending
+ *  transaction pool.  If any are missing, the partial block is held and the result lists
+ *  the transactions the p2p code has to fetch from the peer.
+ */
+bts::net::compact_block_result client_impl::on_compact_block(const compact_block_message& compact_block)
+{
+   ilog("CLIENT: just received compact block ${id} with ${count} transactions, ${prefilled} prefilled",
+        ("id", compact_block.block_id)("count", compact_block.transaction_count())
+        ("prefilled", compact_block.prefilled_transactions.size()));
+   bts::net::compact_block_result result;
+   if (_chain_db->is_known_block(compact_block.block_id))
+      return result;
+   FC_ASSERT(compact_block.transaction_count() <= std::numeric_limits<uint16_t>::max());
+
+   partial_compact_block partial_block;
+   partial_block.compact_block = compact_block;
+   partial_block.transactions.resize(compact_block.transaction_count());
+   partial_block.received_time = fc::time_point::now();
+
+   std::set<uint16_t> prefilled_indexes;
+   for (const auto& prefilled : compact_block.prefilled_transactions)
+   {
+      FC_ASSERT(prefilled.first < partial_block.transactions.size(), "prefilled transaction index out of range");
+      partial_block.transactions[prefilled.first] = prefilled.second;
+      prefilled_indexes.insert(prefilled.first);
+   }
+
+   unordered_map<uint64_t, signed_transaction> pending_by_short_id;
+   for (const transaction_evaluation_state_ptr& eval_state : _chain_db->get_pending_transactions())
+      pending_by_short_id[compact_block.short_id(eval_state->trx.id())] = eval_state->trx;
+
+   for (uint16_t i = 0; i < partial_block.transactions.size(); ++i)
+   {
+      if (partial_block.transactions[i])
+         continue;
+      auto iter = pending_by_short_id.find(compact_block.short_transaction_ids[i]);
+      if (iter != pending_by_short_id.end())
+         partial_block.transactions[i] = iter->second;
+      else
+         partial_block.missing_transaction_indexes.push_back(i);
+   }
+
+   if (partial_block.missing_transaction_indexes.empty())
+   {
+      if (push_compact_block(partial_block))
+         return result;
+      // a short id collided with the wrong pending transaction; refetch everything we guessed
+      for (uint16_t i = 0; i < partial_block.transactions.size(); ++i)
+         if (prefilled_indexes.find(i) == prefilled_indexes.end())
+            partial_block.missing_transaction_indexes.push_back(i);
+   }
+
+   while (_partial_compact_blocks.size() >= BTS_NET_MAX_PARTIAL_COMPACT_BLOCKS)
+   {
+      auto oldest = std::min_element(_partial_compact_blocks.begin(), _partial_compact_blocks.end(),
+                                     [](const std::pair<const block_id_type, partial_compact_block>& a,
+                                        const std::pair<const block_id_type, partial_compact_block>& b) {
+                                        return a.second.received_time < b.second.received_time; });
+      _partial_compact_blocks.erase(oldest);
+   }
+   result.missing_transaction_indexes = partial_block.missing_transaction_indexes;
+   _partial_compact_blocks[compact_block.block_id] = std::move(partial_block);
+   return result;
+}
+
+bts::net::compact_block_result client_impl::on_compact_block_transactions(const compact_block_transactions_message& transactions_message)
+{
+   auto iter = _partial_compact_blocks.find(transactions_message.block_id);
+   FC_ASSERT(iter != _partial_compact_blocks.end(), "Received transactions for unknown compact block ${id}",
+             ("id", transactions_message.block_id));
+   partial_compact_block partial_block = std::move(iter->second);
+   _partial_compact_blocks.erase(iter);
+
+   FC_ASSERT(transactions_message.transactions.size() == partial_block.missing_transaction_indexes.size(),
+             "Expected ${expected} transactions for compact block, received ${actual}",
+             ("expected", partial_block.missing_transaction_indexes.size())
+             ("actual", transactions_message.transactions.size()));
+   for (size_t i = 0; i < transactions_message.transactions.size(); ++i)
+      partial_block.transactions[partial_block.missing_transaction_indexes[i]] = transactions_message.transactions[i];
+
+   FC_ASSERT(push_compact_block(partial_block), "Compact block transactions don't match the block's transaction digest");
+   return bts::net::compact_block_result();
+}
+
+/** returns false without touching the chain if the rebuilt block doesn't match its header */
+bool client_impl::push_compact_block(partial_compact_block& partial_block)
+{
+   full_block block;
+   (signed_block_header&)block = partial_block.compact_block.block_header;
+   block.user_transactions.reserve(partial_block.transactions.size());
+   for (const optional<signed_transaction>& trx : partial_block.transactions)
+      block.user_transactions.push_back(*trx);
+
+   if (!digest_block(block).validate_digest())
+      return false;
+   FC_ASSERT(block.id() == partial_block.compact_block.block_id);
+
+   on_new_block(block, partial_block.compact_block.block_id, false);
+   return true;
+}
+
 ///////////////////////////////////////////////////////
 // Implement node_delegate                           //
 ///////////////////////////////////////////////////////
@@ -861,6 +1226,11 @@ bool client_impl::handle_message(const bts::net::message& message_to_handle, boo
       FC_THROW_EXCEPTION(bts::net::insufficient_relay_fee, "Insufficient relay fee; do not propagate!",
                          ("original_exception", original_exception.to_detail_string()));
    }
+   catch (const bts::blockchain::pending_sender_limit& original_exception)
+   {
+      FC_THROW_EXCEPTION(bts::net::insufficient_relay_fee, "Too many pending transactions from sender; do not propagate!",
+                         ("original_exception", original_exception.to_detail_string()));
+   }
    catch (const bts::blockchain::block_older_than_undo_history& original_exception)
    {
       FC_THROW_EXCEPTION(bts::net::block_older_than_undo_history, "Block is older than undo history, stop fetching blocks!",
@@ -868,6 +1238,18 @@ bool client_impl::handle_message(const bts::net::message& message_to_handle, boo
    }
 }
 
+bts::net::compact_block_result client_impl::handle_compact_block(const bts::net::message& message_to_handle)
+{
+   switch (message_to_handle.msg_type)
+   {
+   case compact_block_message_type:
+      return on_compact_block(message_to_handle.as<compact_block_message>());
+   case compact_block_transactions_message_type:
+      return on_compact_block_transactions(message_to_handle.as<compact_block_transactions_message>());
+   }
+   FC_THROW("Message type ${type} isn't part of a compact block", ("type", message_to_handle.msg_type));
+}
+
 /**
       *  Get the hash of all blocks after from_id
       */
@@ -892,7 +1274,7 @@ std::vector<bts::net::item_hash_t> client_impl::get_item_ids(uint32_t item_type,
       try
       {
          uint32_t block_num = _chain_db->get_block_num(item_hash);
-         if (_chain_db->is_included_block(item_hash))
+         if (_chain_db->is_included_block(block_num, item_hash))
          {
             last_seen_block_num = block_num;
             last_seen_block_hash = item_hash;
@@ -1050,7 +1432,7 @@ std::vector<bts::net::item_hash_t> client_impl::get_blockchain_synopsis(uint32_t
       // if it's <= non_fork_high_block_num, we grab it from the main blockchain;
       // if it's not, we pull it from the fork history
       if (low_block_num <= non_fork_high_block_num)
-         synopsis.push_back(_chain_db->get_block(low_block_num).id());
+         synopsis.push_back(_chain_db->get_block_id(low_block_num));
       else
          synopsis.push_back(fork_history[low_block_num - non_fork_high_block_num - 1]);
       low_block_num += ((true_high_block_num - low_block_num + 2) / 2);
@@ -1303,14 +1685,38 @@ void client::open( const path& data_dir, fc::optional<fc::path> genesis_file_pat
          fc::remove_all(data_dir / "chain");
          my->_chain_db->open(data_dir / "chain", genesis_file_path, reindex_status_callback);
       }
+      my->_chain_db->set_pending_pool_limits( my->_config.pending_pool_max_bytes, my->_config.pending_pool_max_per_sender );
+      my->_chain_db->set_delegate_reliability_windows( my->_config.delegate_reliability_windows );
 
-      my->_wallet = std::make_shared<bts::wallet::wallet>( my->_chain_db, my->_config.wallet_enabled );
-      my->_wallet->set_data_directory( data_dir / "wallets" );
+      my->_primary_wallet = std::make_shared<bts::wallet::wallet>( my->_chain_db, my->_config.wallet_enabled );
+      my->_primary_wallet->set_data_directory( data_dir / "wallets" );
+      my->_wallet = my->_primary_wallet;
+      my->_block_scanner.reset( new bts::wallet::shared_block_scanner( my->_chain_db ) );
+      my->_block_scanner->add_wallet( my->_primary_wallet );
 
       if (my->_config.mail_server_enabled)
       {
          my->_mail_server = std::make_shared<bts::mail::server>();
          my->_mail_server->open( data_dir / "mail" );
+         for( const string& peer : my->_config.mail_server_peers )
+         {
+            try
+            {
+               // the peer's RPC credentials come before the last '@', and the user name before the first ':' of those
+               const size_t at = peer.rfind( '@' );
+               FC_ASSERT( at != string::npos, "mail server peers must be given as rpc_user:rpc_password@ip:port" );
+               const string credentials = peer.substr( 0, at );
+               const size_t colon = credentials.find( ':' );
+               FC_ASSERT( colon != string::npos, "mail server peers must be given as rpc_user:rpc_password@ip:port" );
+               my->_mail_server->add_replication_peer( fc::ip::endpoint::from_string( peer.substr( at + 1 ) ),
+                                                       credentials.substr( 0, colon ), credentials.substr( colon + 1 ) );
+            }
+            catch( const fc::exception& e )
+            {
+               // keep the credentials out of the log
+               elog( "ignoring invalid mail server peer ${peer}: ${e}", ("peer",peer.substr( peer.rfind( '@' ) + 1 ))("e",e.to_string()) );
+            }
+         }
       }
       my->_mail_client = std::make_shared<bts::mail::client>(my->_wallet, my->_chain_db);
       my->_mail_client->open( data_dir / "mail_client" );
@@ -1337,7 +1743,27 @@ client::~client()
    }
 }
 
-wallet_ptr client::get_wallet()const { return my->_wallet; }
+wallet_ptr client::get_wallet()const { return my->_primary_wallet; }
+wallet_ptr client::get_call_wallet()const { return my->_wallet; }
+
+wallet_ptr client::get_hosted_wallet( const string& wallet_name )const
+{
+   const auto iter = my->_hosted_wallets.find( wallet_name );
+   FC_ASSERT( iter != my->_hosted_wallets.end(), "No hosted wallet named ${name}", ("name",wallet_name) );
+   return iter->second;
+}
+
+client::wallet_call_scope::wallet_call_scope( client& c, const wallet_ptr& call_wallet )
+:_client( c ), _previous_wallet( c.my->_wallet )
+{
+   FC_ASSERT( call_wallet );
+   _client.my->_wallet = call_wallet;
+}
+
+client::wallet_call_scope::~wallet_call_scope()
+{
+   _client.my->_wallet = _previous_wallet;
+}
 mail_client_ptr client::get_mail_client()const { return my->_mail_client; }
 mail_server_ptr client::get_mail_server()const { return my->_mail_server; }
 chain_database_ptr client::get_chain()const { return my->_chain_db; }
@@ -1420,6 +1846,9 @@ void client::start_networking(std::function<void()> network_started_callback)
 }
 
 //RPC server and CLI configuration rules:
+//if batch mode requested
+//  start RPC server if requested
+//  cli.process_batch from cin, then exit
 //if daemon mode requested
 //  start RPC server only (no CLI input)
 //else
@@ -1431,6 +1860,13 @@ void client::start_networking(std::function<void()> network_started_callback)
 //  set input stream to cin
 //  cli.process_commands from cin
 //  wait till finished
+static const std::vector<fc::ip::endpoint> string_to_endpoints( const string& endpoint_string )
+{
+    auto pos = endpoint_string.find(':');
+    uint16_t port = boost::lexical_cast<uint16_t>( endpoint_string.substr( pos+1, endpoint_string.size() ) );
+    return fc::resolve(endpoint_string.substr(0, pos), port);
+}
+
 void client::configure_from_command_line(int argc, char** argv)
 {
    if( argc == 0 && argv == nullptr )
@@ -1452,7 +1888,8 @@ void client::configure_from_command_line(int argc, char** argv)
    if (option_variables.count("genesis-config"))
       genesis_file_path = option_variables["genesis-config"].as<string>();
 
-   my->_enable_ulog = option_variables["ulog"].as<bool>();
+   // keep stdout machine-readable in batch mode
+   my->_enable_ulog = option_variables["ulog"].as<bool>() && !option_variables.count("batch");
    this->open( datadir, genesis_file_path );
 
    if (option_variables.count("min-delegate-connection-count"))
@@ -1489,7 +1926,12 @@ void client::configure_from_command_line(int argc, char** argv)
    // else we use the default set in bts::net::node
 
    //initialize cli
-   if( option_variables.count("daemon") || my->_config.ignore_console )
+   if( option_variables.count("batch") )
+   {
+      my->_cli = new bts::cli::cli( this, nullptr, &std::cout );
+      my->_cli->set_batch_mode(true);
+   }
+   else if( option_variables.count("daemon") || my->_config.ignore_console )
    {
       std::cout << "Running in daemon mode, ignoring console\n";
       my->_cli = new bts::cli::cli( this, nullptr, &std::cout );
@@ -1590,6 +2032,16 @@ void client::configure_from_command_line(int argc, char** argv)
       "block_monitor_task");
    }
 
+   std::vector<string> delegate_relay_peers = my->_config.default_delegate_peers;
+   if (option_variables.count("delegate-relay-peer"))
+   {
+      std::vector<string> extra_delegate_relay_peers = option_variables["delegate-relay-peer"].as<std::vector<string>>();
+      delegate_relay_peers.insert(delegate_relay_peers.end(), extra_delegate_relay_peers.begin(), extra_delegate_relay_peers.end());
+   }
+   // must be set before we connect so it goes out in our hello messages
+   if (!delegate_relay_peers.empty())
+      my->_p2p_node->set_delegate_relay_enabled(true);
+
    start_networking([=]{
       fc::ip::endpoint actual_p2p_endpoint = this->get_p2p_listening_endpoint();
       std::ostringstream port_stream;
@@ -1624,6 +2076,19 @@ void client::configure_from_command_line(int argc, char** argv)
          for (string default_peer : my->_config.default_peers)
             this->add_node(default_peer);
       }
+
+      for (const string& delegate_relay_peer : delegate_relay_peers)
+      {
+         try
+         {
+            for (const fc::ip::endpoint& endpoint : string_to_endpoints(delegate_relay_peer))
+               my->_p2p_node->add_delegate_relay_peer(endpoint);
+         }
+         catch (const fc::exception& e)
+         {
+            ulog("Unable to add delegate relay peer ${peer}: ${error}", ("peer", delegate_relay_peer)("error", e.to_string()));
+         }
+      }
    });
 
    if (my->_config.chain_server.enabled)
@@ -1686,13 +2151,6 @@ fc::path client::get_data_dir()const
    return my->_data_dir;
 }
 
-static const std::vector<fc::ip::endpoint> string_to_endpoints( const string& endpoint_string )
-{
-    auto pos = endpoint_string.find(':');
-    uint16_t port = boost::lexical_cast<uint16_t>( endpoint_string.substr( pos+1, endpoint_string.size() ) );
-    return fc::resolve(endpoint_string.substr(0, pos), port);
-}
-
 void client::add_node( const string& remote_endpoint )
 {
   std::vector<fc::ip::endpoint> endpoints;
@@ -1783,6 +2241,10 @@ bool client::handle_message(const bts::net::message& message, bool sync_mode)
 {
    return my->handle_message(message, sync_mode);
 }
+bts::net::compact_block_result client::handle_compact_block(const bts::net::message& message)
+{
+   return my->handle_compact_block(message);
+}
 void client::sync_status(uint32_t item_type, uint32_t item_count)
 {
    my->sync_status(item_type, item_count);
@@ -113,6 +113,26 @@ fc::variant_object client_impl::debug_get_call_statistics() const
    return _p2p_node->get_call_statistics();
 }
 
+fc::variant_object client_impl::debug_get_memory_usage( bool verify ) const
+{
+   fc::mutable_variant_object usage;
+   uint64_t total_bytes = 0;
+   const auto add_subsystem = [&]( const string& name, const fc::variant_object& subsystem_usage )
+   {
+      if( subsystem_usage.contains( "total_bytes" ) )
+         total_bytes += subsystem_usage["total_bytes"].as_uint64();
+      usage[name] = subsystem_usage;
+   };
+   add_subsystem( "blockchain", _chain_db->get_memory_usage( verify ) );
+   add_subsystem( "network", _p2p_node->get_memory_usage( verify ) );
+   if( _wallet )
+      add_subsystem( "wallet", _wallet->get_memory_usage() );
+   if( _mail_client )
+      add_subsystem( "mail", _mail_client->get_memory_usage() );
+   usage["total_bytes"] = total_bytes;
+   return usage;
+}
+
 fc::variant_object client_impl::debug_verify_delegate_votes() const
 {
    return _chain_db->find_delegate_vote_discrepancies();
@@ -79,7 +79,12 @@ namespace bts { namespace client {
           use_upnp(true),
           maximum_number_of_connections(BTS_NET_DEFAULT_MAX_CONNECTIONS) ,
           delegate_server( fc::ip::endpoint::from_string("0.0.0.0:0") ),
-          default_delegate_peers( vector<string>({"178.62.50.61:9988"}) )
+          default_delegate_peers(),
+          pending_pool_max_bytes(BTS_BLOCKCHAIN_MAX_PENDING_POOL_BYTES),
+          pending_pool_max_per_sender(BTS_BLOCKCHAIN_MAX_PENDING_PER_SENDER),
+          delegate_reliability_windows(BTS_BLOCKCHAIN_DELEGATE_RELIABILITY_WINDOWS),
+          block_production_warning_fraction(BTS_BLOCKCHAIN_PRODUCTION_WARNING_FRACTION),
+          block_production_acknowledgement_peers(BTS_BLOCKCHAIN_PRODUCTION_ACKNOWLEDGEMENT_PEERS)
           {
 #ifdef BTS_TEST_NETWORK
               uint32_t port = BTS_NET_TEST_P2P_PORT + BTS_TEST_NETWORK_VERSION;
@@ -97,6 +102,7 @@ namespace bts { namespace client {
           vector<string>      chain_servers;
           chain_server_config chain_server;
           bool                mail_server_enabled;
+          vector<string>      mail_server_peers; ///< rpc_user:rpc_password@ip:port of mail servers to replicate accepted mail to
           bool                wallet_enabled;
           bool                ignore_console;
           bool                use_upnp;
@@ -105,6 +111,11 @@ namespace bts { namespace client {
           fc::logging_config  logging;
           fc::ip::endpoint    delegate_server;
           vector<string>      default_delegate_peers;
+          uint64_t            pending_pool_max_bytes;
+          uint32_t            pending_pool_max_per_sender;
+          vector<uint32_t>    delegate_reliability_windows; ///< in each delegate's own slots
+          double              block_production_warning_fraction; ///< of the block interval
+          uint32_t            block_production_acknowledgement_peers;
 
           fc::optional<std::string> growl_notify_endpoint;
           fc::optional<std::string> growl_password;
@@ -141,7 +152,28 @@ namespace bts { namespace client {
 
 
          chain_database_ptr         get_chain()const;
+         /** the wallet opened at startup */
          wallet_ptr                 get_wallet()const;
+         /** returns the wallet hosted under wallet_name, throwing if there is none */
+         wallet_ptr                 get_hosted_wallet( const string& wallet_name )const;
+         /** the wallet serving the RPC call in progress, or the primary wallet outside of one */
+         wallet_ptr                 get_call_wallet()const;
+
+         /**
+          *  Serves the wallet API methods from call_wallet for the lifetime of the scope.  Only the RPC
+          *  server opens one, around each call it dispatches under the lock that serializes RPC calls;
+          *  code running outside an RPC call uses get_wallet() and never sees the call's wallet.
+          */
+         class wallet_call_scope
+         {
+            public:
+               wallet_call_scope( client& c, const wallet_ptr& call_wallet );
+               ~wallet_call_scope();
+
+            private:
+               client&    _client;
+               wallet_ptr _previous_wallet;
+         };
          mail_client_ptr            get_mail_client()const;
          mail_server_ptr            get_mail_server()const;
          bts::rpc::rpc_server_ptr   get_rpc_server()const;
@@ -164,6 +196,7 @@ namespace bts { namespace client {
 
          fc::ip::endpoint get_p2p_listening_endpoint() const;
          bool handle_message(const bts::net::message&, bool sync_mode);
+         bts::net::compact_block_result handle_compact_block(const bts::net::message&);
          void sync_status(uint32_t item_type, uint32_t item_count);
 
        protected:
@@ -199,10 +232,15 @@ FC_REFLECT(bts::client::client_notification, (timestamp)(message)(signature) )
 FC_REFLECT( bts::client::rpc_server_config, (enable)(rpc_user)(rpc_password)(rpc_endpoint)(httpd_endpoint)(htdocs) )
 FC_REFLECT( bts::client::chain_server_config, (enabled)(listen_port) )
 FC_REFLECT( bts::client::config,
-            (rpc)(default_peers)(chain_servers)(chain_server)(mail_server_enabled)
+            (rpc)(default_peers)(chain_servers)(chain_server)(mail_server_enabled)(mail_server_peers)
             (wallet_enabled)(ignore_console)(logging)
             (delegate_server)
             (default_delegate_peers)
+            (pending_pool_max_bytes)
+            (pending_pool_max_per_sender)
+            (delegate_reliability_windows)
+            (block_production_warning_fraction)
+            (block_production_acknowledgement_peers)
             (growl_notify_endpoint)
             (growl_password)
             (growl_bitshares_client_identifier) )
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <bts/cli/cli.hpp>
+#include <bts/client/messages.hpp>
 #include <bts/client/notifier.hpp>
 #include <bts/db/level_map.hpp>
 #include <bts/net/upnp.hpp>
 #include <bts/net/chain_server.hpp>
+#include <bts/wallet/shared_block_scanner.hpp>
 
 #include <fc/log/appender.hpp>
 
@@ -14,7 +16,9 @@
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
 #include <boost/accumulators/statistics/rolling_mean.hpp>
+#include <boost/circular_buffer.hpp>
 
+#include <deque>
 #include <iostream>
 #include <fstream>
 
@@ -200,6 +204,59 @@ public:
                                 bool sync_mode);
 
    bool on_new_transaction(const signed_transaction& trx);
+   transaction_precheck precheck_transaction(const signed_transaction& trx);
+
+   /** occupancy and latency of one stage of transaction intake, see on_new_transaction */
+   struct intake_stage_stats
+   {
+      uint32_t         queue_depth = 0;
+      uint64_t         accepted = 0;
+      uint64_t         rejected = 0;
+      fc::microseconds total_latency;
+      fc::microseconds max_latency;
+
+      void             record(const fc::microseconds& latency, bool was_accepted);
+      fc::variant      to_variant()const;
+   };
+
+   /** latency of one stage of block production over the last blocks this client produced, see delegate_loop */
+   struct production_stage_histogram
+   {
+      production_stage_histogram() : recent_latencies(BTS_BLOCKCHAIN_PRODUCTION_HISTORY_SIZE) {}
+
+      boost::circular_buffer<fc::microseconds> recent_latencies;
+
+      void             record(const fc::microseconds& latency);
+      fc::variant      to_variant()const;
+   };
+
+   /** a block this client produced whose network stages are still being measured */
+   struct block_production_timing
+   {
+      uint32_t         block_num = 0;
+      block_id_type    block_id;
+      fc::time_point   start_time; ///< when generate_block was called
+      fc::time_point   broadcast_time;
+      uint32_t         peers_to_acknowledge = 0;
+      bool             warned = false; ///< already counted as a warning before it was finished
+   };
+   void update_block_production_timings();
+   void schedule_block_production_timing_check();
+   fc::microseconds block_production_warning_threshold()const;
+   void finish_block_production_timing(const block_production_timing& timing,
+                                       const optional<bts::net::block_delivery_data>& delivery);
+
+   /** a compact block we're waiting on a peer to send us the rest of the transactions for */
+   struct partial_compact_block
+   {
+      compact_block_message                   compact_block;
+      vector<optional<signed_transaction>>    transactions;
+      vector<uint16_t>                        missing_transaction_indexes;
+      fc::time_point                          received_time;
+   };
+   bts::net::compact_block_result on_compact_block(const compact_block_message& compact_block);
+   bts::net::compact_block_result on_compact_block_transactions(const compact_block_transactions_message& transactions_message);
+   bool push_compact_block(partial_compact_block& partial_block);
    void blocks_too_old_monitor_task();
    void cancel_blocks_too_old_monitor_task();
 
@@ -207,6 +264,7 @@ public:
    // @{
    virtual bool has_item(const bts::net::item_id& id) override;
    virtual bool handle_message(const bts::net::message&, bool sync_mode) override;
+   virtual bts::net::compact_block_result handle_compact_block(const bts::net::message&) override;
    virtual std::vector<bts::net::item_hash_t> get_item_ids(uint32_t item_type,
                                                            const vector<bts::net::item_hash_t>& blockchain_synopsis,
                                                            uint32_t& remaining_item_count,
@@ -256,7 +314,14 @@ public:
    std::unique_ptr<bts::net::upnp_service>                 _upnp_service = nullptr;
    chain_database_ptr                                      _chain_db = nullptr;
    unordered_map<transaction_id_type, signed_transaction>  _pending_trxs;
+   /** compact blocks waiting for missing transactions, bounded by BTS_NET_MAX_PARTIAL_COMPACT_BLOCKS */
+   std::map<block_id_type, partial_compact_block>          _partial_compact_blocks;
+   /** the wallet serving the RPC call in progress, only ever changed by client::wallet_call_scope */
    wallet_ptr                                              _wallet = nullptr;
+   /** the wallet opened at startup, used for block production */
+   wallet_ptr                                              _primary_wallet = nullptr;
+   std::map<string, wallet_ptr>                            _hosted_wallets;
+   std::unique_ptr<bts::wallet::shared_block_scanner>      _block_scanner;
    std::shared_ptr<bts::mail::server>                      _mail_server = nullptr;
    std::shared_ptr<bts::mail::client>                      _mail_client = nullptr;
    fc::future<void>                                        _delegate_loop_complete;
@@ -281,6 +346,26 @@ public:
    config                                                  _config;
    logging_exception_db                                    _exception_db;
 
+   /** worker threads for the stateless half of transaction intake, created on first use */
+   std::vector<std::unique_ptr<fc::thread>>                _transaction_precheck_threads;
+   uint32_t                                                _next_precheck_thread = 0;
+   intake_stage_stats                                      _precheck_stage_stats;
+   intake_stage_stats                                      _evaluation_stage_stats;
+
+   production_stage_histogram                              _template_build_stage_stats;
+   production_stage_histogram                              _signing_stage_stats;
+   production_stage_histogram                              _local_apply_stage_stats;
+   production_stage_histogram                              _first_peer_send_stage_stats;
+   production_stage_histogram                              _peer_acknowledgement_stage_stats;
+   production_stage_histogram                              _total_production_stage_stats;
+   std::deque<block_production_timing>                     _unfinished_block_productions;
+   fc::future<void>                                        _block_production_timing_check;
+   fc::time_point                                          _block_production_timing_check_time;
+   uint64_t                                                _blocks_produced = 0;
+   uint64_t                                                _block_production_warnings = 0;
+   uint64_t                                                _blocks_not_acknowledged = 0;
+   optional<string>                                        _last_block_production_warning;
+
    uint32_t                                                _min_delegate_connection_count = BTS_MIN_DELEGATE_CONNECTION_COUNT;
    //start by assuming not syncing, network won't send us a msg if we start synced and stay synched.
    //at worst this means we might briefly sending some pending transactions while not synched.
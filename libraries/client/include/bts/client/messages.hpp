@@ -2,12 +2,17 @@
 #include <bts/blockchain/block.hpp>
 #include <bts/client/client.hpp>
 
+#include <functional>
+
 namespace bts { namespace client {
 
    enum message_type_enum
    {
-      trx_message_type          = 1000,
-      block_message_type        = 1001
+      trx_message_type                              = 1000,
+      block_message_type                            = 1001,
+      compact_block_message_type                    = 1002,
+      fetch_compact_block_transactions_message_type = 1003,
+      compact_block_transactions_message_type       = 1004
    };
 
    struct trx_message
@@ -34,8 +39,68 @@ namespace bts { namespace client {
 
    };
 
+   /**
+    *  Sent in place of a block_message to peers that support it.  Transactions the
+    *  receiver already has in its pending transaction pool are replaced by short
+    *  ids, salted per block so that nobody can grind transactions whose short ids
+    *  collide on every node.  Transactions the sender expects the receiver doesn't
+    *  have are sent in full, along with their index in the block.
+    */
+   struct compact_block_message
+   {
+      static const message_type_enum type;
+
+      compact_block_message() : short_id_salt(0) {}
+      /** transactions for which include_transaction returns true are sent in full */
+      compact_block_message( const bts::blockchain::full_block& blk, const fc::uint160_t& block_message_id, uint64_t salt,
+                             const std::function<bool(const bts::blockchain::signed_transaction&)>& include_transaction );
+
+      /** the first 8 bytes of sha256( short_id_salt, id ) */
+      uint64_t short_id( const bts::blockchain::transaction_id_type& id )const;
+      uint32_t transaction_count()const { return uint32_t(short_transaction_ids.size()); }
+
+      bts::blockchain::signed_block_header                               block_header;
+      bts::blockchain::block_id_type                                     block_id;
+      /** id of the block_message this stands in for, which is what the receiver requested */
+      fc::uint160_t                                                      block_message_id;
+      uint64_t                                                           short_id_salt;
+      /** one entry per transaction in the block, in block order; prefilled entries are zero */
+      std::vector<uint64_t>                                              short_transaction_ids;
+      std::vector<std::pair<uint16_t, bts::blockchain::signed_transaction>> prefilled_transactions;
+   };
+
+   /** requests the transactions a compact block referred to that we couldn't find */
+   struct fetch_compact_block_transactions_message
+   {
+      static const message_type_enum type;
+
+      fetch_compact_block_transactions_message(){}
+      fetch_compact_block_transactions_message( const bts::blockchain::block_id_type& id, std::vector<uint16_t> indexes )
+      :block_id(id),transaction_indexes(std::move(indexes)){}
+
+      bts::blockchain::block_id_type block_id;
+      std::vector<uint16_t>          transaction_indexes;
+   };
+
+   /** reply to fetch_compact_block_transactions_message, transactions are in the order requested */
+   struct compact_block_transactions_message
+   {
+      static const message_type_enum type;
+
+      compact_block_transactions_message(){}
+      compact_block_transactions_message( const bts::blockchain::block_id_type& id, std::vector<bts::blockchain::signed_transaction> trxs )
+      :block_id(id),transactions(std::move(trxs)){}
+
+      bts::blockchain::block_id_type                   block_id;
+      std::vector<bts::blockchain::signed_transaction> transactions;
+   };
+
 } } // bts::client
 
-FC_REFLECT_ENUM( bts::client::message_type_enum, (trx_message_type)(block_message_type) )
+FC_REFLECT_ENUM( bts::client::message_type_enum, (trx_message_type)(block_message_type)(compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)(compact_block_transactions_message_type) )
 FC_REFLECT( bts::client::trx_message, (trx) )
 FC_REFLECT( bts::client::block_message, (block)(block_id) )
+FC_REFLECT( bts::client::compact_block_message, (block_header)(block_id)(block_message_id)(short_id_salt)(short_transaction_ids)(prefilled_transactions) )
+FC_REFLECT( bts::client::fetch_compact_block_transactions_message, (block_id)(transaction_indexes) )
+FC_REFLECT( bts::client::compact_block_transactions_message, (block_id)(transactions) )
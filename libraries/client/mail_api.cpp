@@ -24,6 +24,24 @@ mail::message detail::client_impl::mail_fetch_message(const mail::message_id_typ
    return _mail_server->fetch_message(inventory_id);
 }
 
+vector<mail::message> detail::client_impl::mail_fetch_messages(const vector<mail::message_id_type>& inventory_ids) const
+{
+   FC_ASSERT(_mail_server, "Mail server not enabled!");
+   return _mail_server->fetch_messages(inventory_ids);
+}
+
+vector<mail::message_id_type> detail::client_impl::mail_announce_inventory(const vector<mail::message_id_type>& inventory_ids) const
+{
+   FC_ASSERT(_mail_server, "Mail server not enabled!");
+   return _mail_server->announce_inventory(inventory_ids);
+}
+
+void detail::client_impl::mail_store_replicated_messages(const vector<mail::message>& messages)
+{
+   FC_ASSERT(_mail_server, "Mail server not enabled!");
+   _mail_server->store_replicated(messages);
+}
+
 std::multimap<mail::client::mail_status, mail::message_id_type> detail::client_impl::mail_get_processing_messages() const
 {
    FC_ASSERT(_mail_client);
@@ -78,27 +96,32 @@ mail::email_record detail::client_impl::mail_get_message(const mail::message_id_
    return _mail_client->get_message(message_id);
 }
 
-vector<mail::email_header> detail::client_impl::mail_get_messages_from(const std::string &sender) const
+vector<mail::email_header> detail::client_impl::mail_get_messages_from(const std::string &sender,
+                                                                       const fc::time_point &start_time,
+                                                                       uint32_t limit,
+                                                                       const mail::message_id_type& start_after) const
 {
    FC_ASSERT(_mail_client);
-   return _mail_client->get_messages_by_sender(sender);
+   return _mail_client->get_messages_by_sender(sender, start_time, limit, start_after);
 }
 
-vector<mail::email_header> detail::client_impl::mail_get_messages_to(const std::string &recipient) const
+vector<mail::email_header> detail::client_impl::mail_get_messages_to(const std::string &recipient,
+                                                                     const fc::time_point &start_time,
+                                                                     uint32_t limit,
+                                                                     const mail::message_id_type& start_after) const
 {
    FC_ASSERT(_mail_client);
-   return _mail_client->get_messages_by_recipient(recipient);
+   return _mail_client->get_messages_by_recipient(recipient, start_time, limit, start_after);
 }
 
-vector<mail::email_header> detail::client_impl::mail_get_messages_in_conversation(const std::string &account_one, const std::string &account_two) const
+vector<mail::email_header> detail::client_impl::mail_get_messages_in_conversation(const std::string &account_one,
+                                                                                  const std::string &account_two,
+                                                                                  const fc::time_point &start_time,
+                                                                                  uint32_t limit,
+                                                                                  const mail::message_id_type& start_after) const
 {
    FC_ASSERT(_mail_client);
-   auto forward = _mail_client->get_messages_from_to(account_one, account_two);
-   auto backward = _mail_client->get_messages_from_to(account_two, account_one);
-
-   std::move(backward.begin(), backward.end(), std::back_inserter(forward));
-   std::sort(forward.begin(), forward.end(), [](const email_header& a, const email_header& b) {return a.timestamp < b.timestamp;});
-   return forward;
+   return _mail_client->get_messages_in_conversation(account_one, account_two, start_time, limit, start_after);
 }
 
 mail::message_id_type detail::client_impl::mail_send(const std::string& from,
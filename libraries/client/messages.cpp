@@ -1,7 +1,42 @@
 #include <bts/client/messages.hpp>
+
+#include <limits>
+
 namespace bts { namespace client {
 
    const message_type_enum trx_message::type                 = message_type_enum::trx_message_type;
    const message_type_enum block_message::type               = message_type_enum::block_message_type;
+   const message_type_enum compact_block_message::type       = message_type_enum::compact_block_message_type;
+   const message_type_enum fetch_compact_block_transactions_message::type = message_type_enum::fetch_compact_block_transactions_message_type;
+   const message_type_enum compact_block_transactions_message::type       = message_type_enum::compact_block_transactions_message_type;
+
+   compact_block_message::compact_block_message( const bts::blockchain::full_block& blk, const fc::uint160_t& block_message_id,
+                                                 uint64_t salt,
+                                                 const std::function<bool(const bts::blockchain::signed_transaction&)>& include_transaction )
+   :block_header(blk),block_id(blk.id()),block_message_id(block_message_id),short_id_salt(salt)
+   {
+      FC_ASSERT( blk.user_transactions.size() <= std::numeric_limits<uint16_t>::max() );
+      short_transaction_ids.reserve( blk.user_transactions.size() );
+      for( uint16_t i = 0; i < blk.user_transactions.size(); ++i )
+      {
+         const bts::blockchain::signed_transaction& trx = blk.user_transactions[i];
+         if( include_transaction( trx ) )
+         {
+            short_transaction_ids.push_back( 0 );
+            prefilled_transactions.emplace_back( i, trx );
+         }
+         else
+            short_transaction_ids.push_back( short_id( trx.id() ) );
+      }
+   }
+
+   uint64_t compact_block_message::short_id( const bts::blockchain::transaction_id_type& id )const
+   {
+      fc::sha256::encoder enc;
+      fc::raw::pack( enc, short_id_salt );
+      fc::raw::pack( enc, id );
+      const fc::sha256 result = enc.result();
+      return result._hash[0];
+   }
 
 } } // bts::client
@@ -75,6 +75,44 @@ fc::variant_object client_impl::network_get_usage_stats() const
    return _p2p_node->network_get_usage_stats();
 }
 
+fc::variant_object client_impl::network_get_transaction_intake_stats() const
+{
+   fc::mutable_variant_object stats;
+   stats["precheck"] = _precheck_stage_stats.to_variant();
+   stats["evaluation"] = _evaluation_stage_stats.to_variant();
+   stats["pending_pool"] = _chain_db->get_pending_pool_status();
+   return stats;
+}
+
+fc::variant_object client_impl::network_get_delegate_relay_status() const
+{
+   return _p2p_node->get_delegate_relay_status();
+}
+
+fc::variant_object client_impl::network_get_block_production_stats()
+{
+   update_block_production_timings();
+
+   fc::mutable_variant_object stages;
+   stages["template_build"] = _template_build_stage_stats.to_variant();
+   stages["signing"] = _signing_stage_stats.to_variant();
+   stages["local_apply"] = _local_apply_stage_stats.to_variant();
+   stages["first_peer_send"] = _first_peer_send_stage_stats.to_variant();
+   stages["peer_acknowledgement"] = _peer_acknowledgement_stage_stats.to_variant();
+   stages["total"] = _total_production_stage_stats.to_variant();
+
+   fc::mutable_variant_object stats;
+   stats["blocks_produced"] = _blocks_produced;
+   stats["blocks_awaiting_acknowledgement"] = _unfinished_block_productions.size();
+   stats["blocks_not_acknowledged"] = _blocks_not_acknowledged;
+   stats["acknowledgement_peers"] = _config.block_production_acknowledgement_peers;
+   stats["warning_threshold_us"] = int64_t(BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC * 1000000 * _config.block_production_warning_fraction);
+   stats["warnings"] = _block_production_warnings;
+   stats["last_warning"] = _last_block_production_warning;
+   stats["stages"] = stages;
+   return stats;
+}
+
 vector<bts::net::potential_peer_record> client_impl::network_list_potential_peers()const
 {
    return _p2p_node->get_potential_peers();
@@ -56,6 +56,39 @@ void detail::client_impl::wallet_close()
     }
 }
 
+void detail::client_impl::wallet_hosted_open( const string& wallet_name )
+{
+  const string trimmed_name = fc::trim( wallet_name );
+  FC_ASSERT( _hosted_wallets.find( trimmed_name ) == _hosted_wallets.end(), "Wallet ${name} is already hosted", ("name",trimmed_name) );
+  FC_ASSERT( !_primary_wallet->is_open() || _primary_wallet->get_wallet_name() != trimmed_name,
+             "Wallet ${name} is already open as the primary wallet", ("name",trimmed_name) );
+
+  const wallet_ptr hosted_wallet = std::make_shared<bts::wallet::wallet>( _chain_db, _config.wallet_enabled );
+  hosted_wallet->set_data_directory( _primary_wallet->get_data_directory() );
+  hosted_wallet->open( trimmed_name );
+  _block_scanner->add_wallet( hosted_wallet );
+  _hosted_wallets[ trimmed_name ] = hosted_wallet;
+}
+
+void detail::client_impl::wallet_hosted_close( const string& wallet_name )
+{
+  const auto iter = _hosted_wallets.find( fc::trim( wallet_name ) );
+  FC_ASSERT( iter != _hosted_wallets.end(), "No hosted wallet named ${name}", ("name",wallet_name) );
+  FC_ASSERT( iter->second != _wallet, "Can't close the wallet serving this call" );
+  _block_scanner->remove_wallet( iter->second );
+  iter->second->close();
+  _hosted_wallets.erase( iter );
+}
+
+vector<string> detail::client_impl::wallet_hosted_list()const
+{
+  vector<string> hosted_wallet_names;
+  hosted_wallet_names.reserve( _hosted_wallets.size() );
+  for( const auto& item : _hosted_wallets )
+    hosted_wallet_names.push_back( item.first );
+  return hosted_wallet_names;
+}
+
 void detail::client_impl::wallet_backup_create( const fc::path& json_filename )const
 {
     _wallet->export_to_json( json_filename );
@@ -547,6 +580,11 @@ void client_impl::wallet_rescan_blockchain( uint32_t start, uint32_t count, bool
    _wallet->scan_chain( start, start + count, fast_scan );
 } FC_RETHROW_EXCEPTIONS( warn, "", ("start",start)("count",count) ) }
 
+void client_impl::wallet_repair_state()
+{ try {
+   _wallet->repair_state();
+} FC_CAPTURE_AND_RETHROW() }
+
 wallet_transaction_record client_impl::wallet_scan_transaction( const string& transaction_id, bool overwrite_existing )
 { try {
    return _wallet->scan_transaction( transaction_id, overwrite_existing );
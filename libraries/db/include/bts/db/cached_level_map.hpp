@@ -96,6 +96,15 @@ namespace bts { namespace db {
             return _cache.size();
         } FC_CAPTURE_AND_RETHROW() }
 
+        /** approximate bytes held by the cache; walks every entry, so it is only meant for diagnostics */
+        uint64_t memory_usage()const
+        { try {
+            uint64_t total = 0;
+            for( const auto& item : _cache )
+                total += entry_memory_usage( item.first, item.second );
+            return total;
+        } FC_CAPTURE_AND_RETHROW() }
+
         bool last( Key& key )const
         { try {
             const auto ritr = _cache.crbegin();
@@ -192,6 +201,13 @@ namespace bts { namespace db {
         } FC_CAPTURE_AND_RETHROW( (path) ) }
 
       private:
+        /** packed key and value plus the container node, which is close enough to the heap footprint */
+        static uint64_t entry_memory_usage( const Key& key, const Value& value )
+        {
+            return sizeof( typename CacheType::value_type ) + 4 * sizeof( void* )
+                   + fc::raw::pack_size( key ) + fc::raw::pack_size( value );
+        }
+
         level_map<Key, Value>    _db;
         CacheType                _cache;
         std::set<Key>            _dirty_store;
@@ -6,6 +6,7 @@
 #include <leveldb/write_batch.h>
 
 #include <bts/db/exception.hpp>
+#include <bts/db/pack_buffer.hpp>
 #include <bts/db/upgrade_leveldb.hpp>
 
 #include <fc/filesystem.hpp>
@@ -93,7 +94,7 @@ namespace bts { namespace db {
         { try {
            FC_ASSERT( is_open(), "Database is not open!" );
 
-           std::vector<char> kslice = fc::raw::pack( k );
+           const pack_buffer kslice( k );
            ldb::Slice ks( kslice.data(), kslice.size() );
            std::string value;
            auto status = _db->Get( _read_options, ks, &value );
@@ -181,6 +182,7 @@ namespace bts { namespace db {
             * memory allocation to seralize the key.
             */
            fc::array<char,256+sizeof(Key)>  stack_buffer;
+           pack_buffer                      heap_buffer;
 
            size_t pack_size = fc::raw::pack_size(key);
            if( pack_size <= stack_buffer.size() )
@@ -191,8 +193,8 @@ namespace bts { namespace db {
            }
            else
            {
-              auto kslice = fc::raw::pack( key );
-              key_slice = ldb::Slice( kslice.data(), kslice.size() );
+              heap_buffer.pack( key );
+              key_slice = ldb::Slice( heap_buffer.data(), heap_buffer.size() );
            }
 
            iterator itr( _db->NewIterator( _iter_options ) );
@@ -208,7 +210,7 @@ namespace bts { namespace db {
         { try {
            FC_ASSERT( is_open(), "Database is not open!" );
 
-           std::vector<char> kslice = fc::raw::pack( key );
+           const pack_buffer kslice( key );
            ldb::Slice key_slice( kslice.data(), kslice.size() );
 
            iterator itr( _db->NewIterator( _iter_options ) );
@@ -275,6 +277,7 @@ namespace bts { namespace db {
                 leveldb::WriteBatch   _batch;
                 level_map*            _map = nullptr;
                 leveldb::WriteOptions _write_options;
+                bool                  _dirty = false; ///< has operations not yet written
 
                 friend class level_map;
                 write_batch( level_map* map, bool sync = false ) : _map(map)
@@ -286,7 +289,9 @@ namespace bts { namespace db {
                 {
                   try
                   {
-                    commit();
+                    // an empty write still costs a sync, so skip it once everything is committed
+                    if( _dirty )
+                      commit();
                   }
                   catch (const fc::canceled_exception&)
                   {
@@ -310,6 +315,7 @@ namespace bts { namespace db {
                     if (!status.ok())
                       FC_THROW_EXCEPTION(db_exception, "database error while applying batch: ${msg}", ("msg", status.ToString()));
                     _batch.Clear();
+                    _dirty = false;
                   }
                   FC_RETHROW_EXCEPTIONS(warn, "error applying batch");
                 }
@@ -317,24 +323,27 @@ namespace bts { namespace db {
                 void abort()
                 {
                   _batch.Clear();
+                  _dirty = false;
                 }
 
                 void store( const Key& k, const Value& v )
                 {
-                  std::vector<char> kslice = fc::raw::pack(k);
+                  const pack_buffer kslice(k);
                   ldb::Slice ks(kslice.data(), kslice.size());
 
-                  auto vec = fc::raw::pack(v);
+                  const pack_buffer vec(v);
                   ldb::Slice vs(vec.data(), vec.size());
 
                   _batch.Put(ks, vs);
+                  _dirty = true;
                 }
 
                 void remove( const Key& k )
                 {
-                  std::vector<char> kslice = fc::raw::pack(k);
+                  const pack_buffer kslice(k);
                   ldb::Slice ks(kslice.data(), kslice.size());
                   _batch.Delete(ks);
+                  _dirty = true;
                 }
         };
 
@@ -347,10 +356,10 @@ namespace bts { namespace db {
         { try {
            FC_ASSERT( is_open(), "Database is not open!" );
 
-           std::vector<char> kslice = fc::raw::pack( k );
+           const pack_buffer kslice( k );
            ldb::Slice ks( kslice.data(), kslice.size() );
 
-           auto vec = fc::raw::pack(v);
+           const pack_buffer vec( v );
            ldb::Slice vs( vec.data(), vec.size() );
 
            auto status = _db->Put( sync ? _sync_options : _write_options, ks, vs );
@@ -364,7 +373,7 @@ namespace bts { namespace db {
         { try {
            FC_ASSERT( is_open(), "Database is not open!" );
 
-           std::vector<char> kslice = fc::raw::pack( k );
+           const pack_buffer kslice( k );
            ldb::Slice ks( kslice.data(), kslice.size() );
            auto status = _db->Delete( sync ? _sync_options : _write_options, ks );
            if( status.IsNotFound() )
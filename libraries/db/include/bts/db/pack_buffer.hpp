@@ -0,0 +1,97 @@
+#pragma once
+
+#include <fc/io/datastream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace bts { namespace db {
+
+  /**
+   *  @brief a serialization buffer borrowed from a per-thread pool for the lifetime of the object
+   *
+   *  Hot paths such as database writes and transaction/block hashing pack values that are thrown away
+   *  as soon as they have been written or hashed.  Packing into a pack_buffer sizes the output with
+   *  fc::raw::pack_size and reuses the capacity left behind by earlier packs on the same thread instead
+   *  of allocating a fresh std::vector<char> every time.  Buffers are handed out from a free list, so
+   *  nested or overlapping pack_buffers (a key and its value, a fiber yielding mid-pack) never share
+   *  storage.
+   */
+  class pack_buffer
+  {
+     public:
+        /** buffers grown beyond this are released instead of being kept for reuse */
+        static const size_t max_retained_capacity = 1024 * 1024;
+        /** number of idle buffers each thread keeps around */
+        static const size_t max_retained_buffers = 8;
+
+        pack_buffer() : _buffer( acquire() ) {}
+
+        template<typename T>
+        explicit pack_buffer( const T& v ) : _buffer( acquire() ) { pack( v ); }
+
+        ~pack_buffer() { release( std::move( _buffer ) ); }
+
+        pack_buffer( const pack_buffer& ) = delete;
+        pack_buffer& operator=( const pack_buffer& ) = delete;
+
+        /** replaces the contents of the buffer with the packed form of v */
+        template<typename T>
+        void pack( const T& v )
+        {
+           _buffer.clear();
+           append( v );
+        }
+
+        /** packs v after whatever the buffer already holds */
+        template<typename T>
+        void append( const T& v )
+        {
+           const size_t offset = _buffer.size();
+           const size_t size = fc::raw::pack_size( v );
+           if( size == 0 ) return;
+           _buffer.resize( offset + size );
+           fc::datastream<char*> ds( _buffer.data() + offset, size );
+           fc::raw::pack( ds, v );
+        }
+
+        const char* data()const { return _buffer.data(); }
+        size_t      size()const { return _buffer.size(); }
+
+     private:
+        static std::vector<std::vector<char>>& idle_buffers()
+        {
+           static thread_local std::vector<std::vector<char>> buffers;
+           return buffers;
+        }
+
+        static std::vector<char> acquire()
+        {
+           std::vector<std::vector<char>>& buffers = idle_buffers();
+           if( buffers.empty() )
+           {
+              // reserve the free list up front so returning a buffer from the destructor never allocates
+              buffers.reserve( max_retained_buffers );
+              return std::vector<char>();
+           }
+           std::vector<char> buffer( std::move( buffers.back() ) );
+           buffers.pop_back();
+           buffer.clear();
+           return buffer;
+        }
+
+        static void release( std::vector<char>&& buffer )
+        {
+           if( buffer.capacity() == 0 || buffer.capacity() > max_retained_capacity )
+              return;
+           std::vector<std::vector<char>>& buffers = idle_buffers();
+           if( buffers.size() >= buffers.capacity() )
+              return;
+           buffers.push_back( std::move( buffer ) );
+        }
+
+        std::vector<char> _buffer;
+  };
+
+} } // bts::db
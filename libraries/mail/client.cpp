@@ -10,12 +10,7 @@
 #include <fc/network/tcp_socket.hpp>
 
 #include <queue>
-
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/composite_key.hpp>
+#include <tuple>
 
 #ifndef UNUSED
 #define UNUSED(var) ((void)(var))
@@ -29,10 +24,9 @@ using namespace bts::blockchain;
 using namespace bts::wallet;
 using std::string;
 using namespace boost;
-using namespace boost::multi_index;
 
 namespace detail {
-#define BTS_MAIL_CLIENT_DATABASE_VERSION 1
+#define BTS_MAIL_CLIENT_DATABASE_VERSION 2
 #define BTS_MAIL_CLIENT_MAX_INVENTORY_SIZE 1000
 
 struct mail_record {
@@ -89,6 +83,7 @@ struct mail_archive_record {
 };
 
 struct mail_index_record {
+    mail_index_record(){}
     mail_index_record(const email_header& header)
         : id(header.id),
           sender(header.sender),
@@ -108,16 +103,109 @@ struct mail_index_record {
     fc::time_point_sec timestamp;
 };
 
-class client_impl {
-protected:
-    //Dummy types to act as mnemonics for multi_index indices
-    struct sender{};
-    struct by_sender{};
-    struct recipient{};
-    struct by_recipient{};
-    struct timestamp{};
-    struct by_timestamp{};
+/**
+ * Key of the persistent archive indexes. The sender and recipient indexes leave counterparty empty; the
+ * conversation index stores both participants in sorted order so either can be used to look it up.
+ */
+struct mail_index_key {
+    string account;
+    string counterparty;
+    fc::time_point_sec timestamp;
+    message_id_type id;
+
+    friend bool operator<(const mail_index_key& a, const mail_index_key& b) {
+        return std::tie(a.account, a.counterparty, a.timestamp, a.id) <
+               std::tie(b.account, b.counterparty, b.timestamp, b.id);
+    }
+    friend bool operator==(const mail_index_key& a, const mail_index_key& b) {
+        return std::tie(a.account, a.counterparty, a.timestamp, a.id) ==
+               std::tie(b.account, b.counterparty, b.timestamp, b.id);
+    }
+};
 
+/**
+ * Idle connections to mail servers, kept open between requests. Each connection is used by one task at a time;
+ * those left idle for BTS_MAIL_CLIENT_CONNECTION_IDLE_TIMEOUT are closed.
+ */
+class mail_connection_pool {
+public:
+    typedef std::shared_ptr<tcp_socket> connection_ptr;
+
+    ~mail_connection_pool() {
+        close();
+    }
+
+    /** an idle connection to server if there is one, otherwise a new one; reused tells which */
+    connection_ptr acquire(const ip::endpoint& server, bool& reused) {
+        auto itr = _idle_connections.find(server);
+        if (itr != _idle_connections.end() && !itr->second.empty()) {
+            connection_ptr connection = itr->second.back().first;
+            itr->second.pop_back();
+            reused = true;
+            return connection;
+        }
+
+        reused = false;
+        connection_ptr connection = std::make_shared<tcp_socket>();
+        connection->connect_to(server);
+        return connection;
+    }
+
+    void release(const ip::endpoint& server, const connection_ptr& connection) {
+        auto& idle = _idle_connections[server];
+        if (idle.size() >= BTS_MAIL_CLIENT_MAX_IDLE_CONNECTIONS_PER_SERVER) {
+            connection->close();
+            return;
+        }
+        idle.emplace_back(connection, fc::time_point::now());
+        if (!_sweep_future.valid() || _sweep_future.ready())
+            schedule_sweep();
+    }
+
+    void close() {
+        _sweep_future.cancel_and_wait("Mail connection pool closed");
+        for (auto& item : _idle_connections)
+            for (auto& connection : item.second)
+                connection.first->close();
+        _idle_connections.clear();
+    }
+
+    size_t idle_count() const {
+        size_t count = 0;
+        for (const auto& item : _idle_connections)
+            count += item.second.size();
+        return count;
+    }
+
+private:
+    void schedule_sweep() {
+        _sweep_future = fc::schedule([this] { sweep(); },
+                                     fc::time_point::now() + BTS_MAIL_CLIENT_CONNECTION_IDLE_TIMEOUT,
+                                     "Mail client connection sweep");
+    }
+
+    void sweep() {
+        const fc::time_point cutoff = fc::time_point::now() - BTS_MAIL_CLIENT_CONNECTION_IDLE_TIMEOUT;
+        for (auto itr = _idle_connections.begin(); itr != _idle_connections.end();) {
+            //Connections are released in order, so the longest idle are at the front
+            auto& idle = itr->second;
+            while (!idle.empty() && idle.front().second <= cutoff) {
+                idle.front().first->close();
+                idle.erase(idle.begin());
+            }
+            itr = idle.empty() ? _idle_connections.erase(itr) : std::next(itr);
+        }
+        if (!_idle_connections.empty())
+            schedule_sweep();
+    }
+
+    std::map<ip::endpoint, vector<std::pair<connection_ptr, fc::time_point>>> _idle_connections;
+    fc::future<void> _sweep_future;
+};
+
+typedef std::pair<string, vector<variant>> mail_server_request;
+
+class client_impl {
 public:
     client* self;
     wallet_ptr _wallet;
@@ -133,64 +221,41 @@ public:
     fc::future<void> _transmit_message_worker;
     fc::thread _proof_of_work_thread;
 
-    fc::future<void> _archive_indexing_future;
-    fc::thread _archive_indexing_thread;
-
     bts::db::cached_level_map<message_id_type, mail_record> _processing_db;
     bts::db::level_map<message_id_type, mail_archive_record> _archive;
     bts::db::cached_level_map<message_id_type, email_header> _inbox;
     bts::db::level_map<string, variant> _property_db;
 
-    multi_index_container<
-        mail_index_record,
-        indexed_by<
-            //Allow indexing by message ID
-            ordered_unique<
-                member<mail_index_record, message_id_type, &mail_index_record::id>
-            >,
-            //Allow indexing by sender-recipient pair
-            //This implicitly allows indexing by sender regardless of recipient
-            ordered_non_unique<
-                tag<sender,by_sender>,
-                composite_key<
-                    mail_index_record,
-                    member<mail_index_record, string, &mail_index_record::sender>,
-                    member<mail_index_record, string, &mail_index_record::recipient>,
-                    member<mail_index_record, time_point_sec, &mail_index_record::timestamp>
-                >
-            >,
-            //Allow indexing by recipient, regardless of sender
-            ordered_non_unique<
-                tag<recipient,by_recipient>,
-                composite_key<
-                    mail_index_record,
-                    member<mail_index_record, string, &mail_index_record::recipient>,
-                    member<mail_index_record, time_point_sec, &mail_index_record::timestamp>
-                >
-            >,
-            //Sort based on timestamp
-            ordered_non_unique<
-                tag<timestamp,by_timestamp>,
-                member<mail_index_record, time_point_sec, &mail_index_record::timestamp>
-            >
-        >
-    > _mail_index;
+    mail_connection_pool _connection_pool;
+
+    //Secondary indexes over _archive, maintained as messages are archived and removed
+    bts::db::level_map<message_id_type, mail_index_record> _archive_index;
+    bts::db::level_map<mail_index_key, mail_index_record> _sender_index;
+    bts::db::level_map<mail_index_key, mail_index_record> _recipient_index;
+    bts::db::level_map<mail_index_key, mail_index_record> _conversation_index;
 
     client_impl(client* self, wallet_ptr wallet, chain_database_ptr chain)
         : self(self),
           _wallet(wallet),
           _chain(chain),
-          _proof_of_work_thread("Mail client proof-of-work thread"),
-          _archive_indexing_thread("Mail client indexing thread")
+          _proof_of_work_thread("Mail client proof-of-work thread")
     {}
     ~client_impl(){
         _proof_of_work_worker.cancel_and_wait("Mail client destroyed");
-        _archive_indexing_future.cancel_and_wait();
+        _connection_pool.close();
 
+        close();
+    }
+
+    void close() {
         _archive.close();
         _processing_db.close();
         _inbox.close();
         _property_db.close();
+        _archive_index.close();
+        _sender_index.close();
+        _recipient_index.close();
+        _conversation_index.close();
     }
 
     void retry_message(mail_record email) {
@@ -219,10 +284,22 @@ public:
             _processing_db.open(data_dir / "processing");
             _inbox.open(data_dir / "inbox");
             _property_db.open(data_dir / "properties");
+            _archive_index.open(data_dir / "index/archive");
+            _sender_index.open(data_dir / "index/sender");
+            _recipient_index.open(data_dir / "index/recipient");
+            _conversation_index.open(data_dir / "index/conversation");
 
             if (!_property_db.fetch_optional("version"))
                 _property_db.store("version", BTS_MAIL_CLIENT_DATABASE_VERSION);
 
+            //Version 1 rebuilt the archive index in memory on every open; build the persistent indexes once
+            if (_property_db.fetch("version").as_int64() == 1) {
+                ilog("Building mail archive indexes...");
+                for (auto itr = _archive.begin(); itr.valid(); ++itr)
+                    index_message(mail_index_record(itr.value()));
+                _property_db.store("version", BTS_MAIL_CLIENT_DATABASE_VERSION);
+            }
+
             if (_property_db.fetch("version").as_int64() != BTS_MAIL_CLIENT_DATABASE_VERSION) {
                 elog("Unable to open mail client: database is wrong version. Supported: ${s}, stored: ${v}",
                      ("s", BTS_MAIL_CLIENT_DATABASE_VERSION)("v", _property_db.fetch("version").as_int64()));
@@ -232,23 +309,62 @@ public:
             //Place all in-processing messages back in their place on the pipeline
             for (auto itr = _processing_db.begin(); itr.valid(); ++itr)
                 retry_message(itr.value());
-
-            index_archive();
         } catch (...) {
-            _archive.close();
-            _processing_db.close();
-            _property_db.close();
+            close();
         }
     }
     bool is_open() {
         return _property_db.is_open();
     }
 
-    void index_archive() {
-        _archive_indexing_future = _archive_indexing_thread.async([this] {
-            for (auto itr = _archive.begin(); itr.valid() && !_archive_indexing_future.canceled(); ++itr)
-                _mail_index.insert(itr.value());
-        }, "Mail client indexing task");
+    static mail_index_key conversation_key(const mail_index_record& record) {
+        if (record.sender < record.recipient)
+            return mail_index_key{record.sender, record.recipient, record.timestamp, record.id};
+        return mail_index_key{record.recipient, record.sender, record.timestamp, record.id};
+    }
+
+    void index_message(const mail_index_record& record) {
+        //The sender label of a message we sent can change once we fetch it back from the server
+        unindex_message(record.id);
+        _archive_index.store(record.id, record);
+        _sender_index.store(mail_index_key{record.sender, string(), record.timestamp, record.id}, record);
+        _recipient_index.store(mail_index_key{record.recipient, string(), record.timestamp, record.id}, record);
+        _conversation_index.store(conversation_key(record), record);
+    }
+
+    void unindex_message(const message_id_type& message_id) {
+        auto record = _archive_index.fetch_optional(message_id);
+        if (!record)
+            return;
+        _sender_index.remove(mail_index_key{record->sender, string(), record->timestamp, record->id});
+        _recipient_index.remove(mail_index_key{record->recipient, string(), record->timestamp, record->id});
+        _conversation_index.remove(conversation_key(*record));
+        _archive_index.remove(message_id);
+    }
+
+    /**
+     * up to limit headers under (account, counterparty) strictly after the (start_time, start_after) cursor,
+     * oldest first; a null start_after returns everything at or after start_time
+     */
+    vector<email_header> scan_index(const bts::db::level_map<mail_index_key, mail_index_record>& index,
+                                    const string& account, const string& counterparty,
+                                    const fc::time_point_sec& start_time, const message_id_type& start_after,
+                                    uint32_t limit,
+                                    const std::function<bool(const mail_index_record&)>& filter = nullptr) {
+        vector<email_header> results;
+        for (auto itr = index.lower_bound(mail_index_key{account, counterparty, start_time, start_after});
+             itr.valid() && results.size() < limit;
+             ++itr) {
+            const mail_index_key key = itr.key();
+            if (key.account != account || key.counterparty != counterparty)
+                break;
+            if (key.timestamp == start_time && key.id == start_after)
+                continue;
+            const mail_index_record record = itr.value();
+            if (!filter || filter(record))
+                results.push_back(get_message(record.id).header);
+        }
+        return results;
     }
 
     void process_outgoing_mail(mail_record& mail) {
@@ -421,11 +537,17 @@ public:
             for (mail_server_endpoint server : email.mail_servers) {
                 transmit_tasks.push_back(fc::async([&, server] {
                     auto email = _processing_db.fetch(message_id);
-                    tcp_socket sock;
+                    vector<variant_object> responses;
 
                     try {
-                        sock.connect_to(server.second);
-                    } catch (fc::exception& e) {
+                        //Store the message and read it back in a single round trip
+                        responses = call_mail_server(server, {
+                            mail_server_request("mail_store_message", vector<variant>({variant(email.content)})),
+                            mail_server_request("mail_fetch_message", vector<variant>({variant(email.content.id())}))
+                        });
+                    } catch (const fc::canceled_exception&) {
+                        throw;
+                    } catch (const fc::exception& e) {
                         if (successful_servers.empty()) {
                             //Mark as failed only if no servers have succeeded yet.
                             //If it later succeeds, the status will be updated accordingly.
@@ -436,19 +558,7 @@ public:
                         return;
                     }
 
-                    mutable_variant_object request;
-                    request["id"] = 0;
-                    request["method"] = "mail_store_message";
-                    request["params"] = vector<variant>({variant(email.content)});
-
-                    fc::json::to_stream(sock, variant_object(request));
-                    string raw_response;
-                    fc::getline(sock, raw_response);
-                    variant_object response = fc::json::from_string(raw_response).as<variant_object>();
-
-                    if (response["id"].as_int64() != 0)
-                        wlog("Server response has wrong ID... attempting to press on. Expected: 0; got: ${r}",
-                             ("r", response["id"]));
+                    const variant_object& response = responses[0];
                     if (response.contains("error")) {
                         //Server actively rejects email. Something is definitely wrong; declare failure.
                         email.status = client::failed;
@@ -467,23 +577,11 @@ public:
                         }
                         _processing_db.store(message_id, email);
                         elog("Storing message with server ${server} failed: ${error}",
-                             ("server", server)("error", response["error"])("request", request));
-                        sock.close();
+                             ("server", server)("error", response["error"]));
                         return;
                     }
 
-                    request["id"] = 1;
-                    request["method"] = "mail_fetch_message";
-                    request["params"] = vector<variant>({variant(email.content.id())});
-
-                    fc::json::to_stream(sock, variant_object(request));
-                    fc::getline(sock, raw_response);
-                    response = fc::json::from_string(raw_response).as<variant_object>();
-
-                    if (response["id"].as_int64() != 1)
-                        wlog("Server response has wrong ID... attempting to press on. Expected: 1; got: ${r}",
-                             ("r", response["id"]));
-                    if (response["result"].as<message>().id() != email.content.id()) {
+                    if (!responses[1].contains("result") || responses[1]["result"].as<message>().id() != email.content.id()) {
                         //This should only happen in case of ripemd160 collision, I think... Hopefully never.
                         email.status = client::failed;
                         email.failure_reason = "Message saved to server, but server responded with "
@@ -491,7 +589,6 @@ public:
                         _processing_db.store(message_id, email);
                         elog("Storing message with server ${server} failed because server gave back wrong message.",
                              ("server", server));
-                        sock.close();
                         return;
                     }
 
@@ -539,7 +636,7 @@ public:
              ("id", message_id)("newid", email.content.id()));
         email.id = email.content.id();
         email.status = client::accepted;
-        _mail_index.insert(email_header(email));
+        index_message(email_header(email));
         _archive.store(email.id, std::move(email));
         _processing_db.remove(message_id);
     }
@@ -575,37 +672,29 @@ public:
         FC_ASSERT(false, "Message ${id} not found.", ("id", message_id));
     }
 
-    vector<email_header> get_messages_by_sender(string sender) {
-        vector<email_header> results;
-
-        for (auto itr = _mail_index.get<by_sender>().lower_bound(boost::make_tuple(sender));
-             itr != _mail_index.get<by_sender>().upper_bound(boost::make_tuple(sender));
-             ++itr)
-            results.push_back(get_message(itr->id).header);
-
-        return results;
+    vector<email_header> get_messages_by_sender(const string& sender, const fc::time_point_sec& start_time,
+                                                const message_id_type& start_after, uint32_t limit) {
+        return scan_index(_sender_index, sender, string(), start_time, start_after, limit);
     }
 
-    vector<email_header> get_messages_by_recipient(string recipient) {
-        vector<email_header> results;
-
-        for (auto itr = _mail_index.get<by_recipient>().lower_bound(boost::make_tuple(recipient));
-             itr != _mail_index.get<by_recipient>().upper_bound(boost::make_tuple(recipient));
-             ++itr)
-            results.push_back(get_message(itr->id).header);
-
-        return results;
+    vector<email_header> get_messages_by_recipient(const string& recipient, const fc::time_point_sec& start_time,
+                                                   const message_id_type& start_after, uint32_t limit) {
+        return scan_index(_recipient_index, recipient, string(), start_time, start_after, limit);
     }
 
-    vector<email_header> get_messages_from_to(string sender, string recipient) {
-        vector<email_header> results;
-
-        for (auto itr = _mail_index.get<by_sender>().lower_bound(boost::make_tuple(sender, recipient));
-             itr != _mail_index.get<by_sender>().upper_bound(boost::make_tuple(sender, recipient));
-             ++itr)
-            results.push_back(get_message(itr->id).header);
+    vector<email_header> get_messages_in_conversation(const string& account_one, const string& account_two,
+                                                      const fc::time_point_sec& start_time,
+                                                      const message_id_type& start_after, uint32_t limit) {
+        return scan_index(_conversation_index, std::min(account_one, account_two), std::max(account_one, account_two),
+                          start_time, start_after, limit);
+    }
 
-        return results;
+    vector<email_header> get_messages_from_to(const string& sender, const string& recipient,
+                                              const fc::time_point_sec& start_time,
+                                              const message_id_type& start_after, uint32_t limit) {
+        return scan_index(_conversation_index, std::min(sender, recipient), std::max(sender, recipient),
+                          start_time, start_after, limit,
+                          [&sender](const mail_index_record& record) { return record.sender == sender; });
     }
 
     vector<email_header> get_inbox() {
@@ -623,6 +712,137 @@ public:
             _inbox.remove(message_id);
     }
 
+    /**
+     * Writes all of requests to server over one pooled connection before reading any response, and returns the
+     * responses in request order. A reused connection the server has since dropped is replaced once.
+     */
+    vector<variant_object> call_mail_server(const mail_server_endpoint& server, const vector<mail_server_request>& requests) {
+        for (uint32_t attempt = 0; ; ++attempt) {
+            bool reused = false;
+            auto connection = _connection_pool.acquire(server.second, reused);
+            try {
+                for (size_t i = 0; i < requests.size(); ++i) {
+                    mutable_variant_object request;
+                    request["id"] = i;
+                    request["method"] = requests[i].first;
+                    request["params"] = requests[i].second;
+                    fc::json::to_stream(*connection, variant_object(request));
+                }
+
+                vector<variant_object> responses(requests.size());
+                for (size_t i = 0; i < requests.size(); ++i) {
+                    string raw_response;
+                    fc::getline(*connection, raw_response);
+                    variant_object response = fc::json::from_string(raw_response).as<variant_object>();
+                    const int64_t id = response["id"].as_int64();
+                    FC_ASSERT(id >= 0 && size_t(id) < responses.size(), "Server response has unexpected ID ${id}", ("id", id));
+                    responses[id] = std::move(response);
+                }
+
+                _connection_pool.release(server.second, connection);
+                return responses;
+            } catch (const fc::canceled_exception&) {
+                connection->close();
+                throw;
+            } catch (const fc::exception& e) {
+                connection->close();
+                if (!reused || attempt > 0)
+                    throw;
+                wlog("Pooled connection to mail server ${server} failed; reconnecting: ${e}",
+                     ("server", server)("e", e.to_string()));
+            }
+        }
+    }
+    variant_object call_mail_server(const mail_server_endpoint& server, const string& method, const vector<variant>& params) {
+        return call_mail_server(server, {mail_server_request(method, params)}).front();
+    }
+
+    /**
+     * Fetches messages in batches of BTS_MAIL_FETCH_MESSAGES_LIMIT. Servers that can't answer a batch get the
+     * individual requests pipelined instead. Messages the server doesn't have are skipped.
+     */
+    vector<message> fetch_messages(const mail_server_endpoint& server, const vector<message_id_type>& inventory_ids) {
+        vector<message> messages;
+        messages.reserve(inventory_ids.size());
+
+        for (size_t first = 0; first < inventory_ids.size(); first += BTS_MAIL_FETCH_MESSAGES_LIMIT) {
+            const vector<message_id_type> batch(inventory_ids.begin() + first,
+                                                inventory_ids.begin() + std::min<size_t>(first + BTS_MAIL_FETCH_MESSAGES_LIMIT,
+                                                                                         inventory_ids.size()));
+
+            const variant_object response = call_mail_server(server, "mail_fetch_messages", vector<variant>({variant(batch)}));
+            if (!response.contains("error")) {
+                for (message& item : response["result"].as<vector<message>>())
+                    messages.push_back(std::move(item));
+                continue;
+            }
+
+            vector<mail_server_request> requests;
+            requests.reserve(batch.size());
+            for (const message_id_type& inventory_id : batch)
+                requests.push_back(mail_server_request("mail_fetch_message", vector<variant>({variant(inventory_id)})));
+            for (const variant_object& single_response : call_mail_server(server, requests)) {
+                if (single_response.contains("error")) {
+                    elog("Server ${server} gave error ${error} fetching a message",
+                         ("server", server)("error", single_response["error"]));
+                    continue;
+                }
+                messages.push_back(single_response["result"].as<message>());
+            }
+        }
+
+        return messages;
+    }
+
+    void store_fetched_message(const wallet_account_record& account, const mail_server_endpoint& server, message&& ciphertext) {
+        message plaintext = _wallet->mail_open(account.account_address, ciphertext);
+        email_header header;
+        header.id = ciphertext.id();
+        if (plaintext.type == mail::email) {
+            signed_email_message email = plaintext.as<signed_email_message>();
+            try {
+               header.sender = _wallet->get_key_label(email.from());
+            } catch (fc::exception& e) {
+               header.sender = "INVALID SIGNATURE";
+            }
+            header.subject = std::move(email.subject);
+        } else if (plaintext.type == mail::transaction_notice) {
+            transaction_notice_message notice = plaintext.as<transaction_notice_message>();
+            try {
+               header.sender = _wallet->get_key_label(notice.from());
+            } catch (fc::exception& e) {
+               header.sender = "INVALID SIGNATURE";
+            }
+            header.subject = "Transaction Notification";
+            _wallet->scan_transaction(notice.trx.id().str(), true);
+            self->new_transaction_notifier(notice);
+        }
+        header.recipient = account.name;
+        header.timestamp = plaintext.timestamp;
+        mail_archive_record record(std::move(ciphertext), header, account.account_address);
+        bool new_mail = false;
+
+        if (auto optional_record = _archive.fetch_optional(header.id)) {
+            record = *optional_record;
+            if (record.status == client::accepted) {
+                //We sent this message, but it's still newly received mail
+                new_mail = true;
+                record.status = client::received;
+            }
+        } else
+            new_mail = true;
+
+        record.mail_servers.insert(server);
+
+        _archive.store(header.id, record);
+        index_message(header);
+
+        if (new_mail) {
+            _inbox.store(header.id, header);
+            ++_messages_in;
+        }
+    }
+
     int check_new_mail(bool get_old_messages) {
         auto accounts = _wallet->list_my_accounts();
         _messages_in = 0;
@@ -640,115 +860,35 @@ public:
 
             for (mail_server_endpoint server : servers) {
                 fetch_tasks.push_back(fc::async([=] {
-                    //TODO: This whole design needs to be rethought. This is just a simplistic first effort.
-                    //Right now we get the inventory, then download and store ALL of it locally.
-                    //Downloading is done synchronously, with one message downloaded before the next starts.
-                    //No deduplication of effort is done; i.e. if a given message is on three servers, we'll download
-                    //it three times.
-                    tcp_socket sock;
-
+                    //Inventory and messages come over pooled connections, with messages requested in batches.
+                    //No deduplication of effort is done; i.e. if a given message is on three servers, we'll
+                    //download it three times.
                     try {
-                        sock.connect_to(server.second);
-                    } catch (fc::exception& e) {
-                        elog("Failed to connect to mail server ${server}: ${e}",
+                        const auto fetch_page = [&](const fc::time_point& start_time, uint32_t limit) -> inventory_type {
+                            variant_object response = call_mail_server(server, "mail_fetch_inventory",
+                                                                       vector<variant>({variant(address(account.account_address)),
+                                                                                        variant(start_time),
+                                                                                        variant(limit)}));
+                            if (response.contains("error"))
+                                FC_THROW("Server ${server} gave error ${error} on inventory request",
+                                         ("server", server)("error", response["error"]));
+                            return response["result"].as<inventory_type>();
+                        };
+                        const auto process_page = [&](const inventory_type& results) {
+                            vector<message_id_type> inventory_ids;
+                            inventory_ids.reserve(results.size());
+                            for (const auto& item : results)
+                                inventory_ids.push_back(item.second);
+                            for (message& ciphertext : fetch_messages(server, inventory_ids))
+                                store_fetched_message(account, server, std::move(ciphertext));
+                        };
+                        page_inventory(fc::time_point(last_check_time), BTS_MAIL_CLIENT_MAX_INVENTORY_SIZE,
+                                       fetch_page, process_page);
+                    } catch (const fc::canceled_exception&) {
+                        throw;
+                    } catch (const fc::exception& e) {
+                        elog("Failed to fetch mail from server ${server}: ${e}",
                              ("server", server)("e", e.to_detail_string()));
-                        return;
-                    }
-
-                    int received = BTS_MAIL_CLIENT_MAX_INVENTORY_SIZE;
-                    while (received == BTS_MAIL_CLIENT_MAX_INVENTORY_SIZE) {
-                        mutable_variant_object request;
-                        request["id"] = 0;
-                        request["method"] = "mail_fetch_inventory";
-                        request["params"] = vector<variant>({variant(address(account.account_address)),
-                                                             variant(last_check_time),
-                                                             variant(BTS_MAIL_CLIENT_MAX_INVENTORY_SIZE)});
-
-                        fc::json::to_stream(sock, variant_object(request));
-                        string raw_response;
-                        fc::getline(sock, raw_response);
-                        variant_object response = fc::json::from_string(raw_response).as<variant_object>();
-
-                        if (response["id"].as_int64() != 0)
-                            wlog("Server response has wrong ID... attempting to press on. Expected: 0; got: ${r}",
-                                 ("r", response["id"]));
-                        if (response.contains("error")) {
-                            elog("Server ${server} gave error ${error} on request ${request}",
-                                 ("server", server)("error", response["error"])("request", request));
-                            sock.close();
-                            return;
-                        }
-
-                        inventory_type results = response["result"].as<inventory_type>();
-                        received = results.size();
-
-                        for (std::pair<fc::time_point, message_id_type> email : results) {
-                            request["id"] = 1;
-                            request["method"] = "mail_fetch_message";
-                            request["params"] = vector<variant>({variant(email.second)});
-
-                            fc::json::to_stream(sock, variant_object(request));
-                            fc::getline(sock, raw_response);
-                            response = fc::json::from_string(raw_response).as<variant_object>();
-
-                            if (response["id"].as_int64() != 1)
-                                wlog("Server response has wrong ID... attempting to press on. Expected: 1; got: ${r}",
-                                     ("r", response["id"]));
-                            if (response.contains("error")) {
-                                elog("Server ${server} gave error ${error} on request ${request}",
-                                     ("server", server)("error", response["error"])("request", request));
-                                sock.close();
-                                return;
-                            }
-
-                            message ciphertext = response["result"].as<message>();
-                            message plaintext = _wallet->mail_open(account.account_address, ciphertext);
-                            email_header header;
-                            header.id = ciphertext.id();
-                            if (plaintext.type == mail::email) {
-                                signed_email_message email = plaintext.as<signed_email_message>();
-                                try {
-                                   header.sender = _wallet->get_key_label(email.from());
-                                } catch (fc::exception& e) {
-                                   header.sender = "INVALID SIGNATURE";
-                                }
-                                header.subject = std::move(email.subject);
-                            } else if (plaintext.type == mail::transaction_notice) {
-                                transaction_notice_message notice = plaintext.as<transaction_notice_message>();
-                                try {
-                                   header.sender = _wallet->get_key_label(notice.from());
-                                } catch (fc::exception& e) {
-                                   header.sender = "INVALID SIGNATURE";
-                                }
-                                header.subject = "Transaction Notification";
-                                _wallet->scan_transaction(notice.trx.id().str(), true);
-                                self->new_transaction_notifier(notice);
-                            }
-                            header.recipient = account.name;
-                            header.timestamp = plaintext.timestamp;
-                            mail_archive_record record(std::move(ciphertext), header, account.account_address);
-                            bool new_mail = false;
-
-                            if (auto optional_record = _archive.fetch_optional(email.second)) {
-                                record = *optional_record;
-                                if (record.status == client::accepted) {
-                                    //We sent this message, but it's still newly received mail
-                                    new_mail = true;
-                                    record.status = client::received;
-                                }
-                            } else
-                                new_mail = true;
-
-                            record.mail_servers.insert(std::move(server));
-
-                            _archive.store(email.second, record);
-                            _mail_index.insert(header);
-
-                            if (new_mail) {
-                                _inbox.store(header.id, header);
-                                ++_messages_in;
-                            }
-                        }
                     }
                 }, "Mail client fetcher"));
             }
@@ -816,8 +956,10 @@ void client::remove_message(message_id_type message_id)
         my->_processing_db.remove(message_id);
     } else {
         auto itr = my->_archive.find(message_id);
-        if (itr.valid())
+        if (itr.valid()) {
+            my->unindex_message(message_id);
             my->_archive.remove(message_id);
+        }
     }
 }
 
@@ -897,37 +1039,56 @@ message_id_type client::send_encrypted_message(message&& ciphertext,
     return mail_rec.id;
 }
 
-std::vector<email_header> client::get_messages_by_sender(std::string sender)
+std::vector<email_header> client::get_messages_by_sender(const std::string& sender,
+                                                         const fc::time_point_sec& start_time, uint32_t limit,
+                                                         const message_id_type& start_after)
 {
     FC_ASSERT(my->is_open());
-    if (my->_archive_indexing_future.valid() && !my->_archive_indexing_future.ready()) {
-        ulog("Mail archive is currently indexing. Please try again later.");
-        return vector<email_header>();
-    }
-
-    return my->get_messages_by_sender(sender);
+    return my->get_messages_by_sender(sender, start_time, start_after, limit);
 }
 
-std::vector<email_header> client::get_messages_by_recipient(std::string recipient)
+std::vector<email_header> client::get_messages_by_recipient(const std::string& recipient,
+                                                            const fc::time_point_sec& start_time, uint32_t limit,
+                                                            const message_id_type& start_after)
 {
     FC_ASSERT(my->is_open());
-    if (my->_archive_indexing_future.valid() && !my->_archive_indexing_future.ready()) {
-        ulog("Mail archive is currently indexing. Please try again later.");
-        return vector<email_header>();
-    }
+    return my->get_messages_by_recipient(recipient, start_time, start_after, limit);
+}
 
-    return my->get_messages_by_recipient(recipient);
+std::vector<email_header> client::get_messages_from_to(const std::string& sender, const std::string& recipient,
+                                                       const fc::time_point_sec& start_time, uint32_t limit,
+                                                       const message_id_type& start_after)
+{
+    FC_ASSERT(my->is_open());
+    return my->get_messages_from_to(sender, recipient, start_time, start_after, limit);
 }
 
-std::vector<email_header> client::get_messages_from_to(std::string sender, std::string recipient)
+std::vector<email_header> client::get_messages_in_conversation(const std::string& account_one, const std::string& account_two,
+                                                               const fc::time_point_sec& start_time, uint32_t limit,
+                                                               const message_id_type& start_after)
 {
     FC_ASSERT(my->is_open());
-    if (my->_archive_indexing_future.valid() && !my->_archive_indexing_future.ready()) {
-        ulog("Mail archive is currently indexing. Please try again later.");
-        return vector<email_header>();
-    }
+    return my->get_messages_in_conversation(account_one, account_two, start_time, start_after, limit);
+}
 
-    return my->get_messages_from_to(sender, recipient);
+fc::variant_object client::get_memory_usage() const
+{
+    fc::mutable_variant_object tables;
+    uint64_t total_bytes = 0;
+    const auto add_cached_table = [&](const string& name, uint64_t entries, uint64_t bytes) {
+        fc::mutable_variant_object usage;
+        usage["entries"] = entries;
+        usage["bytes"] = bytes;
+        total_bytes += bytes;
+        tables[name] = usage;
+    };
+    add_cached_table("processing", my->_processing_db.size(), my->_processing_db.memory_usage());
+    add_cached_table("inbox", my->_inbox.size(), my->_inbox.memory_usage());
+
+    fc::mutable_variant_object result;
+    result["total_bytes"] = total_bytes;
+    result["tables"] = tables;
+    return result;
 }
 
 email_header::email_header(const detail::mail_record &processing_record)
@@ -980,3 +1141,5 @@ FC_REFLECT(bts::mail::detail::mail_record, (id)(status)(sender)(recipient)
            (recipient_key)(content)(mail_servers)(proof_of_work_target))
 FC_REFLECT(bts::mail::detail::mail_archive_record, (id)(status)(sender)
            (recipient)(recipient_address)(content)(mail_servers))
+FC_REFLECT(bts::mail::detail::mail_index_record, (id)(sender)(recipient)(timestamp))
+FC_REFLECT(bts::mail::detail::mail_index_key, (account)(counterparty)(timestamp)(id))
@@ -62,9 +62,25 @@ public:
                                            const string& to,
                                            const blockchain::public_key_type& recipient_key);
 
-    std::vector<email_header> get_messages_by_sender(string sender);
-    std::vector<email_header> get_messages_by_recipient(string recipient);
-    std::vector<email_header> get_messages_from_to(string sender, string recipient);
+    /**
+     * archived messages in (timestamp, id) order, returning at most limit. Results start at start_time; to fetch
+     * the next page, pass the timestamp and id of the last header returned and only later messages come back.
+     */
+    std::vector<email_header> get_messages_by_sender(const string& sender,
+                                                     const fc::time_point_sec& start_time, uint32_t limit,
+                                                     const message_id_type& start_after = message_id_type());
+    std::vector<email_header> get_messages_by_recipient(const string& recipient,
+                                                        const fc::time_point_sec& start_time, uint32_t limit,
+                                                        const message_id_type& start_after = message_id_type());
+    std::vector<email_header> get_messages_from_to(const string& sender, const string& recipient,
+                                                   const fc::time_point_sec& start_time, uint32_t limit,
+                                                   const message_id_type& start_after = message_id_type());
+    std::vector<email_header> get_messages_in_conversation(const string& account_one, const string& account_two,
+                                                           const fc::time_point_sec& start_time, uint32_t limit,
+                                                           const message_id_type& start_after = message_id_type());
+
+    /** approximate bytes held by the processing and inbox caches */
+    fc::variant_object get_memory_usage() const;
 private:
     std::shared_ptr<detail::client_impl> my;
 };
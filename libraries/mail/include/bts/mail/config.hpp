@@ -1,7 +1,13 @@
 #pragma once
 
 #define BTS_MAIL_INVENTORY_FETCH_LIMIT 4096
+#define BTS_MAIL_FETCH_MESSAGES_LIMIT 64
+#define BTS_MAIL_REPLICATION_TIMEOUT (fc::seconds(10))
 #define BTS_MAIL_MAX_MESSAGE_SIZE_BYTES (1024*1024)
 #define BTS_MAIL_MAX_MESSAGE_AGE (fc::minutes(5))
+#define BTS_MAIL_MAX_REPLICATED_MESSAGE_AGE (fc::days(3))
 #define BTS_MAIL_PROOF_OF_WORK_TARGET (fc::ripemd160("000ffffffdeadbeeffffffffffffffffffffffff"))
 #define BTS_MAIL_DEFAULT_MAIL_SERVERS (std::unordered_set<std::string>({}))
+
+#define BTS_MAIL_CLIENT_CONNECTION_IDLE_TIMEOUT (fc::seconds(60))
+#define BTS_MAIL_CLIENT_MAX_IDLE_CONNECTIONS_PER_SERVER 4
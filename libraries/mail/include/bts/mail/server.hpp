@@ -3,7 +3,11 @@
 #include <bts/mail/message.hpp>
 #include <bts/mail/config.hpp>
 
+#include <fc/network/ip.hpp>
+
+#include <functional>
 #include <map>
+#include <memory>
 
 namespace bts { namespace mail {
 
@@ -11,6 +15,21 @@ namespace bts { namespace mail {
 
    typedef std::vector< std::pair< fc::time_point, message_id_type > > inventory_type;
 
+   /**
+    *  Another mail server that newly accepted messages are replicated to.  Their ids are announced
+    *  first, and only the messages the peer reports missing are sent to it.
+    */
+   class replication_peer
+   {
+      public:
+         virtual ~replication_peer(){}
+
+         /** returns the ids among inventory_ids that the peer doesn't have */
+         virtual std::vector<message_id_type> announce_inventory( const std::vector<message_id_type>& inventory_ids ) = 0;
+         virtual void                         store_replicated( const std::vector<message>& messages ) = 0;
+   };
+   typedef std::shared_ptr<replication_peer> replication_peer_ptr;
+
    /**
     *  The mail server is designed to facilitate light weight clients and provide them
     *  with the information they need to use the blockchain.  When a user broadcasts
@@ -21,6 +40,15 @@ namespace bts { namespace mail {
     *  mail_store( owner, message )
     *  mail_fetch_inventory( owner, start_time, limit ) => vector<message_id_type>
     *  mail_fetch_message( message_id_type )
+    *  mail_fetch_messages( vector<message_id_type> ) => vector<message>
+    *
+    *  Servers can be configured with replication peers.  Every message a server accepts, from a
+    *  client or from another server, is announced to its peers, so a client only has to upload to
+    *  one server and can read from whichever replica is closest.  The replication methods require
+    *  a logged in RPC connection, so a server only accepts replicas from peers holding its credentials.
+    *
+    *  mail_announce_inventory( vector<message_id_type> ) => vector<message_id_type> missing
+    *  mail_store_replicated_messages( vector<message> )
     */
     class server : public std::enable_shared_from_this<server>
     {
@@ -37,6 +65,20 @@ namespace bts { namespace mail {
                                           const fc::time_point& start, 
                                           uint32_t limit = BTS_MAIL_INVENTORY_FETCH_LIMIT )const;
           message fetch_message( const message_id_type& inventory_id )const;
+          /** the first BTS_MAIL_FETCH_MESSAGES_LIMIT of the requested messages, skipping any not stored here */
+          std::vector<message> fetch_messages( const std::vector<message_id_type>& inventory_ids )const;
+
+          /** the ids among inventory_ids that are not stored here yet */
+          std::vector<message_id_type> announce_inventory( const std::vector<message_id_type>& inventory_ids )const;
+          /**
+           *  stores messages another server accepted, skipping any already stored or older than
+           *  BTS_MAIL_MAX_REPLICATED_MESSAGE_AGE, and passes new ones on
+           */
+          void store_replicated( const std::vector<message>& messages );
+
+          void add_replication_peer( const replication_peer_ptr& peer );
+          /** replicates to the mail server reachable over JSON-RPC at peer_endpoint, logging in with the given credentials */
+          void add_replication_peer( const fc::ip::endpoint& peer_endpoint, const std::string& rpc_user, const std::string& rpc_password );
 
        private:
           std::unique_ptr<detail::server_impl> my;
@@ -44,4 +86,15 @@ namespace bts { namespace mail {
 
     typedef std::shared_ptr<server> mail_server_ptr;
 
+   /**
+    *  Reads an inventory page_size entries at a time, starting at start.  Each page after the first starts
+    *  at the time of the last entry received, inclusive, and entries already processed are dropped by
+    *  message id, so entries sharing a timestamp are neither repeated nor skipped.  If a server rounds
+    *  the cursor down and returns only entries already processed, the page is widened, up to
+    *  BTS_MAIL_INVENTORY_FETCH_LIMIT, until it reaches past them.  Stops at a short page.
+    */
+   void page_inventory( const fc::time_point& start, uint32_t page_size,
+                        const std::function<inventory_type( const fc::time_point& start, uint32_t limit )>& fetch_page,
+                        const std::function<void( const inventory_type& page )>& process_page );
+
 } } // bts::mail
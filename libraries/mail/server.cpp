@@ -5,8 +5,15 @@
 #include <bts/blockchain/time.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/crypto/ripemd160.hpp>
+#include <fc/io/json.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/time.hpp>
 
+#include <algorithm>
+#include <deque>
+#include <set>
+
 namespace bts { namespace mail {
 
 struct mail_index
@@ -34,6 +41,80 @@ namespace bts { namespace mail {
 
    namespace detail
    {
+      /** a replication peer reached through the mail RPC methods of a remote client */
+      class tcp_replication_peer : public replication_peer
+      {
+         public:
+            tcp_replication_peer( const fc::ip::endpoint& endpoint, const std::string& rpc_user, const std::string& rpc_password )
+               : _endpoint( endpoint ), _rpc_user( rpc_user ), _rpc_password( rpc_password ) {}
+
+            virtual vector<message_id_type> announce_inventory( const vector<message_id_type>& inventory_ids ) override
+            {
+               return call( "mail_announce_inventory", fc::variant( inventory_ids ) ).as<vector<message_id_type>>();
+            }
+
+            virtual void store_replicated( const vector<message>& messages ) override
+            {
+               call( "mail_store_replicated_messages", fc::variant( messages ) );
+            }
+
+         private:
+            fc::variant call( const std::string& method, const fc::variant& param )
+            { try {
+               fc::variant_object response;
+               try
+               {
+                  if( !_socket )
+                  {
+                     _socket = std::make_shared<fc::tcp_socket>();
+                     _socket->connect_to( _endpoint );
+
+                     // the replication methods are only served to logged in connections
+                     const fc::variant_object login_response = send( "login", vector<fc::variant>{ _rpc_user, _rpc_password } );
+                     if( login_response.contains( "error" ) )
+                        FC_THROW( "Replication peer rejected our login: ${error}", ("error",login_response["error"]) );
+                  }
+
+                  response = send( method, vector<fc::variant>{ param } );
+               }
+               catch( ... )
+               {
+                  // drop the connection so the next call starts on a fresh one
+                  _socket.reset();
+                  throw;
+               }
+
+               if( response.contains( "error" ) )
+                  FC_THROW( "Replication peer rejected ${method}: ${error}", ("method",method)("error",response["error"]) );
+               return response.contains( "result" ) ? response["result"] : fc::variant();
+            } FC_CAPTURE_AND_RETHROW( (_endpoint)(method) ) }
+
+            fc::variant_object send( const std::string& method, const vector<fc::variant>& params )
+            {
+               fc::mutable_variant_object request;
+               request["id"] = ++_next_request_id;
+               request["method"] = method;
+               request["params"] = params;
+               fc::json::to_stream( *_socket, fc::variant_object( request ) );
+
+               std::string raw_response;
+               fc::getline( *_socket, raw_response );
+               return fc::json::from_string( raw_response ).get_object();
+            }
+
+            fc::ip::endpoint                  _endpoint;
+            std::string                       _rpc_user;
+            std::string                       _rpc_password;
+            std::shared_ptr<fc::tcp_socket>   _socket;
+            int64_t                           _next_request_id = 0;
+      };
+
+      struct replication_peer_state
+      {
+         replication_peer_ptr          peer;
+         std::deque<message_id_type>   pending; ///< accepted here but not yet announced to peer
+      };
+
       class server_impl
       {
           public:
@@ -46,6 +127,7 @@ namespace bts { namespace mail {
             ~server_impl()
             {
                try {
+                  _replication_task.cancel_and_wait( "mail server closed" );
                   _mail_inventory_db.close();
                   _mail_data_db.close();
                } 
@@ -67,10 +149,48 @@ namespace bts { namespace mail {
                if( _mail_data_db.fetch_optional(inventory_id) )
                   FC_THROW_EXCEPTION( message_already_stored, "Message already stored on server." );
 
-               _mail_inventory_db.store( mail_index{msg.recipient,fc::time_point::now()}, inventory_id );
-               _mail_data_db.store( inventory_id, msg );
+               store_message( inventory_id, msg );
             } FC_CAPTURE_AND_RETHROW( (msg) ) }
 
+            /** A message that fails validation is logged and skipped rather than failing the rest */
+            void store_replicated( const vector<message>& messages )
+            {
+               for( const message& msg : messages )
+               {
+                  const auto inventory_id = msg.id();
+                  if( _mail_data_db.fetch_optional( inventory_id ) )
+                     continue;
+
+                  try
+                  {
+                     FC_ASSERT( msg.data.size() > 0 );
+                     check_replicated_message( msg );
+                     store_message( inventory_id, msg );
+                  }
+                  catch( const fc::exception& e )
+                  {
+                     wlog( "rejecting replicated message ${id}: ${e}", ("id",inventory_id)("e",e.to_detail_string()) );
+                  }
+               }
+            }
+
+            vector<message_id_type> announce_inventory( const vector<message_id_type>& inventory_ids )
+            {
+               vector<message_id_type> missing;
+               for( const auto& inventory_id : inventory_ids )
+                  if( !_mail_data_db.fetch_optional( inventory_id ) )
+                     missing.push_back( inventory_id );
+               return missing;
+            }
+
+            void add_replication_peer( const replication_peer_ptr& peer )
+            {
+               FC_ASSERT( peer );
+               replication_peer_state state;
+               state.peer = peer;
+               _replication_peers.push_back( std::move( state ) );
+            }
+
             inventory_type fetch_inventory( const bts::blockchain::address& owner, 
                                             const fc::time_point& start, 
                                             uint32_t limit = BTS_MAIL_INVENTORY_FETCH_LIMIT )
@@ -99,15 +219,50 @@ namespace bts { namespace mail {
                return _mail_data_db.fetch( inventory_id );
             } FC_CAPTURE_AND_RETHROW( (inventory_id) ) }
 
+            vector<message> fetch_messages( const vector<message_id_type>& inventory_ids )
+            { try {
+               const size_t count = std::min<size_t>( inventory_ids.size(), BTS_MAIL_FETCH_MESSAGES_LIMIT );
+
+               vector<message> result;
+               result.reserve( count );
+               for( size_t i = 0; i < count; ++i )
+               {
+                  auto msg = _mail_data_db.fetch_optional( inventory_ids[i] );
+                  if( msg )
+                     result.push_back( std::move( *msg ) );
+               }
+               return result;
+            } FC_CAPTURE_AND_RETHROW( (inventory_ids) ) }
+
             void check_incoming_message( const message& msg )
             { try {
                auto now = blockchain::now();
-               if( msg.timestamp > now )
-                  FC_THROW_EXCEPTION( timestamp_in_future,
+               if( now - msg.timestamp > BTS_MAIL_MAX_MESSAGE_AGE )
+                  FC_THROW_EXCEPTION( timestamp_too_old,
                                       "Incoming message has timestamp ${message_stamp}, but current time is ${now}",
                                       ("message_stamp", msg.timestamp)("now", now) );
-               if( now - msg.timestamp > BTS_MAIL_MAX_MESSAGE_AGE )
+               check_message_contents( msg );
+            } FC_CAPTURE_AND_RETHROW( (msg) ) }
+
+            /**
+             *  A message can sit in a replication queue while a peer is down, so replicated messages get the
+             *  looser BTS_MAIL_MAX_REPLICATED_MESSAGE_AGE rather than the upload bound.
+             */
+            void check_replicated_message( const message& msg )
+            { try {
+               auto now = blockchain::now();
+               if( now - msg.timestamp > BTS_MAIL_MAX_REPLICATED_MESSAGE_AGE )
                   FC_THROW_EXCEPTION( timestamp_too_old,
+                                      "Replicated message has timestamp ${message_stamp}, but current time is ${now}",
+                                      ("message_stamp", msg.timestamp)("now", now) );
+               check_message_contents( msg );
+            } FC_CAPTURE_AND_RETHROW( (msg) ) }
+
+            void check_message_contents( const message& msg )
+            { try {
+               auto now = blockchain::now();
+               if( msg.timestamp > now )
+                  FC_THROW_EXCEPTION( timestamp_in_future,
                                       "Incoming message has timestamp ${message_stamp}, but current time is ${now}",
                                       ("message_stamp", msg.timestamp)("now", now) );
                if( msg.id() > BTS_MAIL_PROOF_OF_WORK_TARGET )
@@ -121,8 +276,106 @@ namespace bts { namespace mail {
             } FC_CAPTURE_AND_RETHROW( (msg) ) }
 
          private:
+            void store_message( const message_id_type& inventory_id, const message& msg )
+            {
+               // messages stored within the same microsecond, as a replicated batch can be, would share an inventory key
+               const fc::time_point received = std::max( fc::time_point::now(), _last_received + fc::microseconds( 1 ) );
+               _last_received = received;
+
+               _mail_inventory_db.store( mail_index{msg.recipient,received}, inventory_id );
+               _mail_data_db.store( inventory_id, msg );
+
+               for( auto& state : _replication_peers )
+                  state.pending.push_back( inventory_id );
+               schedule_replication( fc::time_point::now() );
+            }
+
+            void schedule_replication( const fc::time_point& when )
+            {
+               if( _replication_peers.empty() || (_replication_task.valid() && !_replication_task.ready()) )
+                  return;
+               _replication_task = fc::schedule( [this](){ replicate_pending(); }, when, "mail_server_replication" );
+            }
+
+            /**
+             *  Announces pending ids to each peer in batches and sends whatever the peer is missing.
+             *  A peer that fails or times out keeps its queue and is retried after BTS_MAIL_REPLICATION_TIMEOUT.
+             */
+            void replicate_pending()
+            {
+               std::set<size_t> failed_peers;
+               bool progressed = true;
+               while( progressed )
+               {
+                  // messages stored while a peer was being served are picked up by another pass
+                  progressed = false;
+                  for( size_t i = 0; i < _replication_peers.size(); ++i )
+                  {
+                     replication_peer_state& state = _replication_peers[i];
+                     while( !state.pending.empty() && !failed_peers.count( i ) )
+                     {
+                        const size_t count = std::min<size_t>( state.pending.size(), BTS_MAIL_FETCH_MESSAGES_LIMIT );
+                        const vector<message_id_type> batch( state.pending.begin(), state.pending.begin() + count );
+                        try
+                        {
+                           const replication_peer_ptr peer = state.peer;
+                           auto exchange = fc::async( [=](){ replicate_to_peer( *peer, batch ); }, "mail_server_replicate_to_peer" );
+                           try
+                           {
+                              exchange.wait( BTS_MAIL_REPLICATION_TIMEOUT );
+                           }
+                           catch( const fc::timeout_exception& )
+                           {
+                              exchange.cancel_and_wait( "mail replication timed out" );
+                              throw;
+                           }
+                        }
+                        catch( const fc::canceled_exception& )
+                        {
+                           throw;
+                        }
+                        catch( const fc::exception& e )
+                        {
+                           wlog( "mail replication to a peer failed, will retry: ${e}", ("e",e.to_detail_string()) );
+                           failed_peers.insert( i );
+                           break;
+                        }
+                        state.pending.erase( state.pending.begin(), state.pending.begin() + count );
+                        progressed = true;
+                     }
+                  }
+               }
+
+               if( !failed_peers.empty() )
+                  _replication_task = fc::schedule( [this](){ replicate_pending(); },
+                                                    fc::time_point::now() + BTS_MAIL_REPLICATION_TIMEOUT,
+                                                    "mail_server_replication" );
+            }
+
+            void replicate_to_peer( replication_peer& peer, const vector<message_id_type>& batch )
+            {
+               const vector<message_id_type> missing = peer.announce_inventory( batch );
+               if( missing.empty() )
+                  return;
+
+               vector<message> messages;
+               messages.reserve( missing.size() );
+               for( const auto& inventory_id : missing )
+               {
+                  auto msg = _mail_data_db.fetch_optional( inventory_id );
+                  if( msg )
+                     messages.push_back( std::move( *msg ) );
+               }
+               if( !messages.empty() )
+                  peer.store_replicated( messages );
+            }
+
             bts::db::level_pod_map< mail_index, message_id_type >   _mail_inventory_db;
             bts::db::level_map< message_id_type, message >          _mail_data_db;
+            fc::time_point                                          _last_received;
+
+            std::deque<replication_peer_state>                      _replication_peers;
+            fc::future<void>                                        _replication_task;
       };
 
    } // namespace detail
@@ -156,6 +409,76 @@ namespace bts { namespace mail {
    {
       return my->fetch_message( inventory_id );
    }
+   vector<message> server::fetch_messages( const vector<message_id_type>& inventory_ids )const
+   {
+      return my->fetch_messages( inventory_ids );
+   }
+
+   vector<message_id_type> server::announce_inventory( const vector<message_id_type>& inventory_ids )const
+   {
+      return my->announce_inventory( inventory_ids );
+   }
+   void server::store_replicated( const vector<message>& messages )
+   {
+      my->store_replicated( messages );
+   }
+
+   void server::add_replication_peer( const replication_peer_ptr& peer )
+   {
+      my->add_replication_peer( peer );
+   }
+   void server::add_replication_peer( const fc::ip::endpoint& peer_endpoint, const std::string& rpc_user, const std::string& rpc_password )
+   {
+      my->add_replication_peer( std::make_shared<detail::tcp_replication_peer>( peer_endpoint, rpc_user, rpc_password ) );
+   }
+
+   void page_inventory( const fc::time_point& start, uint32_t page_size,
+                        const std::function<inventory_type( const fc::time_point& start, uint32_t limit )>& fetch_page,
+                        const std::function<void( const inventory_type& page )>& process_page )
+   { try {
+      FC_ASSERT( page_size > 0 );
+      fc::time_point cursor = start;
+      std::set<message_id_type> seen_at_cursor;
+      uint32_t limit = std::min<uint32_t>( page_size, BTS_MAIL_INVENTORY_FETCH_LIMIT );
+      while( true )
+      {
+         inventory_type page = fetch_page( cursor, limit );
+         const bool last_page = page.size() < limit;
+
+         // the cursor is inclusive, and a server that rounds it down hands back even more we already have
+         page.erase( std::remove_if( page.begin(), page.end(),
+                                     [&]( const inventory_type::value_type& entry )
+                                     {
+                                        return entry.first < cursor
+                                               || (entry.first == cursor && seen_at_cursor.count( entry.second ) > 0);
+                                     } ),
+                     page.end() );
+         if( page.empty() )
+         {
+            if( last_page )
+               return;
+            // a full page of entries we already have: ask for more at once until it reaches past them
+            if( limit >= BTS_MAIL_INVENTORY_FETCH_LIMIT )
+            {
+               wlog( "mail inventory stopped advancing at ${cursor}", ("cursor",cursor) );
+               return;
+            }
+            limit = std::min<uint32_t>( limit * 2, BTS_MAIL_INVENTORY_FETCH_LIMIT );
+            continue;
+         }
+
+         process_page( page );
+         if( last_page )
+            return;
+         if( page.back().first != cursor )
+         {
+            cursor = page.back().first;
+            seen_at_cursor.clear();
+         }
+         for( auto itr = page.rbegin(); itr != page.rend() && itr->first == cursor; ++itr )
+            seen_at_cursor.insert( itr->second );
+      }
+   } FC_CAPTURE_AND_RETHROW( (start)(page_size) ) }
 
 } } // bts::mail
 
@@ -26,3 +26,6 @@ namespace bts { namespace net {
 
 static_assert((int)bts::net::block_message_type == (int)bts::client::block_message_type, "enum values don't match");
 static_assert((int)bts::net::trx_message_type == (int)bts::client::trx_message_type, "enum values don't match");
+static_assert((int)bts::net::compact_block_message_type == (int)bts::client::compact_block_message_type, "enum values don't match");
+static_assert((int)bts::net::fetch_compact_block_transactions_message_type == (int)bts::client::fetch_compact_block_transactions_message_type, "enum values don't match");
+static_assert((int)bts::net::compact_block_transactions_message_type == (int)bts::client::compact_block_transactions_message_type, "enum values don't match");
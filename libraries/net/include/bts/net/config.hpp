@@ -48,3 +48,10 @@
 #define BTS_NET_MAX_INVENTORY_SIZE_IN_MINUTES           2
 
 #define BTS_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      100
+
+/**
+ * Compact blocks that arrive referring to transactions we don't have are held
+ * while we fetch the missing transactions from the peer that sent them.  This
+ * bounds how many of those we'll hold at once.
+ */
+#define BTS_NET_MAX_PARTIAL_COMPACT_BLOCKS              16
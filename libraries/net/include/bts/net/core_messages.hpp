@@ -40,6 +40,9 @@ namespace bts { namespace net {
   {
     trx_message_type                             = 1000,
     block_message_type                           = 1001,
+    compact_block_message_type                   = 1002,
+    fetch_compact_block_transactions_message_type= 1003,
+    compact_block_transactions_message_type      = 1004,
     core_message_type_first                      = 5000,
     item_ids_inventory_message_type              = 5001,
     blockchain_item_ids_inventory_message_type   = 5002,
@@ -354,6 +357,9 @@ namespace bts { namespace net {
 FC_REFLECT_ENUM( bts::net::core_message_type_enum, 
                  (trx_message_type)
                  (block_message_type)
+                 (compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)
+                 (compact_block_transactions_message_type)
                  (core_message_type_first)
                  (item_ids_inventory_message_type)
                  (blockchain_item_ids_inventory_message_type)
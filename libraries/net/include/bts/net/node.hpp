@@ -7,6 +7,9 @@
 #include <bts/net/peer_database.hpp>
 
 #include <list>
+#include <map>
+#include <queue>
+#include <random>
 
 namespace bts { namespace net {
 
@@ -30,6 +33,21 @@ namespace bts { namespace net {
     node_id_t originating_peer;
   };
 
+  /** how a block broadcast from this node reached its peers, see node::get_block_delivery_data */
+  struct block_delivery_data
+  {
+    fc::time_point               broadcast_time;
+    fc::optional<fc::time_point> first_peer_send_time;       ///< when the block was first queued for sending to a peer
+    std::vector<fc::time_point>  peer_acknowledgement_times; ///< when each peer requested the block from us, advertised it back or had it pushed over the delegate relay, in order
+  };
+
+  /** what the client made of a compact block, see node_delegate::handle_compact_block */
+  struct compact_block_result
+  {
+    /** indexes of the block's transactions to fetch from the peer that sent it; empty once the block has been pushed */
+    std::vector<uint16_t> missing_transaction_indexes;
+  };
+
    /**
     *  @class node_delegate
     *  @brief used by node reports status to client or fetch data from client
@@ -56,6 +74,14 @@ namespace bts { namespace net {
           */
          virtual bool handle_message( const message&, bool sync_mode ) = 0;
 
+         /**
+          *  Rebuilds a block from a compact_block_message, or from the compact_block_transactions_message
+          *  answering an earlier result's missing transactions, and pushes it once it is complete.
+          *
+          *  @throws exception if the rebuilt block is invalid
+          */
+         virtual compact_block_result handle_compact_block( const message& ) = 0;
+
          /**
           *  Assuming all data elements are ordered in some way, this method should
           *  return up to limit ids that occur *after* from_id.
@@ -227,6 +253,8 @@ namespace bts { namespace net {
         fc::variant_object get_advanced_node_parameters();
         message_propagation_data get_transaction_propagation_data(const bts::blockchain::transaction_id_type& transaction_id);
         message_propagation_data get_block_propagation_data(const bts::blockchain::block_id_type& block_id);
+        /** delivery of a block passed to broadcast(); only the most recent blocks broadcast from this node are tracked */
+        fc::optional<block_delivery_data> get_block_delivery_data(const bts::blockchain::block_id_type& block_id) const;
         node_id_t get_node_id() const;
         void set_allowed_peers(const std::vector<node_id_t>& allowed_peers);
 
@@ -241,19 +269,62 @@ namespace bts { namespace net {
         fc::variant_object network_get_info() const;
         fc::variant_object network_get_usage_stats() const;
 
+        /**
+         * Joins the delegate relay overlay.  Delegates keep persistent connections to one
+         * another and push new blocks on them immediately, ahead of anything else queued
+         * for the peer, instead of advertising the block and waiting for it to be fetched.
+         * Must be called before connecting to the network so peers learn of it in our hello.
+         */
+        void set_delegate_relay_enabled(bool enabled);
+        /** connects to ep and reconnects whenever the connection drops, ignoring connection limits */
+        void add_delegate_relay_peer(const fc::ip::endpoint& ep);
+        fc::variant_object get_delegate_relay_status() const;
+
         std::vector<potential_peer_record> get_potential_peers() const;
 
         void disable_peer_advertising();
         fc::variant_object get_call_statistics() const;
+        /** approximate bytes held by the message cache, peer send queues and pending sync blocks */
+        fc::variant_object get_memory_usage(bool verify = false) const;
       private:
         std::unique_ptr<detail::node_impl, detail::node_impl_deleter> my;
    };
 
+   /**
+    *  Describes one direction of a link between two nodes on a simulated_network.
+    *  All delays are measured against the network's virtual clock.
+    */
+   struct simulated_link_parameters
+   {
+      simulated_link_parameters() :
+        bandwidth_bytes_per_second(0),
+        packet_loss_rate(0.0)
+      {}
+
+      fc::microseconds latency;
+      /** each delivery is delayed by an additional random amount in [0, jitter] */
+      fc::microseconds jitter;
+      /** 0 means the link has unlimited bandwidth */
+      uint32_t         bandwidth_bytes_per_second;
+      /** probability in [0, 1] that a message sent over this link is lost */
+      double           packet_loss_rate;
+   };
+
+    /**
+     *  An in-process network used for testing.
+     *
+     *  By default every message is delivered to every attached node immediately.
+     *  Once any link parameters, partitions or an explicit topology are configured,
+     *  messages are instead queued against a virtual clock and only delivered when
+     *  the clock is advanced with advance_virtual_time() or run_until_idle().  All
+     *  randomness (jitter and packet loss) is drawn from a generator seeded with
+     *  set_random_seed(), so a given configuration always produces the same run.
+     */
     class simulated_network : public node
     {
     public:
       ~simulated_network();
-      simulated_network(const std::string& user_agent) : node(user_agent) {}
+      simulated_network(const std::string& user_agent);
       void      listen_to_p2p_network() override {}
       void      connect_to_p2p_network() override {}
       void      connect_to(const fc::ip::endpoint& ep) override {}
@@ -262,13 +333,98 @@ namespace bts { namespace net {
 
       void      sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers) override {}
       void      broadcast(const message& item_to_broadcast) override;
-      void      add_node_delegate(node_delegate* node_delegate_to_add);
+
+      /** @return the index used to refer to this node in the link configuration methods */
+      uint32_t  add_node_delegate(node_delegate* node_delegate_to_add);
+      uint32_t  get_node_count() const;
+
+      /** sends a message as if it had been broadcast by the node at originating_node_index */
+      void      broadcast_from(uint32_t originating_node_index, const message& item_to_broadcast);
+
+      void      set_random_seed(uint64_t seed);
+      void      set_default_link_parameters(const simulated_link_parameters& parameters);
+      /** sets the parameters for messages sent from from_node_index to to_node_index */
+      void      set_link_parameters(uint32_t from_node_index, uint32_t to_node_index,
+                                    const simulated_link_parameters& parameters);
+
+      /**
+       *  Adds a bidirectional link between two nodes.  Once any link has been added, messages
+       *  only travel over configured links and each node relays messages it accepts to its
+       *  other neighbors, like the real network does.  Without a topology, every node is
+       *  directly linked to every other node.
+       */
+      void      connect_nodes(uint32_t first_node_index, uint32_t second_node_index);
+
+      /** messages are only delivered between nodes in the same partition (all nodes start in partition 0) */
+      void      set_partition(uint32_t node_index, uint32_t partition_id);
+      void      clear_partitions();
+
+      fc::time_point get_virtual_time() const;
+      /** delivers all queued messages that arrive within the next duration */
+      void      advance_virtual_time(const fc::microseconds& duration);
+      /** delivers queued messages until none remain */
+      void      run_until_idle();
+      uint32_t  get_number_of_pending_deliveries() const;
+
+      fc::variant_object get_statistics() const;
 
       virtual uint32_t get_connection_count() const override { return 8; }
     private:
       struct node_info;
+
+      struct link_state
+      {
+        fc::optional<simulated_link_parameters> parameters;
+        /** the time the link finishes transmitting the last message queued on it */
+        fc::time_point busy_until;
+        /** links deliver in order, like a tcp connection */
+        fc::time_point last_delivery_time;
+      };
+
+      struct pending_delivery
+      {
+        fc::time_point                 delivery_time;
+        uint64_t                       sequence_number;
+        uint32_t                       from_node_index;
+        uint32_t                       to_node_index;
+        std::shared_ptr<const message> item;
+      };
+
+      struct pending_delivery_order
+      {
+        bool operator()(const pending_delivery& lhs, const pending_delivery& rhs) const
+        {
+          // priority_queue puts the largest element on top, we want the earliest delivery
+          if (lhs.delivery_time != rhs.delivery_time)
+            return lhs.delivery_time > rhs.delivery_time;
+          return lhs.sequence_number > rhs.sequence_number;
+        }
+      };
+
       void message_sender(node_info* destination_node);
-      std::list<node_info*> network_nodes;
+      void send_to_neighbors(uint32_t sending_node_index, uint32_t excluded_node_index,
+                             const std::shared_ptr<const message>& item_to_send);
+      void schedule_delivery(uint32_t from_node_index, uint32_t to_node_index,
+                             const std::shared_ptr<const message>& item_to_send);
+      void deliver(const pending_delivery& delivery);
+      link_state& get_link_state(uint32_t from_node_index, uint32_t to_node_index);
+
+      std::vector<node_info*>                     network_nodes;
+
+      bool                                        _link_model_enabled;
+      bool                                        _explicit_topology;
+      simulated_link_parameters                   _default_link_parameters;
+      std::map<std::pair<uint32_t, uint32_t>, link_state> _links;
+      std::priority_queue<pending_delivery, std::vector<pending_delivery>, pending_delivery_order> _pending_deliveries;
+      uint64_t                                    _next_delivery_sequence_number;
+      fc::time_point                              _virtual_time;
+      std::mt19937_64                             _random_generator;
+
+      uint64_t                                    _messages_sent;
+      uint64_t                                    _messages_delivered;
+      uint64_t                                    _messages_lost;
+      uint64_t                                    _messages_blocked_by_partition;
+      uint64_t                                    _bytes_delivered;
     };
 
 
@@ -278,3 +434,5 @@ namespace bts { namespace net {
 } } // bts::net
 
 FC_REFLECT(bts::net::message_propagation_data, (received_time)(validated_time)(originating_peer));
+FC_REFLECT(bts::net::block_delivery_data, (broadcast_time)(first_peer_send_time)(peer_acknowledgement_times));
+FC_REFLECT(bts::net::simulated_link_parameters, (latency)(jitter)(bandwidth_bytes_per_second)(packet_loss_rate));
@@ -18,6 +18,7 @@
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
+#include <list>
 #include <queue>
 #include <boost/container/deque.hpp>
 
@@ -78,17 +79,20 @@ namespace bts { namespace net
         fc::time_point enqueue_time;
         fc::time_point transmission_start_time;
         fc::time_point transmission_finish_time;
+        bool           is_priority;
 
         queued_message(message message_to_send, 
                        size_t message_send_time_field_offset = (size_t)-1, 
-                       fc::time_point enqueue_time = fc::time_point::now()) :
+                       fc::time_point enqueue_time = fc::time_point::now(),
+                       bool is_priority = false) :
           message_to_send(std::move(message_to_send)),
           message_send_time_field_offset(message_send_time_field_offset),
-          enqueue_time(enqueue_time)
+          enqueue_time(enqueue_time),
+          is_priority(is_priority)
         {}
       };
       size_t _total_queued_messages_size;
-      std::queue<queued_message, std::list<queued_message> > _queued_messages;
+      std::list<queued_message> _queued_messages;
       fc::future<void> _send_queued_messages_done;
     public:
       fc::time_point connection_initiation_time;
@@ -175,6 +179,13 @@ namespace bts { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+      bool supports_compact_blocks; /// set from the hello message; if true we send blocks to this peer as compact_block_messages
+      bool advertises_delegate_relay; /// set from the hello message; if true (and we're part of the overlay too) new blocks are pushed on this connection
+      bool is_configured_delegate_relay; /// the peer's endpoint is one of our configured delegate relay peers, so we believe advertises_delegate_relay
+      uint32_t blocks_pushed_to_peer;
+      uint32_t blocks_pushed_by_peer;
+      fc::optional<fc::microseconds> last_block_push_latency; /// time between the timestamp of the last block this peer pushed us and its arrival
+      std::map<item_hash_t, item_hash_t> compact_blocks_awaiting_transactions; /// block ids of compact blocks we've asked this peer to fill in the missing transactions for, mapped to the block message we requested
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -205,11 +216,16 @@ namespace bts { namespace net
       void on_connection_closed(message_oriented_connection* originating_connection) override;
 
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      /** queues the message ahead of everything but the message currently being transmitted and
+       * any other priority messages, used for pushing blocks over the delegate relay overlay */
+      void send_priority_message(const message& message_to_send);
       void close_connection();
       void destroy_connection();
 
       uint64_t get_total_bytes_sent() const;
       uint64_t get_total_bytes_received() const;
+      size_t get_total_queued_messages_size() const;
+      size_t get_queued_message_count() const;
 
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
@@ -228,6 +244,7 @@ namespace bts { namespace net
       bool is_inventory_advertised_to_us_list_full() const;
     private:
       void send_queued_messages_task();
+      void enqueue_message(queued_message&& message_to_enqueue);
       void accept_connection_task();
       void connect_to_task(const fc::ip::endpoint& remote_endpoint);
     };
@@ -7,6 +7,8 @@
 #include <iostream>
 #include <algorithm>
 #include <tuple>
+#include <set>
+#include <limits>
 #include <boost/tuple/tuple.hpp>
 #include <boost/circular_buffer.hpp>
 
@@ -139,11 +141,19 @@ namespace bts { namespace net {
         > message_cache_container;
 
       message_cache_container _message_cache;
+      uint64_t _memory_usage;
 
       uint32_t block_clock;
 
+      /** the message payload plus a node in each of the three indexes */
+      static uint64_t entry_memory_usage( const message_info& info )
+      {
+        return sizeof(message_info) + 3 * 4 * sizeof(void*) + info.message_body.data.size();
+      }
+
     public:
       blockchain_tied_message_cache() :
+        _memory_usage( 0 ),
         block_clock( 0 )
       {}
       void block_accepted();
@@ -152,14 +162,29 @@ namespace bts { namespace net {
       message get_message( const message_hash_type& hash_of_message_to_lookup );
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       size_t size() const { return _message_cache.size(); }
+      uint64_t memory_usage() const { return _memory_usage; }
+      uint64_t recompute_memory_usage() const;
     };
 
     void blockchain_tied_message_cache::block_accepted()
     {
       ++block_clock;
       if( block_clock > cache_duration_in_blocks )
-        _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-                                                      _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
+      {
+        auto& clock_index = _message_cache.get<block_clock_index>();
+        const auto expired_end = clock_index.lower_bound( block_clock - cache_duration_in_blocks );
+        for( auto iter = clock_index.begin(); iter != expired_end; ++iter )
+          _memory_usage -= entry_memory_usage( *iter );
+        clock_index.erase( clock_index.begin(), expired_end );
+      }
+    }
+
+    uint64_t blockchain_tied_message_cache::recompute_memory_usage() const
+    {
+      uint64_t total = 0;
+      for( const message_info& info : _message_cache )
+        total += entry_memory_usage( info );
+      return total;
     }
 
     void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
@@ -167,11 +192,13 @@ namespace bts { namespace net {
                                                      const message_propagation_data& propagation_data,
                                                      const fc::uint160_t& message_content_hash )
     {
-      _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
-                                         block_clock,
-                                         propagation_data,
-                                         message_content_hash ) );
+      const auto insert_result = _message_cache.insert( message_info(hash_of_message_to_cache,
+                                                                    message_to_cache,
+                                                                    block_clock,
+                                                                    propagation_data,
+                                                                    message_content_hash ) );
+      if( insert_result.second )
+        _memory_usage += entry_memory_usage( *insert_result.first );
     }
 
     message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
@@ -258,6 +285,7 @@ namespace bts { namespace net { namespace detail {
                                                                                        boost::accumulators::tag::count> > call_stats_accumulator;
 #define NODE_DELEGATE_METHOD_NAMES (has_item) \
                                    (handle_message) \
+                                   (handle_compact_block) \
                                    (get_item_ids) \
                                    (get_item) \
                                    (get_chain_id) \
@@ -350,6 +378,7 @@ namespace bts { namespace net { namespace detail {
 
       bool has_item( const net::item_id& id ) override;
       bool handle_message( const message&, bool sync_mode ) override;
+      compact_block_result handle_compact_block( const message& ) override;
       std::vector<item_hash_t> get_item_ids(uint32_t item_type,
                                             const std::vector<item_hash_t>& blockchain_synopsis,
                                             uint32_t& remaining_item_count,
@@ -492,6 +521,26 @@ namespace bts { namespace net { namespace detail {
 
       bool _peer_advertising_disabled;
 
+      /// delegate relay overlay: delegates keep persistent connections to one another and push new blocks
+      /// on them directly instead of advertising them
+      /// @{
+      bool _delegate_relay_enabled;
+      std::unordered_set<fc::ip::endpoint> _delegate_relay_endpoints; /// we keep trying to reconnect to these if the connection drops
+      uint64_t _delegate_relay_blocks_pushed;
+      uint64_t _delegate_relay_blocks_received;
+      boost::circular_buffer<fc::microseconds> _delegate_relay_push_latencies; /// block timestamp to arrival time of recently pushed blocks
+      /// @}
+
+      /// delivery of the blocks most recently broadcast from this node, see get_block_delivery_data
+      struct locally_broadcast_block
+      {
+        bts::blockchain::block_id_type block_id;
+        message_hash_type               message_hash;
+        block_delivery_data             delivery;
+        std::set<node_id_t>             acknowledging_peers;
+      };
+      boost::circular_buffer<locally_broadcast_block> _locally_broadcast_blocks;
+
       fc::future<void> _fetch_updated_peer_lists_loop_done;
 
       boost::circular_buffer<uint32_t> _average_network_read_speed_seconds;
@@ -640,6 +689,15 @@ namespace bts { namespace net { namespace detail {
       void process_block_during_normal_operation( peer_connection* originating_peer, const bts::client::block_message& block_message, const message_hash_type& message_hash );
       void process_block_message( peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash );
 
+      message make_compact_block_message_for_peer( peer_connection* peer, const message& block_message_to_send );
+      bool has_outstanding_block_request( peer_connection* peer, const message_hash_type& block_message_hash ) const;
+      void process_compact_block_message( peer_connection* originating_peer, const message& message_to_process );
+      void on_fetch_compact_block_transactions_message( peer_connection* originating_peer,
+                                                        const bts::client::fetch_compact_block_transactions_message& fetch_message_received );
+      void process_compact_block_transactions_message( peer_connection* originating_peer, const message& message_to_process );
+      void on_compact_block_reconstructed( peer_connection* originating_peer, const item_hash_t& block_id,
+                                           const message_hash_type& requested_block_message_hash );
+
       void process_ordinary_message( peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash );
 
       void start_synchronizing();
@@ -696,6 +754,10 @@ namespace bts { namespace net { namespace detail {
       fc::variant_object         get_advanced_node_parameters();
       message_propagation_data   get_transaction_propagation_data( const bts::blockchain::transaction_id_type& transaction_id );
       message_propagation_data   get_block_propagation_data( const bts::blockchain::block_id_type& block_id );
+      fc::optional<block_delivery_data> get_block_delivery_data( const bts::blockchain::block_id_type& block_id ) const;
+      locally_broadcast_block*   find_locally_broadcast_block( const message_hash_type& message_hash );
+      void                       note_block_sent_to_peer( const message_hash_type& message_hash );
+      void                       note_block_acknowledged_by_peer( const peer_connection* peer, const message_hash_type& message_hash );
 
       node_id_t                  get_node_id() const;
       void                       set_allowed_peers( const std::vector<node_id_t>& allowed_peers );
@@ -703,10 +765,20 @@ namespace bts { namespace net { namespace detail {
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
+      fc::variant_object         get_memory_usage( bool verify ) const;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
 
+      void                       set_delegate_relay_enabled(bool enabled);
+      void                       add_delegate_relay_peer(const fc::ip::endpoint& ep);
+      fc::variant_object         get_delegate_relay_status() const;
+      bool                       is_delegate_relay_peer(const peer_connection* peer) const;
+      bool                       is_configured_delegate_relay_endpoint(peer_connection* peer) const;
+      void                       push_block_to_delegate_relay_peers(const message& block_message_to_push, const message_hash_type& message_hash);
+      void                       process_pushed_block(peer_connection* originating_peer, const bts::client::block_message& block_message_to_process,
+                                                      const message_hash_type& message_hash);
+
       bool is_hard_fork_block(uint32_t block_number) const;
       uint32_t get_next_known_hard_fork_block_number(uint32_t block_number) const;
     }; // end class node_impl
@@ -763,6 +835,11 @@ namespace bts { namespace net { namespace detail {
       _rate_limiter(0, 0),
       _last_reported_number_of_connections(0),
       _peer_advertising_disabled(false),
+      _delegate_relay_enabled(false),
+      _delegate_relay_blocks_pushed(0),
+      _delegate_relay_blocks_received(0),
+      _delegate_relay_push_latencies(100),
+      _locally_broadcast_blocks(20),
       _average_network_read_speed_seconds(60),
       _average_network_write_speed_seconds(60),
       _average_network_read_speed_minutes(60),
@@ -861,6 +938,14 @@ namespace bts { namespace net { namespace detail {
             dlog( "Done processing \"add once\" node list" );
           }
 
+          // delegate relay peers also bypass the connection limits, and we reconnect to them whenever the connection drops
+          for( const fc::ip::endpoint& delegate_relay_endpoint : _delegate_relay_endpoints )
+            if( !get_connection_to_endpoint( delegate_relay_endpoint ) && !is_connection_to_endpoint_in_progress( delegate_relay_endpoint ) )
+            {
+              dlog( "reconnecting to delegate relay peer ${peer}", ("peer", delegate_relay_endpoint) );
+              connect_to( delegate_relay_endpoint );
+            }
+
           while ( is_wanting_new_connections() )
           {
             bool initiated_connection_this_pass = false;
@@ -1624,6 +1709,15 @@ namespace bts { namespace net { namespace detail {
       case bts::client::message_type_enum::block_message_type:
         process_block_message( originating_peer, received_message, message_hash );
         break;
+      case bts::client::message_type_enum::compact_block_message_type:
+        process_compact_block_message( originating_peer, received_message );
+        break;
+      case bts::client::message_type_enum::fetch_compact_block_transactions_message_type:
+        on_fetch_compact_block_transactions_message( originating_peer, received_message.as<bts::client::fetch_compact_block_transactions_message>() );
+        break;
+      case bts::client::message_type_enum::compact_block_transactions_message_type:
+        process_compact_block_transactions_message( originating_peer, received_message );
+        break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message( originating_peer, received_message.as<current_time_request_message>() );
         break;
@@ -1678,6 +1772,9 @@ namespace bts { namespace net { namespace detail {
       user_data["bitness"] = sizeof(void*) * 8;
 
       user_data["node_id"] = _node_id;
+      user_data["supports_compact_blocks"] = true;
+      if (_delegate_relay_enabled)
+        user_data["delegate_relay"] = true;
 
       item_hash_t head_block_id = _delegate->get_head_block_id();
       user_data["last_known_block_hash"] = head_block_id;
@@ -1709,6 +1806,10 @@ namespace bts { namespace net { namespace detail {
         originating_peer->node_id = user_data["node_id"].as<node_id_t>();
       if (user_data.contains("last_known_fork_block_number"))
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>();
+      if (user_data.contains("supports_compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["supports_compact_blocks"].as<bool>();
+      if (user_data.contains("delegate_relay"))
+        originating_peer->advertises_delegate_relay = user_data["delegate_relay"].as<bool>();
     }
 
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -1742,6 +1843,7 @@ namespace bts { namespace net { namespace detail {
       originating_peer->outbound_port = hello_message_received.outbound_port;
 
       parse_hello_user_data_for_peer(originating_peer, hello_message_received.user_data);
+      originating_peer->is_configured_delegate_relay = is_configured_delegate_relay_endpoint(originating_peer);
 
       // if they didn't provide a last known fork, try to guess it
       if (originating_peer->last_known_fork_block_number == 0 &&
@@ -1887,7 +1989,7 @@ namespace bts { namespace net { namespace detail {
             originating_peer->is_firewalled = firewalled_state::firewalled;
           }
 
-          if( !is_accepting_new_connections() )
+          if( !is_accepting_new_connections() && !is_delegate_relay_peer( originating_peer ) )
           {
             connection_rejected_message connection_rejected( _user_agent_string, core_protocol_version,
                                                             originating_peer->get_socket().remote_endpoint(),
@@ -2426,9 +2528,20 @@ namespace bts { namespace net { namespace detail {
           dlog( "received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ( "endpoint", originating_peer->get_remote_endpoint() )
                ( "id", requested_message.id() ) );
-          reply_messages.push_back( requested_message );
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            note_block_acknowledged_by_peer( originating_peer, item_hash );
+            note_block_sent_to_peer( item_hash );
+            // blocks in the message cache were requested during normal operation, when the peer
+            // should already have most of the block's transactions in its pending pool
+            if (originating_peer->supports_compact_blocks)
+            {
+              reply_messages.push_back( make_compact_block_message_for_peer( originating_peer, requested_message ) );
+              continue;
+            }
+          }
+          reply_messages.push_back( requested_message );
           continue;
         }
         catch ( fc::key_not_found_exception& )
@@ -2515,6 +2628,8 @@ namespace bts { namespace net { namespace detail {
       for( const item_hash_t& item_hash : item_ids_inventory_message_received.item_hashes_available )
       {
         item_id advertised_item_id( item_ids_inventory_message_received.item_type, item_hash );
+        if( advertised_item_id.item_type == bts::client::block_message_type )
+          note_block_acknowledged_by_peer( originating_peer, item_hash );
         bool we_advertised_this_item_to_a_peer = false;
         bool we_requested_this_item_from_a_peer = false;
         for( const peer_connection_ptr peer : _active_connections )
@@ -3103,6 +3218,13 @@ namespace bts { namespace net { namespace detail {
         }
       }
 
+      if( is_delegate_relay_peer( originating_peer ) )
+      {
+        // blocks arrive unrequested on delegate relay connections
+        process_pushed_block( originating_peer, block_message_to_process, message_hash );
+        return;
+      }
+
       // if we get here, we didn't request the message, we must have a misbehaving peer
       wlog( "received a block ${block_id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
             ( "endpoint", originating_peer->get_remote_endpoint() )
@@ -3116,6 +3238,169 @@ namespace bts { namespace net { namespace detail {
       disconnect_from_peer( originating_peer, "You sent me a block that I didn't ask for", true, detailed_error );
     }
 
+    message node_impl::make_compact_block_message_for_peer( peer_connection* peer, const message& block_message_to_send )
+    {
+      VERIFY_CORRECT_THREAD();
+      bts::client::block_message block_message_to_compact( block_message_to_send.as<bts::client::block_message>() );
+      uint64_t short_id_salt;
+      fc::rand_pseudo_bytes( (char*)&short_id_salt, sizeof(short_id_salt) );
+      // send the full transaction unless we know the peer has seen it, either because they
+      // offered it to us or because we offered it to them
+      bts::client::compact_block_message compact_block( block_message_to_compact.block, block_message_to_send.id(), short_id_salt,
+                                                        [peer]( const bts::blockchain::signed_transaction& trx ) -> bool {
+        item_id trx_item_id( bts::client::trx_message_type, message( bts::client::trx_message( trx ) ).id() );
+        return peer->inventory_peer_advertised_to_us.find( trx_item_id ) == peer->inventory_peer_advertised_to_us.end() &&
+               peer->inventory_advertised_to_peer.find( trx_item_id ) == peer->inventory_advertised_to_peer.end();
+      } );
+      dlog( "sending block ${id} to peer ${endpoint} as a compact block with ${prefilled} of ${count} transactions prefilled",
+            ( "id", compact_block.block_id )( "endpoint", peer->get_remote_endpoint() )
+            ( "prefilled", compact_block.prefilled_transactions.size() )( "count", compact_block.transaction_count() ) );
+      return compact_block;
+    }
+
+    bool node_impl::has_outstanding_block_request( peer_connection* peer, const message_hash_type& block_message_hash ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      return peer->items_requested_from_peer.find( item_id( bts::client::block_message_type, block_message_hash ) ) !=
+             peer->items_requested_from_peer.end();
+    }
+
+    void node_impl::process_compact_block_message( peer_connection* originating_peer, const message& message_to_process )
+    {
+      VERIFY_CORRECT_THREAD();
+      bts::client::compact_block_message compact_block( message_to_process.as<bts::client::compact_block_message>() );
+      if( !has_outstanding_block_request( originating_peer, compact_block.block_message_id ) )
+      {
+        wlog( "received a compact block ${block_id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+              ( "endpoint", originating_peer->get_remote_endpoint() )
+              ( "block_id", compact_block.block_id ) );
+        fc::exception detailed_error( FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for, block_id: ${block_id}",
+                                                     ( "block_id", compact_block.block_id ) ) );
+        disconnect_from_peer( originating_peer, "You sent me a block that I didn't ask for", true, detailed_error );
+        return;
+      }
+
+      compact_block_result result;
+      try
+      {
+        result = _delegate->handle_compact_block( message_to_process );
+      }
+      catch ( const fc::canceled_exception& )
+      {
+        throw;
+      }
+      catch ( const fc::exception& e )
+      {
+        wlog( "Failed to push compact block ${id}, client rejected block sent by peer", ( "id", compact_block.block_id ) );
+        disconnect_from_peer( originating_peer, "You offered me a block that I have deemed to be invalid", true, e );
+        return;
+      }
+
+      if( !result.missing_transaction_indexes.empty() )
+      {
+        dlog( "compact block ${block_id} from peer ${endpoint} is missing ${count} transactions, requesting them",
+              ( "block_id", compact_block.block_id )
+              ( "endpoint", originating_peer->get_remote_endpoint() )
+              ( "count", result.missing_transaction_indexes.size() ) );
+        originating_peer->compact_blocks_awaiting_transactions[ compact_block.block_id ] = compact_block.block_message_id;
+        originating_peer->send_message( bts::client::fetch_compact_block_transactions_message( compact_block.block_id,
+                                                                                                 std::move( result.missing_transaction_indexes ) ) );
+        return;
+      }
+      on_compact_block_reconstructed( originating_peer, compact_block.block_id, compact_block.block_message_id );
+    }
+
+    void node_impl::on_fetch_compact_block_transactions_message( peer_connection* originating_peer,
+                                                                 const bts::client::fetch_compact_block_transactions_message& fetch_message_received )
+    {
+      VERIFY_CORRECT_THREAD();
+      try
+      {
+        bts::client::block_message requested_block( _delegate->get_item( item_id( bts::client::block_message_type,
+                                                                                  fetch_message_received.block_id ) ).as<bts::client::block_message>() );
+        std::vector<bts::blockchain::signed_transaction> transactions;
+        transactions.reserve( fetch_message_received.transaction_indexes.size() );
+        for( uint16_t index : fetch_message_received.transaction_indexes )
+        {
+          FC_ASSERT( index < requested_block.block.user_transactions.size(), "transaction index ${index} out of range", ("index", index) );
+          transactions.push_back( requested_block.block.user_transactions[index] );
+        }
+        originating_peer->send_message( bts::client::compact_block_transactions_message( fetch_message_received.block_id,
+                                                                                           std::move( transactions ) ) );
+      }
+      catch ( const fc::canceled_exception& )
+      {
+        throw;
+      }
+      catch ( const fc::exception& e )
+      {
+        wlog( "unable to serve transactions for compact block ${id} to peer ${endpoint}",
+              ( "id", fetch_message_received.block_id )( "endpoint", originating_peer->get_remote_endpoint() ) );
+        disconnect_from_peer( originating_peer, "You requested transactions for a block I didn't send you", true, e );
+      }
+    }
+
+    void node_impl::process_compact_block_transactions_message( peer_connection* originating_peer, const message& message_to_process )
+    {
+      VERIFY_CORRECT_THREAD();
+      bts::client::compact_block_transactions_message transactions_message( message_to_process.as<bts::client::compact_block_transactions_message>() );
+      auto awaiting_iter = originating_peer->compact_blocks_awaiting_transactions.find( transactions_message.block_id );
+      if( awaiting_iter == originating_peer->compact_blocks_awaiting_transactions.end() )
+      {
+        fc::exception detailed_error( FC_LOG_MESSAGE(error, "You sent me transactions for compact block ${block_id} that I didn't ask for",
+                                                     ( "block_id", transactions_message.block_id ) ) );
+        disconnect_from_peer( originating_peer, "You sent me compact block transactions that I didn't ask for", true, detailed_error );
+        return;
+      }
+      const message_hash_type requested_block_message_hash = awaiting_iter->second;
+      originating_peer->compact_blocks_awaiting_transactions.erase( awaiting_iter );
+
+      try
+      {
+        // we asked for every transaction still missing, so the block is either complete now or invalid
+        const compact_block_result result = _delegate->handle_compact_block( message_to_process );
+        FC_ASSERT( result.missing_transaction_indexes.empty(), "compact block ${id} is still missing ${count} transactions",
+                   ( "id", transactions_message.block_id )( "count", result.missing_transaction_indexes.size() ) );
+      }
+      catch ( const fc::canceled_exception& )
+      {
+        throw;
+      }
+      catch ( const fc::exception& e )
+      {
+        wlog( "Failed to push compact block ${id} after fetching its transactions", ( "id", transactions_message.block_id ) );
+        disconnect_from_peer( originating_peer, "You offered me a block that I have deemed to be invalid", true, e );
+        return;
+      }
+      on_compact_block_reconstructed( originating_peer, transactions_message.block_id, requested_block_message_hash );
+    }
+
+    void node_impl::on_compact_block_reconstructed( peer_connection* originating_peer, const item_hash_t& block_id,
+                                                    const message_hash_type& requested_block_message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      // the client has pushed the block; fetch the full block back so we can check it is the block
+      // message we requested and relay it the usual way
+      message full_block_message = _delegate->get_item( item_id( bts::client::block_message_type, block_id ) );
+      message_hash_type block_message_hash = full_block_message.id();
+      originating_peer->items_requested_from_peer.erase( item_id( bts::client::block_message_type, requested_block_message_hash ) );
+      if( block_message_hash != requested_block_message_hash )
+      {
+        wlog( "compact block ${block_id} from peer ${endpoint} isn't the block I requested, disconnecting from peer",
+              ( "block_id", block_id )( "endpoint", originating_peer->get_remote_endpoint() ) );
+        fc::exception detailed_error( FC_LOG_MESSAGE(error, "You sent me compact block ${block_id} in place of a different block",
+                                                     ( "block_id", block_id ) ) );
+        disconnect_from_peer( originating_peer, "You sent me a block that I didn't ask for", true, detailed_error );
+        return;
+      }
+
+      if( std::find( _most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(), block_id ) == _most_recent_blocks_accepted.end() )
+        _most_recent_blocks_accepted.push_back( block_id );
+      process_block_during_normal_operation( originating_peer, full_block_message.as<bts::client::block_message>(), block_message_hash );
+      if( originating_peer->idle() )
+        trigger_fetch_items_loop();
+    }
+
     void node_impl::on_current_time_request_message(peer_connection* originating_peer,
                                                     const current_time_request_message& current_time_request_message_received)
     {
@@ -4260,11 +4545,148 @@ namespace bts { namespace net { namespace detail {
       }
       message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
 
+      // blocks we produced ourselves are tracked until enough peers have them, see get_block_delivery_data
+      if( item_to_broadcast.msg_type == bts::client::block_message_type && propagation_data.originating_peer == _node_id )
+      {
+        locally_broadcast_block broadcast_block;
+        broadcast_block.block_id = hash_of_message_contents;
+        broadcast_block.message_hash = hash_of_item_to_broadcast;
+        broadcast_block.delivery.broadcast_time = propagation_data.received_time;
+        _locally_broadcast_blocks.push_back( broadcast_block );
+      }
+
       _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
+      if( item_to_broadcast.msg_type == bts::client::block_message_type && _delegate_relay_enabled )
+        push_block_to_delegate_relay_peers( item_to_broadcast, hash_of_item_to_broadcast );
       _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
       trigger_advertise_inventory_loop();
     }
 
+    bool node_impl::is_delegate_relay_peer( const peer_connection* peer ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      // anyone can claim to be a relay in their hello, so only peers we were configured with get past
+      // the connection limits and may push blocks at us
+      return _delegate_relay_enabled && peer->advertises_delegate_relay && peer->is_configured_delegate_relay;
+    }
+
+    bool node_impl::is_configured_delegate_relay_endpoint( peer_connection* peer ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      // outbound connections are made to the configured endpoint itself; inbound ones come from an
+      // ephemeral port, so match the address we actually see with the listening port the peer reports
+      fc::optional<fc::ip::endpoint> remote_endpoint = peer->get_remote_endpoint();
+      if( !remote_endpoint )
+        return false;
+      if( _delegate_relay_endpoints.find( *remote_endpoint ) != _delegate_relay_endpoints.end() )
+        return true;
+      return _delegate_relay_endpoints.find( fc::ip::endpoint( remote_endpoint->get_address(), peer->inbound_port ) ) !=
+             _delegate_relay_endpoints.end();
+    }
+
+    void node_impl::push_block_to_delegate_relay_peers( const message& block_message_to_push, const message_hash_type& message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      item_id block_item_id( bts::client::block_message_type, message_hash );
+      for( const peer_connection_ptr& peer : _active_connections )
+      {
+        ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+        if( !is_delegate_relay_peer( peer.get() ) || peer->peer_needs_sync_items_from_us )
+          continue;
+        if( peer->inventory_peer_advertised_to_us.find( block_item_id ) != peer->inventory_peer_advertised_to_us.end() ||
+            peer->inventory_advertised_to_peer.find( block_item_id ) != peer->inventory_advertised_to_peer.end() )
+          continue;
+        // recording it as advertised keeps the advertise_inventory_loop from offering it again
+        peer->inventory_advertised_to_peer.insert( peer_connection::timestamped_item_id( block_item_id, fc::time_point::now() ) );
+        peer->send_priority_message( block_message_to_push );
+        note_block_sent_to_peer( message_hash );
+        // the relay peer already has it marked as ours, so it will neither request it nor advertise it back
+        note_block_acknowledged_by_peer( peer.get(), message_hash );
+        ++peer->blocks_pushed_to_peer;
+        ++_delegate_relay_blocks_pushed;
+        dlog( "pushed block ${id} to delegate relay peer ${endpoint}", ("id", message_hash)("endpoint", peer->get_remote_endpoint()) );
+      }
+    }
+
+    void node_impl::process_pushed_block( peer_connection* originating_peer,
+                                          const bts::client::block_message& block_message_to_process,
+                                          const message_hash_type& message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::microseconds push_latency = fc::time_point::now() - fc::time_point(block_message_to_process.block.timestamp);
+      originating_peer->inventory_peer_advertised_to_us.insert( peer_connection::timestamped_item_id( item_id( bts::client::block_message_type, message_hash ),
+                                                                                                      fc::time_point::now() ) );
+      ++originating_peer->blocks_pushed_by_peer;
+      originating_peer->last_block_push_latency = push_latency;
+      ++_delegate_relay_blocks_received;
+      _delegate_relay_push_latencies.push_back( push_latency );
+      dlog( "delegate relay peer ${endpoint} pushed block ${num} (id:${id}), ${latency} us after its timestamp",
+            ("endpoint", originating_peer->get_remote_endpoint())("num", block_message_to_process.block.block_num)
+            ("id", block_message_to_process.block_id)("latency", push_latency.count()) );
+
+      // if we're still syncing from this peer, the block probably won't link yet; sync will get to it
+      if( originating_peer->we_need_sync_items_from_peer ||
+          std::find( _most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                     block_message_to_process.block_id ) != _most_recent_blocks_accepted.end() )
+        return;
+      process_block_during_normal_operation( originating_peer, block_message_to_process, message_hash );
+    }
+
+    void node_impl::set_delegate_relay_enabled( bool enabled )
+    {
+      VERIFY_CORRECT_THREAD();
+      _delegate_relay_enabled = enabled;
+    }
+
+    void node_impl::add_delegate_relay_peer( const fc::ip::endpoint& ep )
+    {
+      VERIFY_CORRECT_THREAD();
+      _delegate_relay_endpoints.insert( ep );
+      add_node( ep );
+    }
+
+    fc::variant_object node_impl::get_delegate_relay_status() const
+    {
+      VERIFY_CORRECT_THREAD();
+      std::vector<fc::variant_object> peers;
+      for( const peer_connection_ptr& peer : _active_connections )
+      {
+        if( !is_delegate_relay_peer( peer.get() ) )
+          continue;
+        fc::mutable_variant_object peer_status;
+        fc::optional<fc::ip::endpoint> remote_endpoint = peer->get_remote_endpoint();
+        peer_status["endpoint"] = remote_endpoint;
+        peer_status["node_id"] = peer->node_id;
+        peer_status["round_trip_delay_us"] = peer->round_trip_delay.count();
+        peer_status["blocks_pushed_to_peer"] = peer->blocks_pushed_to_peer;
+        peer_status["blocks_pushed_by_peer"] = peer->blocks_pushed_by_peer;
+        if( peer->last_block_push_latency )
+          peer_status["last_push_latency_us"] = peer->last_block_push_latency->count();
+        peers.push_back( peer_status );
+      }
+
+      fc::mutable_variant_object status;
+      status["enabled"] = _delegate_relay_enabled;
+      status["configured_peers"] = std::vector<fc::ip::endpoint>( _delegate_relay_endpoints.begin(), _delegate_relay_endpoints.end() );
+      status["connected_peer_count"] = peers.size();
+      status["peers"] = peers;
+      status["blocks_pushed"] = _delegate_relay_blocks_pushed;
+      status["blocks_received"] = _delegate_relay_blocks_received;
+      if( !_delegate_relay_push_latencies.empty() )
+      {
+        int64_t total_latency = 0;
+        int64_t maximum_latency = 0;
+        for( const fc::microseconds& latency : _delegate_relay_push_latencies )
+        {
+          total_latency += latency.count();
+          maximum_latency = std::max( maximum_latency, latency.count() );
+        }
+        status["average_push_latency_us"] = total_latency / (int64_t)_delegate_relay_push_latencies.size();
+        status["maximum_push_latency_us"] = maximum_latency;
+      }
+      return status;
+    }
+
     void node_impl::broadcast( const message& item_to_broadcast )
     {
       VERIFY_CORRECT_THREAD();
@@ -4273,6 +4695,40 @@ namespace bts { namespace net { namespace detail {
       broadcast( item_to_broadcast, propagation_data );
     }
 
+    node_impl::locally_broadcast_block* node_impl::find_locally_broadcast_block( const message_hash_type& message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      for( locally_broadcast_block& broadcast_block : _locally_broadcast_blocks )
+        if( broadcast_block.message_hash == message_hash )
+          return &broadcast_block;
+      return nullptr;
+    }
+
+    void node_impl::note_block_sent_to_peer( const message_hash_type& message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      locally_broadcast_block* broadcast_block = find_locally_broadcast_block( message_hash );
+      if( broadcast_block && !broadcast_block->delivery.first_peer_send_time )
+        broadcast_block->delivery.first_peer_send_time = fc::time_point::now();
+    }
+
+    void node_impl::note_block_acknowledged_by_peer( const peer_connection* peer, const message_hash_type& message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      locally_broadcast_block* broadcast_block = find_locally_broadcast_block( message_hash );
+      if( broadcast_block && broadcast_block->acknowledging_peers.insert( peer->node_id ).second )
+        broadcast_block->delivery.peer_acknowledgement_times.push_back( fc::time_point::now() );
+    }
+
+    fc::optional<block_delivery_data> node_impl::get_block_delivery_data( const bts::blockchain::block_id_type& block_id ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      for( const locally_broadcast_block& broadcast_block : _locally_broadcast_blocks )
+        if( broadcast_block.block_id == block_id )
+          return broadcast_block.delivery;
+      return fc::optional<block_delivery_data>();
+    }
+
     void node_impl::sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers)
     {
       VERIFY_CORRECT_THREAD();
@@ -4395,6 +4851,47 @@ namespace bts { namespace net { namespace detail {
       return _delegate->get_call_statistics();
     }
 
+    fc::variant_object node_impl::get_memory_usage( bool verify ) const
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::mutable_variant_object message_cache;
+      message_cache["entries"] = _message_cache.size();
+      message_cache["bytes"] = _message_cache.memory_usage();
+      if( verify )
+        message_cache["drift"] = int64_t( _message_cache.memory_usage() ) - int64_t( _message_cache.recompute_memory_usage() );
+
+      uint64_t queued_bytes = 0;
+      uint64_t queued_messages = 0;
+      for( const std::unordered_set<peer_connection_ptr>* connections : { &_handshaking_connections, &_active_connections, &_closing_connections } )
+        for( const peer_connection_ptr& peer : *connections )
+        {
+          queued_bytes += peer->get_total_queued_messages_size();
+          queued_messages += peer->get_queued_message_count();
+        }
+      fc::mutable_variant_object peer_queues;
+      peer_queues["entries"] = queued_messages;
+      peer_queues["bytes"] = queued_bytes;
+
+      uint64_t sync_block_bytes = 0;
+      for( const bts::client::block_message& block : _received_sync_items )
+        sync_block_bytes += fc::raw::pack_size( block );
+      for( const bts::client::block_message& block : _new_received_sync_items )
+        sync_block_bytes += fc::raw::pack_size( block );
+      fc::mutable_variant_object sync_blocks;
+      sync_blocks["entries"] = _received_sync_items.size() + _new_received_sync_items.size();
+      sync_blocks["bytes"] = sync_block_bytes;
+
+      fc::mutable_variant_object tables;
+      tables["message_cache"] = message_cache;
+      tables["peer_send_queues"] = peer_queues;
+      tables["received_sync_blocks"] = sync_blocks;
+
+      fc::mutable_variant_object result;
+      result["total_bytes"] = _message_cache.memory_usage() + queued_bytes + sync_block_bytes;
+      result["tables"] = tables;
+      return result;
+    }
+
     fc::variant_object node_impl::network_get_info() const
     {
       VERIFY_CORRECT_THREAD();
@@ -4571,6 +5068,11 @@ namespace bts { namespace net { namespace detail {
     INVOKE_IN_IMPL(get_block_propagation_data, block_id);
   }
 
+  fc::optional<block_delivery_data> node::get_block_delivery_data( const bts::blockchain::block_id_type& block_id ) const
+  {
+    INVOKE_IN_IMPL(get_block_delivery_data, block_id);
+  }
+
   node_id_t node::get_node_id() const
   {
     INVOKE_IN_IMPL(get_node_id);
@@ -4602,6 +5104,11 @@ namespace bts { namespace net { namespace detail {
     INVOKE_IN_IMPL(get_call_statistics);
   }
 
+  fc::variant_object node::get_memory_usage(bool verify) const
+  {
+    INVOKE_IN_IMPL(get_memory_usage, verify);
+  }
+
   fc::variant_object node::network_get_info() const
   {
     INVOKE_IN_IMPL(network_get_info);
@@ -4612,6 +5119,21 @@ namespace bts { namespace net { namespace detail {
     INVOKE_IN_IMPL(network_get_usage_stats);
   }
 
+  void node::set_delegate_relay_enabled(bool enabled)
+  {
+    INVOKE_IN_IMPL(set_delegate_relay_enabled, enabled);
+  }
+
+  void node::add_delegate_relay_peer(const fc::ip::endpoint& ep)
+  {
+    INVOKE_IN_IMPL(add_delegate_relay_peer, ep);
+  }
+
+  fc::variant_object node::get_delegate_relay_status() const
+  {
+    INVOKE_IN_IMPL(get_delegate_relay_status);
+  }
+
   void node::close()
   {
     wlog( ".... WARNING NOT DOING ANYTHING WHEN I SHOULD ......" );
@@ -4624,9 +5146,26 @@ namespace bts { namespace net { namespace detail {
     node_delegate* delegate;
     fc::future<void> message_sender_task_done;
     std::queue<message> messages_to_deliver;
-    node_info(node_delegate* delegate) : delegate(delegate) {}
+    uint32_t partition_id;
+    std::vector<uint32_t> neighbors;
+    std::set<message_hash_type> messages_seen;
+    node_info(node_delegate* delegate) : delegate(delegate), partition_id(0) {}
   };
 
+  simulated_network::simulated_network(const std::string& user_agent) :
+    node(user_agent),
+    _link_model_enabled(false),
+    _explicit_topology(false),
+    _next_delivery_sequence_number(0),
+    _random_generator(0),
+    _messages_sent(0),
+    _messages_delivered(0),
+    _messages_lost(0),
+    _messages_blocked_by_partition(0),
+    _bytes_delivered(0)
+  {
+  }
+
   simulated_network::~simulated_network()
   {
     for( node_info* network_node_info : network_nodes )
@@ -4654,6 +5193,16 @@ namespace bts { namespace net { namespace detail {
 
   void simulated_network::broadcast( const message& item_to_broadcast  )
   {
+    if (_link_model_enabled)
+    {
+      // we don't know which node this came from, so treat it as arriving from outside
+      // the simulated network over a default link to every node
+      auto item = std::make_shared<const message>(item_to_broadcast);
+      for (uint32_t i = 0; i < network_nodes.size(); ++i)
+        schedule_delivery(std::numeric_limits<uint32_t>::max(), i, item);
+      return;
+    }
+
     for (node_info* network_node_info : network_nodes)
     {
       network_node_info->messages_to_deliver.emplace(item_to_broadcast);
@@ -4663,9 +5212,217 @@ namespace bts { namespace net { namespace detail {
     }
   }
 
-  void simulated_network::add_node_delegate( node_delegate* node_delegate_to_add )
+  uint32_t simulated_network::add_node_delegate( node_delegate* node_delegate_to_add )
   {
     network_nodes.push_back(new node_info(node_delegate_to_add));
+    return (uint32_t)network_nodes.size() - 1;
+  }
+
+  uint32_t simulated_network::get_node_count() const
+  {
+    return (uint32_t)network_nodes.size();
+  }
+
+  void simulated_network::broadcast_from( uint32_t originating_node_index, const message& item_to_broadcast )
+  {
+    FC_ASSERT(originating_node_index < network_nodes.size());
+    if (!_link_model_enabled)
+    {
+      broadcast(item_to_broadcast);
+      return;
+    }
+    auto item = std::make_shared<const message>(item_to_broadcast);
+    network_nodes[originating_node_index]->messages_seen.insert(item->id());
+    send_to_neighbors(originating_node_index, originating_node_index, item);
+  }
+
+  void simulated_network::set_random_seed( uint64_t seed )
+  {
+    _random_generator.seed(seed);
+  }
+
+  void simulated_network::set_default_link_parameters( const simulated_link_parameters& parameters )
+  {
+    _default_link_parameters = parameters;
+    _link_model_enabled = true;
+  }
+
+  void simulated_network::set_link_parameters( uint32_t from_node_index, uint32_t to_node_index,
+                                               const simulated_link_parameters& parameters )
+  {
+    FC_ASSERT(from_node_index < network_nodes.size() && to_node_index < network_nodes.size());
+    get_link_state(from_node_index, to_node_index).parameters = parameters;
+    _link_model_enabled = true;
+  }
+
+  void simulated_network::connect_nodes( uint32_t first_node_index, uint32_t second_node_index )
+  {
+    FC_ASSERT(first_node_index < network_nodes.size() && second_node_index < network_nodes.size());
+    FC_ASSERT(first_node_index != second_node_index);
+    std::vector<uint32_t>& first_neighbors = network_nodes[first_node_index]->neighbors;
+    if (std::find(first_neighbors.begin(), first_neighbors.end(), second_node_index) == first_neighbors.end())
+    {
+      first_neighbors.push_back(second_node_index);
+      network_nodes[second_node_index]->neighbors.push_back(first_node_index);
+    }
+    _explicit_topology = true;
+    _link_model_enabled = true;
+  }
+
+  void simulated_network::set_partition( uint32_t node_index, uint32_t partition_id )
+  {
+    FC_ASSERT(node_index < network_nodes.size());
+    network_nodes[node_index]->partition_id = partition_id;
+    _link_model_enabled = true;
+  }
+
+  void simulated_network::clear_partitions()
+  {
+    for (node_info* network_node_info : network_nodes)
+      network_node_info->partition_id = 0;
+  }
+
+  fc::time_point simulated_network::get_virtual_time() const
+  {
+    return _virtual_time;
+  }
+
+  void simulated_network::advance_virtual_time( const fc::microseconds& duration )
+  {
+    const fc::time_point end_time = _virtual_time + duration;
+    while (!_pending_deliveries.empty() && _pending_deliveries.top().delivery_time <= end_time)
+    {
+      pending_delivery next_delivery = _pending_deliveries.top();
+      _pending_deliveries.pop();
+      _virtual_time = next_delivery.delivery_time;
+      deliver(next_delivery);
+    }
+    _virtual_time = end_time;
+  }
+
+  void simulated_network::run_until_idle()
+  {
+    while (!_pending_deliveries.empty())
+    {
+      pending_delivery next_delivery = _pending_deliveries.top();
+      _pending_deliveries.pop();
+      _virtual_time = next_delivery.delivery_time;
+      deliver(next_delivery);
+    }
+  }
+
+  uint32_t simulated_network::get_number_of_pending_deliveries() const
+  {
+    return (uint32_t)_pending_deliveries.size();
+  }
+
+  fc::variant_object simulated_network::get_statistics() const
+  {
+    fc::mutable_variant_object statistics;
+    statistics["virtual_time"] = _virtual_time;
+    statistics["node_count"] = network_nodes.size();
+    statistics["messages_sent"] = _messages_sent;
+    statistics["messages_delivered"] = _messages_delivered;
+    statistics["messages_lost"] = _messages_lost;
+    statistics["messages_blocked_by_partition"] = _messages_blocked_by_partition;
+    statistics["bytes_delivered"] = _bytes_delivered;
+    statistics["pending_deliveries"] = _pending_deliveries.size();
+    return statistics;
+  }
+
+  void simulated_network::send_to_neighbors( uint32_t sending_node_index, uint32_t excluded_node_index,
+                                             const std::shared_ptr<const message>& item_to_send )
+  {
+    if (_explicit_topology)
+    {
+      for (uint32_t neighbor_index : network_nodes[sending_node_index]->neighbors)
+        if (neighbor_index != excluded_node_index)
+          schedule_delivery(sending_node_index, neighbor_index, item_to_send);
+    }
+    else
+    {
+      // without a topology everyone is directly connected, so there is nothing to relay
+      if (sending_node_index != excluded_node_index)
+        return;
+      for (uint32_t i = 0; i < network_nodes.size(); ++i)
+        if (i != sending_node_index)
+          schedule_delivery(sending_node_index, i, item_to_send);
+    }
+  }
+
+  simulated_network::link_state& simulated_network::get_link_state( uint32_t from_node_index, uint32_t to_node_index )
+  {
+    return _links[std::make_pair(from_node_index, to_node_index)];
+  }
+
+  void simulated_network::schedule_delivery( uint32_t from_node_index, uint32_t to_node_index,
+                                             const std::shared_ptr<const message>& item_to_send )
+  {
+    ++_messages_sent;
+    const bool from_outside_network = from_node_index >= network_nodes.size();
+    if (!from_outside_network &&
+        network_nodes[from_node_index]->partition_id != network_nodes[to_node_index]->partition_id)
+    {
+      ++_messages_blocked_by_partition;
+      return;
+    }
+
+    link_state& link = get_link_state(from_node_index, to_node_index);
+    const simulated_link_parameters& parameters = link.parameters ? *link.parameters : _default_link_parameters;
+
+    if (parameters.packet_loss_rate > 0.0 &&
+        std::uniform_real_distribution<double>(0.0, 1.0)(_random_generator) < parameters.packet_loss_rate)
+    {
+      ++_messages_lost;
+      return;
+    }
+
+    // the link can only transmit one message at a time, so a large message delays
+    // everything queued behind it
+    fc::time_point transmission_start_time = std::max(_virtual_time, link.busy_until);
+    fc::microseconds transmission_time;
+    if (parameters.bandwidth_bytes_per_second)
+    {
+      uint64_t bytes_to_send = sizeof(message_header) + item_to_send->data.size();
+      transmission_time = fc::microseconds(bytes_to_send * 1000000 / parameters.bandwidth_bytes_per_second);
+    }
+    link.busy_until = transmission_start_time + transmission_time;
+
+    fc::time_point delivery_time = link.busy_until + parameters.latency;
+    if (parameters.jitter.count() > 0)
+      delivery_time += fc::microseconds(std::uniform_int_distribution<int64_t>(0, parameters.jitter.count())(_random_generator));
+    delivery_time = std::max(delivery_time, link.last_delivery_time);
+    link.last_delivery_time = delivery_time;
+
+    pending_delivery delivery;
+    delivery.delivery_time = delivery_time;
+    delivery.sequence_number = _next_delivery_sequence_number++;
+    delivery.from_node_index = from_node_index;
+    delivery.to_node_index = to_node_index;
+    delivery.item = item_to_send;
+    _pending_deliveries.push(delivery);
+  }
+
+  void simulated_network::deliver( const pending_delivery& delivery )
+  {
+    node_info* destination_node = network_nodes[delivery.to_node_index];
+    ++_messages_delivered;
+    _bytes_delivered += sizeof(message_header) + delivery.item->data.size();
+
+    // like the real network, a node only processes and relays a given message once
+    if (!destination_node->messages_seen.insert(delivery.item->id()).second)
+      return;
+
+    try
+    {
+      destination_node->delegate->handle_message(*delivery.item, false);
+    }
+    catch ( const fc::exception& e )
+    {
+      elog( "${r}", ("r",e.to_detail_string() ) );
+      return;
+    }
+    send_to_neighbors(delivery.to_node_index, delivery.from_node_index, delivery.item);
   }
 
   namespace detail
@@ -4740,6 +5497,11 @@ namespace bts { namespace net { namespace detail {
       INVOKE_AND_COLLECT_STATISTICS(handle_message, message_to_handle, sync_mode);
     }
 
+    compact_block_result statistics_gathering_node_delegate_wrapper::handle_compact_block( const message& message_to_handle )
+    {
+      INVOKE_AND_COLLECT_STATISTICS(handle_compact_block, message_to_handle);
+    }
+
     std::vector<item_hash_t> statistics_gathering_node_delegate_wrapper::get_item_ids(uint32_t item_type,
                                                                                   const std::vector<item_hash_t>& blockchain_synopsis,
                                                                                   uint32_t& remaining_item_count,
@@ -30,6 +30,11 @@ namespace bts { namespace net
       we_need_sync_items_from_peer(true),
       last_block_number_delegate_has_seen(0),
       inhibit_fetching_sync_blocks(false),
+      supports_compact_blocks(false),
+      advertises_delegate_relay(false),
+      is_configured_delegate_relay(false),
+      blocks_pushed_to_peer(0),
+      blocks_pushed_by_peer(0),
       transaction_fetching_inhibited_until(fc::time_point::min()),
       last_known_fork_block_number(0)
 #ifndef NDEBUG
@@ -279,7 +284,7 @@ namespace bts { namespace net
         }
         _queued_messages.front().transmission_finish_time = fc::time_point::now();
         _total_queued_messages_size -= _queued_messages.front().message_to_send.size;
-        _queued_messages.pop();
+        _queued_messages.pop_front();
       }
       dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
@@ -289,8 +294,35 @@ namespace bts { namespace net
       VERIFY_CORRECT_THREAD();
       dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
            ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-      _queued_messages.emplace(queued_message(message_to_send, message_send_time_field_offset));
-      _total_queued_messages_size += message_to_send.size;
+      enqueue_message(queued_message(message_to_send, message_send_time_field_offset));
+    }
+
+    void peer_connection::send_priority_message(const message& message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      dlog("peer_connection::send_priority_message() enqueueing message of type ${type} for peer ${endpoint}",
+           ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
+      enqueue_message(queued_message(message_to_send, (size_t)-1, fc::time_point::now(), true));
+    }
+
+    void peer_connection::enqueue_message(queued_message&& message_to_enqueue)
+    {
+      VERIFY_CORRECT_THREAD();
+      const size_t message_size = message_to_enqueue.message_to_send.size;
+      if (message_to_enqueue.is_priority)
+      {
+        // don't interrupt the message that's on the wire, and keep priority messages in order
+        auto insert_position = _queued_messages.begin();
+        if (insert_position != _queued_messages.end() &&
+            insert_position->transmission_start_time != fc::time_point())
+          ++insert_position;
+        while (insert_position != _queued_messages.end() && insert_position->is_priority)
+          ++insert_position;
+        _queued_messages.insert(insert_position, std::move(message_to_enqueue));
+      }
+      else
+        _queued_messages.push_back(std::move(message_to_enqueue));
+      _total_queued_messages_size += message_size;
       if (_total_queued_messages_size > BTS_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)
       {
         elog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
@@ -341,6 +373,18 @@ namespace bts { namespace net
       return _message_connection.get_total_bytes_sent();
     }
 
+    size_t peer_connection::get_total_queued_messages_size() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _total_queued_messages_size;
+    }
+
+    size_t peer_connection::get_queued_message_count() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _queued_messages.size();
+    }
+
     uint64_t peer_connection::get_total_bytes_received() const
     {
       VERIFY_CORRECT_THREAD();
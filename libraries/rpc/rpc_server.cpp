@@ -9,7 +9,10 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
 
+#include <fc/compress/zlib.hpp>
+#include <fc/crypto/sha256.hpp>
 #include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/json.hpp>
 #include <fc/network/http/server.hpp>
@@ -22,9 +25,13 @@
 #include <fc/thread/mutex.hpp>
 #include <fc/thread/scoped_lock.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <ctime>
 #include <iomanip>
 #include <limits>
 #include <sstream>
+#include <unordered_map>
 
 #include <bts/rpc_stubs/common_api_rpc_server.hpp>
 
@@ -34,6 +41,29 @@ namespace bts { namespace rpc {
 
   namespace detail
   {
+    /** files larger than this are served straight from disk */
+    const uint64_t max_cached_file_size        = 16 * 1024 * 1024;
+    /** total bytes of file content (including compressed variants) kept in memory */
+    const uint64_t max_file_cache_size         = 64 * 1024 * 1024;
+    /** how long a cached file is served before checking whether it changed on disk */
+    const fc::microseconds file_revalidation_interval = fc::seconds(5);
+
+    /** a file under htdocs, loaded once along with its compressed variants */
+    struct cached_file
+    {
+       std::vector<char>    content;
+       /** the content of a precompressed "<file>.gz" sibling, if one exists */
+       std::vector<char>    gzip_content;
+       /** zlib-deflated content, empty if it wouldn't be smaller */
+       std::vector<char>    deflate_content;
+       std::time_t          last_write_time = 0;
+       std::string          etag;
+       std::string          last_modified;
+       fc::time_point       last_checked;
+
+       uint64_t memory_size()const { return content.size() + gzip_content.size() + deflate_content.size(); }
+    };
+
     class rpc_server_impl : public bts::rpc_stubs::common_api_rpc_server
     {
        public:
@@ -58,6 +88,14 @@ namespace bts { namespace rpc {
          /** the set of connections that have successfully logged in */
          std::unordered_set<fc::rpc::json_connection*> _authenticated_connection_set;
 
+         /** static files under htdocs, keyed by filename */
+         std::unordered_map<std::string, std::shared_ptr<cached_file>> _file_cache;
+         uint64_t                                       _file_cache_size = 0;
+
+         /** hosted wallets selected by json connections with select_wallet */
+         std::unordered_map<fc::rpc::json_connection*, std::string> _session_wallets;
+
+
          rpc_server_impl(bts::client::client* client) :
            _client(client),
            _on_quit_promise(new fc::promise<void>("rpc_quit"))
@@ -132,6 +170,151 @@ namespace bts { namespace rpc {
             }
         }
 
+        static std::string format_http_date( std::time_t time )
+        {
+            char buffer[64];
+            std::tm time_struct;
+#ifdef WIN32
+            gmtime_s( &time_struct, &time );
+#else
+            gmtime_r( &time, &time_struct );
+#endif
+            std::strftime( buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &time_struct );
+            return buffer;
+        }
+
+        /** build tools name bundles like app.3f2a9c1d.js; those never change under the same name */
+        static bool is_hashed_asset( const fc::string& path )
+        {
+            const auto last_slash = path.rfind( '/' );
+            const fc::string filename = path.substr( last_slash == std::string::npos ? 0 : last_slash + 1 );
+            size_t component_begin = filename.find( '.' );
+            while( component_begin != std::string::npos )
+            {
+                const size_t component_end = filename.find( '.', component_begin + 1 );
+                if( component_end == std::string::npos )
+                    break;
+                const fc::string component = filename.substr( component_begin + 1, component_end - component_begin - 1 );
+                if( component.size() >= 8 && std::all_of( component.begin(), component.end(), []( char c ){ return std::isxdigit( (unsigned char)c ) != 0; } ) )
+                    return true;
+                component_begin = component_end;
+            }
+            return false;
+        }
+
+        static std::vector<char> read_file( const fc::path& filename )
+        {
+            uint64_t file_size_64 = fc::file_size( filename );
+            FC_ASSERT(file_size_64 <= std::numeric_limits<size_t>::max());
+            size_t file_size = (size_t)file_size_64;
+            FC_ASSERT( file_size != 0 );
+
+            fc::file_mapping fm( filename.generic_string().c_str(), fc::read_only );
+            fc::mapped_region mr( fm, fc::read_only, 0, file_size );
+            const char* data = (const char*)mr.get_address();
+            return std::vector<char>( data, data + mr.get_size() );
+        }
+
+        /**
+         *  Returns the cached copy of filename, (re)loading it if it changed on disk, or null if it doesn't
+         *  exist.  The copy is shared so it stays valid while a slow client is still downloading it.
+         */
+        std::shared_ptr<const cached_file> get_cached_file( const fc::path& filename )
+        {
+            const std::string key = filename.generic_string();
+            const fc::time_point now = fc::time_point::now();
+            auto iter = _file_cache.find( key );
+            if( iter != _file_cache.end() && now - iter->second->last_checked < file_revalidation_interval )
+                return iter->second;
+
+            if( !fc::exists( filename ) )
+            {
+                if( iter != _file_cache.end() )
+                {
+                    _file_cache_size -= iter->second->memory_size();
+                    _file_cache.erase( iter );
+                }
+                return nullptr;
+            }
+            FC_ASSERT( !fc::is_directory( filename ) );
+
+            const std::time_t last_write_time = boost::filesystem::last_write_time( filename );
+            if( iter != _file_cache.end() && iter->second->last_write_time == last_write_time )
+            {
+                iter->second->last_checked = now;
+                return iter->second;
+            }
+
+            auto loaded_file = std::make_shared<cached_file>();
+            cached_file& file = *loaded_file;
+            file.content = read_file( filename );
+            file.last_write_time = last_write_time;
+            file.last_modified = format_http_date( last_write_time );
+            file.etag = "\"" + fc::sha256::hash( file.content.data(), file.content.size() ).str().substr( 0, 32 ) + "\"";
+            file.last_checked = now;
+
+            const fc::path gzip_filename = filename.generic_string() + ".gz";
+            if( fc::exists( gzip_filename ) && boost::filesystem::last_write_time( gzip_filename ) >= last_write_time )
+                file.gzip_content = read_file( gzip_filename );
+            if( file.gzip_content.empty() )
+            {
+                const std::string deflated = fc::zlib_compress( std::string( file.content.data(), file.content.size() ) );
+                if( deflated.size() < file.content.size() )
+                    file.deflate_content.assign( deflated.begin(), deflated.end() );
+            }
+
+            if( iter != _file_cache.end() )
+            {
+                _file_cache_size -= iter->second->memory_size();
+                _file_cache.erase( iter );
+            }
+            // files that don't fit are served from this copy once and then dropped
+            if( file.content.size() <= max_cached_file_size && _file_cache_size + file.memory_size() <= max_file_cache_size )
+            {
+                _file_cache_size += file.memory_size();
+                _file_cache[ key ] = loaded_file;
+            }
+            return loaded_file;
+        }
+
+        fc::http::reply::status_code serve_file( const fc::http::request& r, const fc::http::server::response& s,
+                                                 const cached_file& file, fc::http::reply::status_code status,
+                                                 bool cache_forever )
+        {
+            s.add_header( "ETag", file.etag );
+            s.add_header( "Last-Modified", file.last_modified );
+            s.add_header( "Cache-Control", cache_forever ? "public, max-age=31536000, immutable" : "no-cache" );
+            s.add_header( "Vary", "Accept-Encoding" );
+
+            if( status == fc::http::reply::OK &&
+                ( r.get_header( "If-None-Match" ) == file.etag ||
+                  ( r.get_header( "If-None-Match" ).empty() && r.get_header( "If-Modified-Since" ) == file.last_modified ) ) )
+            {
+                status = (fc::http::reply::status_code)304; // Not Modified
+                s.set_status( status );
+                s.set_length( 0 );
+                return status;
+            }
+
+            const std::string accept_encoding = r.get_header( "Accept-Encoding" );
+            const std::vector<char>* body = &file.content;
+            if( !file.gzip_content.empty() && accept_encoding.find( "gzip" ) != std::string::npos )
+            {
+                s.add_header( "Content-Encoding", "gzip" );
+                body = &file.gzip_content;
+            }
+            else if( !file.deflate_content.empty() && accept_encoding.find( "deflate" ) != std::string::npos )
+            {
+                s.add_header( "Content-Encoding", "deflate" );
+                body = &file.deflate_content;
+            }
+
+            s.set_status( status );
+            s.set_length( body->size() );
+            s.write( body->data(), body->size() );
+            return status;
+        }
+
          void handle_request( const fc::http::request& r, const fc::http::server::response& s )
          {
              fc::time_point begin_time = fc::time_point::now();
@@ -206,37 +389,17 @@ namespace bts { namespace rpc {
                 {
                    _http_file_callback( path, s );
                 }
-                else if( fc::exists( filename ) )
+                else if( const auto file = get_cached_file( filename ) )
                 {
-                    FC_ASSERT( !fc::is_directory( filename ) );
-                    uint64_t file_size_64 = fc::file_size( filename );
-                    FC_ASSERT(file_size_64 <= std::numeric_limits<size_t>::max());
-                    size_t file_size = (size_t)file_size_64;
-                    FC_ASSERT( file_size != 0 );
-
-                    fc::file_mapping fm( filename.generic_string().c_str(), fc::read_only );
-                    fc::mapped_region mr( fm, fc::read_only, 0, file_size );
-                    fc_ilog( fc::logger::get("rpc"), "Processing ${path}, size: ${size}", ("path",r.path)("size",file_size));
-                    s.set_status( fc::http::reply::OK );
-                    s.set_length( file_size );
-                    s.write( (const char*)mr.get_address(), mr.get_size() );
+                    fc_ilog( fc::logger::get("rpc"), "Processing ${path}, size: ${size}", ("path",r.path)("size",file->content.size()));
+                    status = serve_file( r, s, *file, fc::http::reply::OK, is_hashed_asset( path ) );
                 }
                 else
                 {
                     fc_ilog( fc::logger::get("rpc"), "Not found ${path} (${file})", ("path",r.path)("file",filename));
-                    filename = _config.htdocs / "404.html";
-                    FC_ASSERT( !fc::is_directory( filename ) );
-                    uint64_t file_size_64 = fc::file_size( filename );
-                    FC_ASSERT(file_size_64 <= std::numeric_limits<size_t>::max());
-                    size_t file_size = (size_t)file_size_64;
-                    FC_ASSERT( file_size != 0 );
-
-                    fc::file_mapping fm( filename.generic_string().c_str(), fc::read_only );
-                    fc::mapped_region mr( fm, fc::read_only, 0, file_size );
-                    s.set_status( fc::http::reply::NotFound );
-                    s.set_length( file_size );
-                    s.write( (const char*)mr.get_address(), mr.get_size() );
-                    status = fc::http::reply::NotFound;
+                    const auto not_found_page = get_cached_file( _config.htdocs / "404.html" );
+                    FC_ASSERT( not_found_page, "missing 404.html" );
+                    status = serve_file( r, s, *not_found_page, fc::http::reply::NotFound, false );
                 }
              }
              catch ( const fc::canceled_exception& )
@@ -291,6 +454,7 @@ namespace bts { namespace rpc {
                 try {
                    auto rpc_call = fc::json::from_string( str ).get_object();
                    method_name = rpc_call["method"].as_string();
+                   const std::string session_wallet = rpc_call.contains( "wallet" ) ? rpc_call["wallet"].as_string() : std::string();
                    auto params = rpc_call["params"].get_array();
                    auto params_log = fc::json::to_string(rpc_call["params"]);
                    if(method_name.find("wallet") != std::string::npos || method_name.find("priv") != std::string::npos)
@@ -304,7 +468,7 @@ namespace bts { namespace rpc {
                       result["id"]     =  rpc_call["id"];
                       try
                       {
-                         result["result"] = dispatch_authenticated_method(_method_map[call_itr->second], params);
+                         result["result"] = dispatch_authenticated_method(_method_map[call_itr->second], params, session_wallet);
                          auto reply = fc::json::to_string( result );
                          status = fc::http::reply::OK;
                          s.set_status( status );
@@ -400,10 +564,12 @@ namespace bts { namespace rpc {
                                                                           std::move(buf_ostream) );
               register_methods( json_con );
               auto receipt = _open_json_connections.insert(json_con);
+              fc::rpc::json_connection* capture_con = json_con.get();
 
-              json_con->exec().on_complete([this,receipt,sock](fc::exception_ptr e){
+              json_con->exec().on_complete([this,receipt,sock,capture_con](fc::exception_ptr e){
                   ilog("json_con exited");
                   sock->close();
+                  _session_wallets.erase(capture_con);
                   _open_json_connections.erase(receipt.first);
                   if( e )
                     elog("Connection exited with error: ${error}", ("error", e->what()));
@@ -419,20 +585,23 @@ namespace bts { namespace rpc {
             // the login method is a special case that is only used for raw json connections
             // (not for the CLI or HTTP(s) json rpc)
             con->add_method("login", boost::bind(&rpc_server_impl::login, this, capture_con, _1));
+            con->add_method("select_wallet", boost::bind(&rpc_server_impl::select_wallet, this, capture_con, _1));
+            // every method goes through the dispatcher, rather than the generated stubs that call the client
+            // directly, so calls from all connections are serialized and each runs against its session's wallet
             for (const method_map_type::value_type& method : _method_map)
             {
-              if (method.second.method)
+              auto bind_method = boost::bind(&rpc_server_impl::dispatch_method_from_json_connection,
+                                             this, capture_con, method.second, _1);
+              auto bind_named_method = boost::bind(&rpc_server_impl::dispatch_named_method_from_json_connection,
+                                                   this, capture_con, method.second, _1);
+              con->add_method(method.first, bind_method);
+              con->add_named_param_method(method.first, bind_named_method);
+              for (const std::string& alias : method.second.aliases)
               {
-                // old method using old registration system
-                auto bind_method = boost::bind(&rpc_server_impl::dispatch_method_from_json_connection,
-                                                          this, capture_con, method.second, _1);
-                con->add_method(method.first, bind_method);
-                for ( auto alias : method.second.aliases )
-                    con->add_method(alias, bind_method);
+                con->add_method(alias, bind_method);
+                con->add_named_param_method(alias, bind_named_method);
               }
             }
-
-            register_common_api_methods(con);
          } // register methods
 
         fc::variant dispatch_method_from_json_connection(fc::rpc::json_connection* con,
@@ -443,14 +612,41 @@ namespace bts { namespace rpc {
           if ((method_data.prerequisites & bts::api::json_authenticated) &&
               _authenticated_connection_set.find(con) == _authenticated_connection_set.end())
             FC_THROW_EXCEPTION( login_required, "not logged in");
-          return dispatch_authenticated_method(method_data, arguments);
+          auto session_iter = _session_wallets.find(con);
+          return dispatch_authenticated_method(method_data, arguments,
+                                               session_iter != _session_wallets.end() ? session_iter->second : std::string());
+        }
+
+        fc::variant dispatch_named_method_from_json_connection(fc::rpc::json_connection* con,
+                                                               const bts::api::method_data& method_data,
+                                                               const fc::variant_object& named_arguments)
+        {
+          fc::variants arguments;
+          for (const bts::api::parameter_data& parameter : method_data.parameters)
+          {
+            if (named_arguments.contains(parameter.name.c_str()))
+              arguments.push_back(named_arguments[parameter.name.c_str()]);
+            else if (parameter.default_value.valid())
+              arguments.push_back(*parameter.default_value);
+            else
+              break;
+          }
+          return dispatch_method_from_json_connection(con, method_data, arguments);
         }
 
         fc::variant dispatch_authenticated_method(const bts::api::method_data& method_data,
-                                                  const fc::variants& arguments_from_caller)
+                                                  const fc::variants& arguments_from_caller,
+                                                  const std::string& session_wallet = std::string())
         {
           fc::scoped_lock<fc::mutex> lock(_rpc_mutex);
 
+          // every RPC call is dispatched under _rpc_mutex, so the wallet handed to this call is the only
+          // one the wallet API methods can see until it returns; a call made from inside another one, like
+          // a command run by execute_command_line, keeps the outer call's wallet
+          const bts::wallet::wallet_ptr call_wallet = session_wallet.empty() ? _client->get_call_wallet()
+                                                                             : _client->get_hosted_wallet(session_wallet);
+          bts::client::client::wallet_call_scope wallet_scope(*_client, call_wallet);
+
           if (!method_data.method)
           {
             // then this is a method using our new generated code
@@ -530,6 +726,7 @@ namespace bts { namespace rpc {
         }
 
         fc::variant login( fc::rpc::json_connection* json_connection, const fc::variants& params );
+        fc::variant select_wallet( fc::rpc::json_connection* json_connection, const fc::variants& params );
     };
 
     bts::api::common_api* rpc_server_impl::get_client() const
@@ -544,12 +741,12 @@ namespace bts { namespace rpc {
     }
     void rpc_server_impl::verify_wallet_is_open() const
     {
-      if (!_client->get_wallet()->is_open())
+      if (!_client->get_call_wallet()->is_open())
         throw rpc_wallet_open_needed_exception(FC_LOG_MESSAGE(error, "The wallet must be open before executing this command"));
     }
     void rpc_server_impl::verify_wallet_is_unlocked() const
     {
-      if (_client->get_wallet()->is_locked())
+      if (_client->get_call_wallet()->is_locked())
         throw rpc_wallet_unlock_needed_exception(FC_LOG_MESSAGE(error, "The wallet's spending key must be unlocked before executing this command"));
     }
     void rpc_server_impl::verify_connected_to_network() const
@@ -578,6 +775,25 @@ namespace bts { namespace rpc {
       return fc::variant( true );
     }
 
+    // select_wallet <wallet_name>: routes every later call on this connection to a wallet opened with
+    // wallet_hosted_open; an empty name goes back to the primary wallet.
+    fc::variant rpc_server_impl::select_wallet(fc::rpc::json_connection* con, const fc::variants& params)
+    {
+      FC_ASSERT( params.size() == 1 );
+      if (_authenticated_connection_set.find(con) == _authenticated_connection_set.end())
+        FC_THROW_EXCEPTION( login_required, "not logged in");
+
+      const std::string wallet_name = params[0].as_string();
+      if (wallet_name.empty())
+      {
+        _session_wallets.erase(con);
+        return fc::variant( true );
+      }
+      _client->get_hosted_wallet(wallet_name);
+      _session_wallets[con] = wallet_name;
+      return fc::variant( true );
+    }
+
     std::string rpc_server_impl::help(const std::string& command_name) const
     {
       std::string help_string;
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <bts/wallet/wallet.hpp>
+
+namespace bts { namespace wallet {
+
+   /**
+    *  Scans each newly applied block once on behalf of every wallet hosted in the process.
+    *
+    *  The owner addresses touched by each transaction are matched against the union of all
+    *  wallets' key addresses, and each wallet is handed only the transactions and market
+    *  transactions that concern it.  Operations whose owner can't be determined cheaply
+    *  (titan memos, multisig, account operations, ...) go to every wallet, which is what
+    *  each wallet would have scanned on its own anyway.
+    *
+    *  Wallets that have fallen behind the head block are caught up with their own
+    *  scan_chain() and join the shared pass once they reach the head.
+    */
+   class shared_block_scanner : public chain_observer
+   {
+      public:
+         shared_block_scanner( chain_database_ptr blockchain );
+         virtual ~shared_block_scanner()override;
+
+         void add_wallet( const wallet_ptr& wallet_to_add );
+         void remove_wallet( const wallet_ptr& wallet_to_remove );
+
+         virtual void state_changed( const pending_chain_state_ptr& state )override {}
+         virtual void block_applied( const block_summary& summary )override;
+
+      private:
+         /** returns false if the transaction must be offered to every wallet */
+         bool collect_owner_addresses( const signed_transaction& transaction, vector<address>& owners )const;
+
+         chain_database_ptr _blockchain;
+         vector<wallet_ptr> _wallets;
+   };
+
+} } // bts::wallet
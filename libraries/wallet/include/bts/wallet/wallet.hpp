@@ -89,6 +89,8 @@ namespace bts { namespace wallet {
          uint32_t               get_transaction_expiration()const;
 
          float                  get_scan_progress()const;
+         /** true while a scan_chain task is running */
+         bool                   is_scanning()const;
 
          void                   set_setting( const string& name, const variant& value );
          fc::optional<variant>  get_setting( const string& name )const;
@@ -126,6 +128,26 @@ namespace bts { namespace wallet {
          map<transaction_id_type, fc::exception>    get_pending_transaction_errors()const;
 
          void scan_chain( uint32_t start = 0, uint32_t end = -1, bool fast_scan = false );
+         /** resyncs balances and registered accounts by walking every record in the chain */
+         void repair_state();
+
+         /**
+          *  When several wallets are hosted in one process, a shared_block_scanner scans each
+          *  new block once for all of them and hands each wallet only the transactions that
+          *  concern it.  While this is set the wallet doesn't scan new blocks on its own.
+          */
+         void set_shared_scanning( bool enabled );
+         bool get_shared_scanning()const;
+         /**
+          *  every address a key in this wallet can own balances under: the BTS address and the
+          *  PTS and BTC forms genesis balances use; used to route transactions to it
+          */
+         unordered_set<address> get_key_addresses()const;
+         /** approximate bytes held by the wallet's in-memory record maps */
+         fc::variant_object get_memory_usage()const;
+         /** scans the given transactions of a block that was just applied, then marks the block as scanned */
+         void scan_block_transactions( const full_block& block, const vector<uint16_t>& transaction_indexes,
+                                       const vector<market_transaction>& market_transactions );
 
          wallet_transaction_record         scan_transaction( const string& transaction_id_prefix, bool overwrite_existing );
          transaction_ledger_entry          scan_transaction_experimental( const string& transaction_id_prefix, bool overwrite_existing );
@@ -17,6 +17,41 @@ namespace bts { namespace wallet {
 
          bool is_open()const;
 
+         /**
+          *  While a transaction is open, record writes update the in-memory maps immediately
+          *  but are collected into a single batch that is written and synced to disk once, when
+          *  the outermost transaction commits.  If that write fails the in-memory maps are
+          *  reloaded from disk, so they never disagree with what was actually stored.
+          *
+          *  Transactions nest; only the outermost commit touches the disk.  Aborting drops the collected
+          *  writes and reloads the in-memory maps; aborting a nested transaction dooms the outermost one.
+          *
+          *  The batch is shared by every fiber using this wallet_db, so a transaction must not be held
+          *  open across a yield.
+          */
+         void begin_transaction();
+         void commit_transaction();
+         void abort_transaction();
+         bool in_transaction()const;
+
+         /**
+          *  opens a wallet_db transaction for its lifetime, committing it when it goes out of scope
+          *  normally and aborting it when the scope is left by an exception
+          */
+         class transaction_scope
+         {
+            public:
+               transaction_scope( wallet_db& db );
+               ~transaction_scope();
+
+               /** commits now so a failure can be reported, instead of only logged by the destructor */
+               void commit();
+
+            private:
+               wallet_db& _db;
+               bool       _committed = false;
+         };
+
          private_key_type   get_private_key( const fc::sha512& password, int index );
 
          private_key_type   new_private_key( const fc::sha512& password,
@@ -96,6 +131,14 @@ namespace bts { namespace wallet {
          {
             return keys;
          }
+         /** every address form a wallet key may own balances under, mapped to the key's address */
+         const unordered_map< address, address >& get_key_addresses()const
+         {
+            return btc_to_bts_address;
+         }
+
+         /** approximate bytes held by each in-memory record map and lookup cache */
+         fc::variant_object get_memory_usage()const;
 
          map<transaction_id_type, transaction_ledger_entry> experimental_transactions;
 
@@ -26,6 +26,7 @@ class wallet_impl : public chain_observer
        unsigned                                   _num_scanner_threads = 1;
        vector<std::unique_ptr<fc::thread>>        _scanner_threads;
        float                                      _scan_progress = 0;
+       bool                                       _shared_scanning = false;
 
        struct login_record
        {
@@ -74,9 +75,14 @@ class wallet_impl : public chain_observer
       secret_hash_type get_secret( uint32_t block_num,
                                    const private_key_type& delegate_key )const;
 
-      void scan_state();
+      void scan_state( bool full_repair = false );
 
-      void scan_block( uint32_t block_num, const vector<private_key_type>& keys, const time_point_sec& received_time );
+      /** false only when the block's address filter proves it touches none of filter_elements */
+      bool block_may_concern_wallet( uint32_t block_num, const vector<string>& filter_elements )const;
+      /** true if scanning the block decrypts titan memos on the scanner threads, which yields */
+      bool block_has_memo_deposits( const full_block& block )const;
+      void scan_block( const full_block& block, const vector<private_key_type>& keys, const time_point_sec& received_time );
+      void refresh_accounts_from_chain();
 
       wallet_transaction_record scan_transaction(
               const signed_transaction& transaction,
@@ -141,8 +147,9 @@ class wallet_impl : public chain_observer
 
       vector<wallet_transaction_record> get_pending_transactions()const;
 
-      void scan_balances();
-      void scan_registered_accounts();
+      /** full_repair walks every balance / account in the chain instead of looking up the wallet's own keys */
+      void scan_balances( bool full_repair = false );
+      void scan_registered_accounts( bool full_repair = false );
       void withdraw_to_transaction( const asset& amount_to_withdraw,
                                     const string& from_account_name,
                                     signed_transaction& trx,
@@ -0,0 +1,157 @@
+#include <bts/wallet/shared_block_scanner.hpp>
+
+#include <bts/blockchain/balance_operations.hpp>
+#include <bts/blockchain/market_operations.hpp>
+
+namespace bts { namespace wallet {
+
+   shared_block_scanner::shared_block_scanner( chain_database_ptr blockchain )
+   :_blockchain( blockchain )
+   {
+      _blockchain->add_observer( this );
+   }
+
+   shared_block_scanner::~shared_block_scanner()
+   {
+      _blockchain->remove_observer( this );
+      for( const wallet_ptr& hosted_wallet : _wallets )
+         hosted_wallet->set_shared_scanning( false );
+   }
+
+   void shared_block_scanner::add_wallet( const wallet_ptr& wallet_to_add )
+   {
+      FC_ASSERT( wallet_to_add );
+      if( std::find( _wallets.begin(), _wallets.end(), wallet_to_add ) != _wallets.end() )
+         return;
+      wallet_to_add->set_shared_scanning( true );
+      _wallets.push_back( wallet_to_add );
+   }
+
+   void shared_block_scanner::remove_wallet( const wallet_ptr& wallet_to_remove )
+   {
+      auto iter = std::find( _wallets.begin(), _wallets.end(), wallet_to_remove );
+      if( iter == _wallets.end() )
+         return;
+      wallet_to_remove->set_shared_scanning( false );
+      _wallets.erase( iter );
+   }
+
+   bool shared_block_scanner::collect_owner_addresses( const signed_transaction& transaction, vector<address>& owners )const
+   {
+      for( const operation& op : transaction.operations )
+      {
+         switch( operation_type_enum( op.type ) )
+         {
+            case deposit_op_type:
+            {
+               const auto deposit_op = op.as<deposit_operation>();
+               if( withdraw_condition_types( deposit_op.condition.type ) != withdraw_signature_type )
+                  return false;
+               const auto condition = deposit_op.condition.as<withdraw_with_signature>();
+               // titan deposits go to one-time addresses, only decrypting the memo can tell whose they are
+               if( condition.memo.valid() )
+                  return false;
+               owners.push_back( condition.owner );
+               break;
+            }
+            case withdraw_op_type:
+            {
+               const obalance_record balance = _blockchain->get_balance_record( op.as<withdraw_operation>().balance_id );
+               if( !balance.valid() || withdraw_condition_types( balance->condition.type ) != withdraw_signature_type )
+                  return false;
+               owners.push_back( balance->owner() );
+               break;
+            }
+            case bid_op_type:
+               owners.push_back( op.as<bid_operation>().bid_index.owner );
+               break;
+            case ask_op_type:
+               owners.push_back( op.as<ask_operation>().ask_index.owner );
+               break;
+            case short_op_v2_type:
+               owners.push_back( op.as<short_operation>().short_index.owner );
+               break;
+            default:
+               return false;
+         }
+      }
+      return true;
+   }
+
+   void shared_block_scanner::block_applied( const block_summary& summary )
+   { try {
+      const full_block& block = summary.block_data;
+
+      // wallets that are caught up take part in the shared pass, the rest catch up on their own
+      vector<wallet_ptr> participants;
+      for( const wallet_ptr& hosted_wallet : _wallets )
+      {
+         if( !hosted_wallet->is_open() || !hosted_wallet->is_unlocked() ) continue;
+         if( !hosted_wallet->get_transaction_scanning() ) continue;
+         const uint32_t last_scanned = hosted_wallet->get_last_scanned_block_number();
+         if( block.block_num <= last_scanned ) continue;
+         // a catch-up scan already running would be canceled and restarted from scratch by another scan_chain
+         if( hosted_wallet->is_scanning() ) continue;
+         if( last_scanned + 1 == block.block_num )
+            participants.push_back( hosted_wallet );
+         else
+            hosted_wallet->scan_chain( last_scanned, block.block_num );
+      }
+      if( participants.empty() )
+         return;
+
+      unordered_map<address, vector<size_t>> wallets_by_address;
+      for( size_t i = 0; i < participants.size(); ++i )
+         for( const address& key_address : participants[ i ]->get_key_addresses() )
+            wallets_by_address[ key_address ].push_back( i );
+
+      const auto route_address = [&]( const address& owner, set<size_t>& wallet_indexes )
+      {
+         const auto iter = wallets_by_address.find( owner );
+         if( iter != wallets_by_address.end() )
+            wallet_indexes.insert( iter->second.begin(), iter->second.end() );
+      };
+
+      vector<vector<uint16_t>> transactions_by_wallet( participants.size() );
+      vector<address> owners;
+      for( uint16_t trx_index = 0; trx_index < block.user_transactions.size(); ++trx_index )
+      {
+         owners.clear();
+         if( !collect_owner_addresses( block.user_transactions[ trx_index ], owners ) )
+         {
+            for( auto& wallet_transactions : transactions_by_wallet )
+               wallet_transactions.push_back( trx_index );
+            continue;
+         }
+         set<size_t> wallet_indexes;
+         for( const address& owner : owners )
+            route_address( owner, wallet_indexes );
+         for( const size_t wallet_index : wallet_indexes )
+            transactions_by_wallet[ wallet_index ].push_back( trx_index );
+      }
+
+      vector<vector<market_transaction>> market_transactions_by_wallet( participants.size() );
+      for( const market_transaction& market_trx : _blockchain->get_market_transactions( block.block_num ) )
+      {
+         set<size_t> wallet_indexes;
+         route_address( market_trx.bid_owner, wallet_indexes );
+         route_address( market_trx.ask_owner, wallet_indexes );
+         for( const size_t wallet_index : wallet_indexes )
+            market_transactions_by_wallet[ wallet_index ].push_back( market_trx );
+      }
+
+      for( size_t i = 0; i < participants.size(); ++i )
+      {
+         try
+         {
+            participants[ i ]->scan_block_transactions( block, transactions_by_wallet[ i ], market_transactions_by_wallet[ i ] );
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "error scanning block ${n} for wallet ${w}: ${e}",
+                  ("n",block.block_num)("w",participants[ i ]->get_wallet_name())("e",e.to_detail_string()) );
+         }
+      }
+   } FC_CAPTURE_AND_RETHROW( (summary.block_data.block_num) ) }
+
+} } // bts::wallet
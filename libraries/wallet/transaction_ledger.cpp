@@ -206,7 +206,7 @@ void wallet_impl::scan_market_transaction(
 } FC_CAPTURE_AND_RETHROW() }
 
 // TODO: No longer needed with scan_genesis_experimental and get_account_balance_records
-void wallet_impl::scan_balances()
+void wallet_impl::scan_balances( bool full_repair )
 {
    /* Delete ledger entries for any genesis balances before we can reconstruct them */
    const auto my_accounts = self->list_my_accounts();
@@ -222,7 +222,7 @@ void wallet_impl::scan_balances()
    }
 
    const auto timestamp = _blockchain->get_genesis_timestamp();
-   _blockchain->scan_balances( [&]( const balance_record& bal_rec )
+   const auto scan_balance = [&]( const balance_record& bal_rec )
    {
         const auto key_rec = _wallet_db.lookup_key( bal_rec.owner() );
         if( key_rec.valid() && key_rec->has_private_key() )
@@ -253,15 +253,27 @@ void wallet_impl::scan_balances()
               _wallet_db.store_transaction( *transaction_record, false );
           }
         }
-   } );
+   };
+
+   if( full_repair )
+   {
+       _blockchain->scan_balances( scan_balance );
+       return;
+   }
+
+   /* Look up balances by each address form of the wallet's keys rather than walking every balance in the chain */
+   for( const auto& item : _wallet_db.get_key_addresses() )
+   {
+       for( const balance_record& bal_rec : _blockchain->get_balances_for_owner( item.first ) )
+           scan_balance( bal_rec );
+   }
 }
 
-void wallet_impl::scan_registered_accounts()
+void wallet_impl::scan_registered_accounts( bool full_repair )
 {
-   _blockchain->scan_accounts( [&]( const blockchain::account_record& scanned_account_record )
+   const auto scan_account = [&]( const blockchain::account_record& scanned_account_record, const address& key_address )
    {
-        // TODO: check owner key as well!
-        auto key_rec =_wallet_db.lookup_key( scanned_account_record.active_key() );
+        auto key_rec =_wallet_db.lookup_key( key_address );
         if( key_rec.valid() && key_rec->has_private_key() )
         {
            auto existing_account_record = _wallet_db.lookup_account( key_rec->account_address );
@@ -272,13 +284,65 @@ void wallet_impl::scan_registered_accounts()
               _wallet_db.cache_account( *existing_account_record, false );
            }
         }
-   } );
-   ilog( "account scan complete" );
+   };
+
+   if( full_repair )
+   {
+       _blockchain->scan_accounts( [&]( const blockchain::account_record& scanned_account_record )
+       {
+            scan_account( scanned_account_record, scanned_account_record.active_key() );
+            scan_account( scanned_account_record, scanned_account_record.owner_key );
+       } );
+       return;
+   }
+
+   /* Accounts are indexed by every active key they have used, so each wallet key is a point lookup */
+   for( const auto& item : _wallet_db.get_keys() )
+   {
+       if( !item.second.has_private_key() ) continue;
+       const oaccount_record scanned_account_record = _blockchain->get_account_record( item.first );
+       if( scanned_account_record.valid() && address( scanned_account_record->active_key() ) == item.first )
+           scan_account( *scanned_account_record, item.first );
+   }
+
+   /* Owner keys are not indexed, but the wallet already knows the names of the accounts it owns */
+   for( const auto& item : _wallet_db.get_accounts() )
+   {
+       const oaccount_record scanned_account_record = _blockchain->get_account_record( item.second.name );
+       if( scanned_account_record.valid() && scanned_account_record->owner_key == item.second.owner_key )
+           scan_account( *scanned_account_record, scanned_account_record->owner_key );
+   }
+}
+
+bool wallet_impl::block_may_concern_wallet( uint32_t block_num, const vector<string>& filter_elements )const
+{ try {
+    const block_id_type block_id = _blockchain->get_block_id( block_num );
+    const oaddress_filter filter = _blockchain->get_address_filter( block_id );
+    if( !filter.valid() || filter->has_unfiltered_deposits )
+        return true;
+    return filter->matches_any( block_id, filter_elements );
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+bool wallet_impl::block_has_memo_deposits( const full_block& block )const
+{
+    for( const signed_transaction& transaction : block.user_transactions )
+    {
+        for( const operation& op : transaction.operations )
+        {
+            if( operation_type_enum( op.type ) != deposit_op_type )
+                continue;
+            const deposit_operation deposit = op.as<deposit_operation>();
+            if( withdraw_condition_types( deposit.condition.type ) == withdraw_signature_type
+                && deposit.condition.as<withdraw_with_signature>().memo.valid() )
+                return true;
+        }
+    }
+    return false;
 }
 
-void wallet_impl::scan_block( uint32_t block_num, const vector<private_key_type>& keys, const time_point_sec& received_time )
+void wallet_impl::scan_block( const full_block& block, const vector<private_key_type>& keys, const time_point_sec& received_time )
 { try {
-    const full_block& block = _blockchain->get_block( block_num );
+    const uint32_t block_num = block.block_num;
     for( const signed_transaction& transaction : block.user_transactions )
     {
         try
@@ -301,7 +365,7 @@ void wallet_impl::scan_block( uint32_t block_num, const vector<private_key_type>
         {
         }
     }
-} FC_CAPTURE_AND_RETHROW( (block_num)(received_time) ) }
+} FC_CAPTURE_AND_RETHROW( (block.block_num)(received_time) ) }
 
 wallet_transaction_record wallet_impl::scan_transaction(
         const signed_transaction& transaction,
@@ -45,10 +45,11 @@ namespace detail {
 
    void wallet_impl::block_applied( const block_summary& summary )
    {
+       if( _shared_scanning ) return;
        if( !self->is_open() || !self->is_unlocked() ) return;
        if( !self->get_transaction_scanning() ) return;
        if( summary.block_data.block_num <= self->get_last_scanned_block_number() ) return;
-       if( _scan_in_progress.valid() && !_scan_in_progress.ready() ) return;
+       if( self->is_scanning() ) return;
 
        self->scan_chain( self->get_last_scanned_block_number(), summary.block_data.block_num );
    }
@@ -104,14 +105,14 @@ namespace detail {
    {
       address source_addr(source);
       balance_record record;
-      _blockchain->scan_balances( [&] ( const balance_record &balance_record ) {
-          if( balance_record.genesis_info.valid()
-                  && balance_record.get_balance().asset_id == 0
-                  && balance_record.condition.type == withdraw_signature_type
-                  && balance_record.condition.as<withdraw_with_signature>().owner == source_addr ) {
-              record = balance_record;
-          }
-      } );
+      for( const balance_record& genesis_balance : _blockchain->get_balances_for_owner( source_addr ) )
+      {
+          if( genesis_balance.genesis_info.valid()
+                  && genesis_balance.get_balance().asset_id == 0
+                  && genesis_balance.get_balance().amount > 0
+                  && genesis_balance.condition.type == withdraw_signature_type )
+              record = genesis_balance;
+      }
       const asset balance = record.get_balance();
       FC_ASSERT( balance.amount > 0 && balance.asset_id == 0, "No unspent genesis balance found for " + string(source) );
       trx.claim( record, recipient, source, signature );
@@ -256,14 +257,51 @@ namespace detail {
         for( const wallet_account_record& account : accounts )
             account_names.insert( account.name );
 
+        // Collect everything a block's address filter could match for this wallet
+        vector<string> filter_elements;
+        // genesis balances are owned by the PTS and BTC forms of a key, so every form is matched
+        filter_elements.reserve( _wallet_db.get_key_addresses().size() + _wallet_db.get_accounts().size() + account_balances.size() );
+        for( const auto& item : _wallet_db.get_key_addresses() )
+            filter_elements.push_back( address_filter::address_element( item.first ) );
+        for( const auto& item : _wallet_db.get_accounts() )
+        {
+            if( item.second.id != 0 )
+                filter_elements.push_back( address_filter::account_element( item.second.id ) );
+        }
+        for( const auto& item : account_balances )
+            filter_elements.push_back( address_filter::address_element( item.first ) );
+
         if( min_end > start + 1 )
             ulog( "Beginning scan at block ${n}...", ("n",start) );
 
+        // write what each run of blocks finds to disk in one batch instead of record by record
+        std::unique_ptr<wallet_db::transaction_scope> batch;
         for( auto block_num = start; !_scan_in_progress.canceled() && block_num <= min_end; ++block_num )
         {
+            optional<full_block> block;
+            try
+            {
+                if( block_may_concern_wallet( block_num, filter_elements ) )
+                    block = _blockchain->get_block( block_num );
+            }
+            catch( ... )
+            {
+            }
+
+            // decrypting titan memos waits on the scanner threads, so those blocks are scanned with the batch committed
+            const bool scan_may_yield = block.valid() && block_has_memo_deposits( *block );
+            if( scan_may_yield && batch )
+            {
+                batch->commit();
+                batch.reset();
+            }
+            if( !scan_may_yield && !batch )
+                batch.reset( new wallet_db::transaction_scope( _wallet_db ) );
+
             try
             {
-                scan_block( block_num, private_keys, now );
+                if( block.valid() )
+                    scan_block( *block, private_keys, now );
             }
             catch( ... )
             {
@@ -279,33 +317,35 @@ namespace detail {
             }
 #endif
             _scan_progress = float(block_num-start)/(min_end-start+1);
+            if( !batch )
+                batch.reset( new wallet_db::transaction_scope( _wallet_db ) );
             self->set_last_scanned_block_number( block_num );
 
+            // other fibers write to the same wallet_db, so the batch is committed before every yield
+            const bool yield = !fast_scan && block_num > start && (block_num - start) % 100 == 0;
+            if( yield || (block_num - start + 1) % 1000 == 0 )
+            {
+                batch->commit();
+                batch.reset();
+            }
+
             if( block_num > start )
             {
                 if( (block_num - start) % 10000 == 0 )
                     ulog( "Scanning ${p} done...", ("p",cli::pretty_percent( _scan_progress, 1 )) );
 
-                if( !fast_scan && (block_num - start) % 100 == 0 )
+                if( yield )
                     fc::usleep( fc::microseconds( 100 ) );
             }
         }
-
-        // Update local accounts
+        if( batch )
         {
-            const auto accounts = _wallet_db.get_accounts();
-            for( auto acct : accounts )
-            {
-               auto blockchain_acct_rec = _blockchain->get_account_record( acct.second.id );
-               if( blockchain_acct_rec.valid() )
-               {
-                   blockchain::account_record& brec = acct.second;
-                   brec = *blockchain_acct_rec;
-                   _wallet_db.cache_account( acct.second, false );
-               }
-            }
+            batch->commit();
+            batch.reset();
         }
 
+        refresh_accounts_from_chain();
+
         _scan_progress = 1;
         if( min_end > start + 1 )
             ulog( "Scan completed." );
@@ -318,6 +358,21 @@ namespace detail {
       }
    } FC_CAPTURE_AND_RETHROW( (start)(end)(fast_scan) ) }
 
+   void wallet_impl::refresh_accounts_from_chain()
+   {
+       const auto accounts = _wallet_db.get_accounts();
+       for( auto acct : accounts )
+       {
+          auto blockchain_acct_rec = _blockchain->get_account_record( acct.second.id );
+          if( blockchain_acct_rec.valid() )
+          {
+              blockchain::account_record& brec = acct.second;
+              brec = *blockchain_acct_rec;
+              _wallet_db.cache_account( acct.second, false );
+          }
+       }
+   }
+
    void wallet_impl::upgrade_version()
    {
        const uint32_t current_version = self->get_version();
@@ -616,12 +671,14 @@ namespace detail {
       return slate_id;
    }
 
-   void wallet_impl::scan_state()
+   void wallet_impl::scan_state( bool full_repair )
    { try {
       ilog( "WALLET: Scanning blockchain state" );
-      scan_balances();
-      scan_registered_accounts();
-   } FC_CAPTURE_AND_RETHROW() }
+      wallet_db::transaction_scope batch( _wallet_db );
+      scan_balances( full_repair );
+      scan_registered_accounts( full_repair );
+      batch.commit();
+   } FC_CAPTURE_AND_RETHROW( (full_repair) ) }
 
    /**
     *  A valid account is any named account registered in the blockchain or
@@ -805,6 +862,7 @@ namespace detail {
    wallet::~wallet()
    {
       close();
+      my->_blockchain->remove_observer( my.get() );
    }
 
    void wallet::set_data_directory( const path& data_dir )
@@ -1549,6 +1607,84 @@ namespace detail {
       my->_scan_in_progress.on_complete([](fc::exception_ptr ep){if (ep) elog( "Error during chain scan: ${e}", ("e", ep->to_detail_string()));});
    } FC_CAPTURE_AND_RETHROW( (start)(end) ) }
 
+   void wallet::repair_state()
+   { try {
+      FC_ASSERT( is_open() );
+      FC_ASSERT( is_unlocked() );
+      my->scan_state( true );
+   } FC_CAPTURE_AND_RETHROW() }
+
+   void wallet::set_shared_scanning( bool enabled )
+   {
+      my->_shared_scanning = enabled;
+   }
+
+   bool wallet::get_shared_scanning()const
+   {
+      return my->_shared_scanning;
+   }
+
+   unordered_set<address> wallet::get_key_addresses()const
+   { try {
+      FC_ASSERT( is_open() );
+      unordered_set<address> addresses;
+      const auto& key_addresses = my->_wallet_db.get_key_addresses();
+      addresses.reserve( key_addresses.size() );
+      for( const auto& item : key_addresses )
+         addresses.insert( item.first );
+      return addresses;
+   } FC_CAPTURE_AND_RETHROW() }
+
+   fc::variant_object wallet::get_memory_usage()const
+   {
+      if( !is_open() )
+         return fc::variant_object();
+      return my->_wallet_db.get_memory_usage();
+   }
+
+   void wallet::scan_block_transactions( const full_block& block, const vector<uint16_t>& transaction_indexes,
+                                         const vector<market_transaction>& market_transactions )
+   { try {
+      FC_ASSERT( is_open() );
+      FC_ASSERT( is_unlocked() );
+      const auto now = blockchain::now();
+
+      if( !transaction_indexes.empty() )
+      {
+         const auto account_keys = my->_wallet_db.get_account_private_keys( my->_wallet_password );
+         vector<private_key_type> private_keys;
+         private_keys.reserve( account_keys.size() );
+         for( const auto& item : account_keys )
+            private_keys.push_back( item.first );
+
+         for( const uint16_t index : transaction_indexes )
+         {
+            try
+            {
+               my->scan_transaction( block.user_transactions.at( index ), block.block_num, block.timestamp, private_keys, now );
+            }
+            catch( ... )
+            {
+            }
+         }
+      }
+
+      for( const market_transaction& market_trx : market_transactions )
+      {
+         try
+         {
+            my->scan_market_transaction( market_trx, block.block_num, block.timestamp, now );
+         }
+         catch( ... )
+         {
+         }
+      }
+
+      if( !transaction_indexes.empty() )
+         my->refresh_accounts_from_chain();
+      set_last_scanned_block_number( block.block_num );
+   } FC_CAPTURE_AND_RETHROW( (block.block_num)(transaction_indexes) ) }
+
    vote_summary wallet::get_vote_proportion( const string& account_name )
    {
        uint64_t total_possible = 0;
@@ -1985,6 +2121,7 @@ namespace detail {
 
    uint32_t wallet::regenerate_keys( const string& account_name, uint32_t count )
    { try {
+      wallet_db::transaction_scope batch( my->_wallet_db );
       uint32_t regenerated_keys = 0;
       for( uint32_t i = 0; i < count; ++i )
       {
@@ -2033,6 +2170,7 @@ namespace detail {
       }
       if( next_child_index < count )
          my->_wallet_db.set_property( property_enum::next_child_key_index, count );
+      batch.commit();
 
      if( regenerated_keys )
        scan_chain( 0, -1, true );
@@ -2047,6 +2185,7 @@ namespace detail {
      int attempts = 0;
      int recoveries = 0;
 
+     wallet_db::transaction_scope batch( my->_wallet_db );
      while( recoveries < number_of_accounts && attempts++ < max_number_of_attempts )
      {
         private_key_type new_priv_key = my->_wallet_db.new_private_key( my->_wallet_password, address(), false );
@@ -2059,6 +2198,7 @@ namespace detail {
           ++recoveries;
         }
      }
+     batch.commit();
 
      if( recoveries )
        scan_chain( 0, -1, true );
@@ -3464,6 +3604,11 @@ namespace detail {
        return my->_wallet_db.get_property( transaction_expiration_sec ).as<uint32_t>();
    } FC_CAPTURE_AND_RETHROW() }
 
+   bool wallet::is_scanning()const
+   {
+      return my->_scan_in_progress.valid() && !my->_scan_in_progress.ready();
+   }
+
    float wallet::get_scan_progress()const
    { try {
        FC_ASSERT( is_open() );
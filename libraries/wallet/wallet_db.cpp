@@ -3,7 +3,10 @@
 #include <bts/wallet/wallet_db.hpp>
 
 #include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+#include <exception>
 #include <fstream>
+#include <utility>
 
 namespace bts { namespace wallet {
 
@@ -16,15 +19,143 @@ namespace bts { namespace wallet {
            wallet_db*                                        self = nullptr;
            bts::db::level_map<int32_t,generic_wallet_record> _records;
 
+           /** writes collected by an open transaction; a null record is a removal */
+           std::map<int32_t, optional<generic_wallet_record>> _pending_writes;
+           uint32_t                                          _transaction_depth = 0;
+           /** set when a nested transaction aborts, so the outermost one discards instead of writing */
+           bool                                              _transaction_aborted = false;
+
            void store_generic_record( const generic_wallet_record& record, bool sync = true )
            { try {
                auto index = record.get_wallet_record_index();
                FC_ASSERT( index != 0 );
                FC_ASSERT( _records.is_open() );
-               _records.store( index, record, sync );
+               if( _transaction_depth > 0 )
+                  _pending_writes[ index ] = record;
+               else
+                  _records.store( index, record, sync );
                load_generic_record( record );
            } FC_CAPTURE_AND_RETHROW( (record) ) }
 
+           void remove_generic_record( int32_t index, bool sync )
+           {
+               if( _transaction_depth > 0 )
+                  _pending_writes[ index ] = optional<generic_wallet_record>();
+               else
+                  _records.remove( index, sync );
+           }
+
+           void write_pending_records()
+           { try {
+               if( _pending_writes.empty() )
+                  return;
+
+               auto batch = _records.create_batch( true );
+               try
+               {
+                  for( const auto& item : _pending_writes )
+                  {
+                     if( item.second.valid() )
+                        batch.store( item.first, *item.second );
+                     else
+                        batch.remove( item.first );
+                  }
+                  batch.commit();
+                  _pending_writes.clear();
+               }
+               catch( const fc::exception& e )
+               {
+                  elog( "Failed to commit wallet transaction, reloading wallet records: ${e}", ("e",e.to_detail_string()) );
+                  batch.abort();
+                  _pending_writes.clear();
+                  restore_records();
+                  throw;
+               }
+           } FC_CAPTURE_AND_RETHROW() }
+
+           /** drops the collected writes and restores the in-memory maps they had already updated */
+           void discard_pending_records()
+           {
+               if( _pending_writes.empty() )
+                  return;
+               _pending_writes.clear();
+               restore_records();
+           }
+
+           void clear_records()
+           {
+               self->wallet_master_key.reset();
+
+               self->accounts.clear();
+               self->keys.clear();
+               self->transactions.clear();
+               self->balances.clear();
+               self->properties.clear();
+               self->settings.clear();
+
+               self->btc_to_bts_address.clear();
+               self->address_to_account_wallet_record_index.clear();
+               self->account_id_to_wallet_record_index.clear();
+               self->name_to_account_wallet_record_index.clear();
+           }
+
+           void reload_records()
+           {
+               clear_records();
+               for( auto itr = _records.begin(); itr.valid(); ++itr )
+               {
+                  auto record = itr.value();
+                  try
+                  {
+                     load_generic_record( record );
+                     // prevent hanging on large wallets
+                     fc::usleep( fc::microseconds(1000) );
+                  }
+                  catch (const fc::canceled_exception&)
+                  {
+                     throw;
+                  }
+                  catch ( const fc::exception& e )
+                  {
+                     wlog( "Error loading wallet record:\n${r}\nreason: ${e}", ("e",e.to_detail_string())("r",record) );
+                  }
+               }
+           }
+
+           /**
+            *  Rebuilds the in-memory maps from disk into a scratch wallet_db and swaps them in, without
+            *  yielding, so other fibers never see the wallet empty or partly loaded.
+            */
+           void restore_records()
+           {
+               wallet_db snapshot;
+               for( auto itr = _records.begin(); itr.valid(); ++itr )
+               {
+                  auto record = itr.value();
+                  try
+                  {
+                     snapshot.my->load_generic_record( record );
+                  }
+                  catch ( const fc::exception& e )
+                  {
+                     wlog( "Error loading wallet record:\n${r}\nreason: ${e}", ("e",e.to_detail_string())("r",record) );
+                  }
+               }
+
+               std::swap( self->wallet_master_key, snapshot.wallet_master_key );
+               std::swap( self->accounts, snapshot.accounts );
+               std::swap( self->keys, snapshot.keys );
+               std::swap( self->transactions, snapshot.transactions );
+               std::swap( self->balances, snapshot.balances );
+               std::swap( self->properties, snapshot.properties );
+               std::swap( self->settings, snapshot.settings );
+
+               std::swap( self->btc_to_bts_address, snapshot.btc_to_bts_address );
+               std::swap( self->address_to_account_wallet_record_index, snapshot.address_to_account_wallet_record_index );
+               std::swap( self->account_id_to_wallet_record_index, snapshot.account_id_to_wallet_record_index );
+               std::swap( self->name_to_account_wallet_record_index, snapshot.name_to_account_wallet_record_index );
+           }
+
            void load_generic_record( const generic_wallet_record& record, bool overwrite = true )
            { try {
                switch( wallet_record_type_enum(record.type) )
@@ -156,24 +287,7 @@ namespace bts { namespace wallet {
       try
       {
           my->_records.open( wallet_file, true );
-          for( auto itr = my->_records.begin(); itr.valid(); ++itr )
-          {
-             auto record = itr.value();
-             try
-             {
-                my->load_generic_record( record );
-                // prevent hanging on large wallets
-                fc::usleep( fc::microseconds(1000) );
-             }
-             catch (const fc::canceled_exception&)
-             {
-                throw;
-             }
-             catch ( const fc::exception& e )
-             {
-                wlog( "Error loading wallet record:\n${r}\nreason: ${e}", ("e",e.to_detail_string())("r",record) );
-             }
-          }
+          my->reload_records();
       }
       catch( ... )
       {
@@ -184,24 +298,135 @@ namespace bts { namespace wallet {
 
    void wallet_db::close()
    {
+      if( my->_transaction_depth > 0 && my->_records.is_open() )
+      {
+         wlog( "Closing wallet with an open transaction, committing it" );
+         my->_transaction_depth = 0;
+         try
+         {
+            my->write_pending_records();
+         }
+         catch( const fc::exception& )
+         {
+         }
+      }
+      my->_transaction_depth = 0;
+      my->_transaction_aborted = false;
+      my->_pending_writes.clear();
+
       my->_records.close();
+      my->clear_records();
+   }
 
-      wallet_master_key.reset();
+   bool wallet_db::is_open()const { return my->_records.is_open(); }
 
-      accounts.clear();
-      keys.clear();
-      transactions.clear();
-      balances.clear();
-      properties.clear();
-      settings.clear();
+   void wallet_db::begin_transaction()
+   {
+      FC_ASSERT( is_open() );
+      ++my->_transaction_depth;
+   }
 
-      btc_to_bts_address.clear();
-      address_to_account_wallet_record_index.clear();
-      account_id_to_wallet_record_index.clear();
-      name_to_account_wallet_record_index.clear();
+   void wallet_db::commit_transaction()
+   { try {
+      FC_ASSERT( my->_transaction_depth > 0 );
+      if( --my->_transaction_depth > 0 || !is_open() )
+         return;
+      if( my->_transaction_aborted )
+      {
+         my->_transaction_aborted = false;
+         my->discard_pending_records();
+         FC_THROW( "A nested wallet transaction was aborted, so its enclosing transaction was discarded" );
+      }
+      my->write_pending_records();
+   } FC_CAPTURE_AND_RETHROW() }
+
+   void wallet_db::abort_transaction()
+   { try {
+      FC_ASSERT( my->_transaction_depth > 0 );
+      if( --my->_transaction_depth > 0 )
+      {
+         my->_transaction_aborted = true;
+         return;
+      }
+      my->_transaction_aborted = false;
+      if( is_open() )
+         my->discard_pending_records();
+   } FC_CAPTURE_AND_RETHROW() }
+
+   bool wallet_db::in_transaction()const
+   {
+      return my->_transaction_depth > 0;
    }
 
-   bool wallet_db::is_open()const { return my->_records.is_open(); }
+   namespace {
+      /** packed size of every entry plus a hash or tree node each */
+      template<typename Container>
+      fc::variant_object container_memory_usage( const Container& container, uint64_t& total_bytes )
+      {
+         uint64_t bytes = 0;
+         for( const auto& item : container )
+            bytes += sizeof( typename Container::value_type ) + 4 * sizeof( void* )
+                     + fc::raw::pack_size( item.first ) + fc::raw::pack_size( item.second );
+         total_bytes += bytes;
+         fc::mutable_variant_object usage;
+         usage["entries"] = container.size();
+         usage["bytes"] = bytes;
+         return usage;
+      }
+   }
+
+   fc::variant_object wallet_db::get_memory_usage()const
+   { try {
+      uint64_t total_bytes = 0;
+      fc::mutable_variant_object tables;
+      tables["accounts"] = container_memory_usage( accounts, total_bytes );
+      tables["keys"] = container_memory_usage( keys, total_bytes );
+      tables["transactions"] = container_memory_usage( transactions, total_bytes );
+      tables["balances"] = container_memory_usage( balances, total_bytes );
+      tables["properties"] = container_memory_usage( properties, total_bytes );
+      tables["settings"] = container_memory_usage( settings, total_bytes );
+      tables["address_to_account_wallet_record_index"] = container_memory_usage( address_to_account_wallet_record_index, total_bytes );
+      tables["name_to_account_wallet_record_index"] = container_memory_usage( name_to_account_wallet_record_index, total_bytes );
+      tables["account_id_to_wallet_record_index"] = container_memory_usage( account_id_to_wallet_record_index, total_bytes );
+      tables["btc_to_bts_address"] = container_memory_usage( btc_to_bts_address, total_bytes );
+      tables["id_to_transaction_record_index"] = container_memory_usage( id_to_transaction_record_index, total_bytes );
+      tables["pending_writes"] = container_memory_usage( my->_pending_writes, total_bytes );
+
+      fc::mutable_variant_object result;
+      result["total_bytes"] = total_bytes;
+      result["tables"] = tables;
+      return result;
+   } FC_CAPTURE_AND_RETHROW() }
+
+   wallet_db::transaction_scope::transaction_scope( wallet_db& db )
+   :_db( db )
+   {
+      _db.begin_transaction();
+   }
+
+   wallet_db::transaction_scope::~transaction_scope()
+   {
+      if( _committed ) return;
+      try
+      {
+         // leaving the scope because of an exception means the writes may be half done
+         if( std::uncaught_exception() )
+            _db.abort_transaction();
+         else
+            _db.commit_transaction();
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Failed to close wallet transaction: ${e}", ("e",e.to_detail_string()) );
+      }
+   }
+
+   void wallet_db::transaction_scope::commit()
+   {
+      FC_ASSERT( !_committed );
+      _committed = true;
+      _db.commit_transaction();
+   }
 
    void wallet_db::store_generic_record( const generic_wallet_record& record, bool sync )
    {
@@ -769,9 +994,9 @@ namespace bts { namespace wallet {
        try
        {
 #ifndef BTS_TEST_NETWORK
-           my->_records.remove( index, true ); // Sync
+           my->remove_generic_record( index, true ); // Sync
 #else
-           my->_records.remove( index );
+           my->remove_generic_record( index, false );
 #endif
        }
        catch( const fc::key_not_found_exception& )
@@ -0,0 +1,75 @@
+/**
+ *  Shared plumbing for the standalone benchmarks in this directory: a global allocation counter and
+ *  the option parsing, --help handling and error reporting around each benchmark's main.
+ *
+ *  Each benchmark is built from a single translation unit, so this header replaces the global
+ *  operator new and delete directly; include it from exactly one source file per executable.
+ */
+#pragma once
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+
+/** number of calls to the global operator new since the program started */
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(size_t size)
+{
+  ++allocation_count;
+  if (void* memory = std::malloc(size ? size : 1))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+
+/** an options description with --help already added, for the benchmark to add its own options to */
+inline boost::program_options::options_description benchmark_options()
+{
+  boost::program_options::options_description option_config("Allowed options");
+  option_config.add_options()
+    ("help", "display this help message");
+  return option_config;
+}
+
+/**
+ *  Parses the command line against option_config and runs the benchmark, printing the results it
+ *  returns as JSON.  Prints the option help instead when --help is given.
+ *
+ *  @return the process exit code: 0 on success, 1 if the benchmark threw an fc::exception
+ */
+inline int run_benchmark(int argc, char** argv, const boost::program_options::options_description& option_config,
+                         const std::function<fc::variant_object(const boost::program_options::variables_map&)>& benchmark)
+{
+  try
+  {
+    boost::program_options::variables_map options;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, option_config), options);
+    boost::program_options::notify(options);
+    if (options.count("help"))
+    {
+      std::cout << option_config << "\n";
+      return 0;
+    }
+
+    std::cout << fc::json::to_pretty_string(benchmark(options)) << "\n";
+    return 0;
+  }
+  catch (const fc::exception& e)
+  {
+    std::cerr << e.to_detail_string() << "\n";
+    return 1;
+  }
+}
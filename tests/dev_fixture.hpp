@@ -240,6 +240,40 @@ struct chain_fixture
       bts::blockchain::advance_time( 7 );
    }
 
+   /** produces a block on my_client's own chain without broadcasting it, leaving the other client behind */
+   template<typename T>
+   full_block produce_unbroadcast_block( T my_client )
+   {
+      auto head_num = my_client->get_chain()->get_head_block_num();
+      const auto& delegates = my_client->get_wallet()->get_my_delegates( enabled_delegate_status | active_delegate_status );
+      auto next_block_time = my_client->get_wallet()->get_next_producible_block_timestamp( delegates );
+      FC_ASSERT( next_block_time.valid() );
+      bts::blockchain::advance_time( (int32_t)((*next_block_time - bts::blockchain::now()).count()/1000000) );
+      auto b = my_client->get_chain()->generate_block(*next_block_time);
+      my_client->get_wallet()->sign_block( b );
+      my_client->get_chain()->push_block( b );
+      FC_ASSERT( head_num+1 == my_client->get_chain()->get_head_block_num() );
+      bts::blockchain::advance_time( 7 );
+      return b;
+   }
+
+   /** lets delegate31 (clienta) and delegate30 (clientb) produce blocks */
+   void enable_block_production()
+   {
+      exec( clienta, "wallet_delegate_set_block_production delegate31 true" );
+      exec( clientb, "wallet_delegate_set_block_production delegate30 true" );
+   }
+
+   /** produces rounds of one block on clienta followed by one on clientb */
+   void produce_rounds( uint32_t rounds )
+   {
+      for( uint32_t i = 0; i < rounds; ++i )
+      {
+         produce_block( clienta );
+         produce_block( clientb );
+      }
+   }
+
    void enable_logging()
    {
       fc::configure_logging( fc::logging_config::default_config() );
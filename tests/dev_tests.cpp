@@ -2,6 +2,17 @@
 #include <boost/test/unit_test.hpp>
 #include "dev_fixture.hpp"
 
+#include <bts/blockchain/pending_chain_state.hpp>
+#include <bts/db/level_map.hpp>
+#include <bts/mail/client.hpp>
+#include <bts/mail/exceptions.hpp>
+#include <bts/mail/server.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <sstream>
+
 
 BOOST_FIXTURE_TEST_CASE( basic_commands, chain_fixture )
 { try {
@@ -641,6 +652,541 @@ BOOST_FIXTURE_TEST_CASE( basic_commands, chain_fixture )
    exec(clientb, "history c-account");
 } FC_LOG_AND_RETHROW() }
 
+/** sums the reported bookkeeping drift over every table that reports one */
+static int64_t total_memory_usage_drift( const fc::variant_object& usage )
+{
+   int64_t drift = 0;
+   for( const auto& entry : usage )
+   {
+      if( entry.key() == "drift" )
+         drift += std::abs( entry.value().as_int64() );
+      else if( entry.value().is_object() )
+         drift += total_memory_usage_drift( entry.value().get_object() );
+   }
+   return drift;
+}
+
+BOOST_FIXTURE_TEST_CASE( memory_usage_accounting, chain_fixture )
+{ try {
+   enable_block_production();
+   exec( clienta, "wallet_delegate_set_block_production delegate33 true" );
+   exec( clientb, "wallet_delegate_set_block_production delegate32 true" );
+   exec( clientb, "wallet_account_create b-account" );
+
+   for( uint32_t round = 0; round < 10; ++round )
+   {
+      exec( clienta, "wallet_transfer " + fc::to_string( 10 + round ) + " PTS delegate31 b-account round-" + fc::to_string( round ) );
+      exec( clientb, "wallet_transfer " + fc::to_string( 5 + round ) + " PTS delegate30 delegate33 round-" + fc::to_string( round ) );
+      produce_rounds( 1 );
+
+      for( const auto& client : { clienta, clientb } )
+      {
+         const fc::variant_object usage = client->debug_get_memory_usage( true );
+         BOOST_CHECK( usage["total_bytes"].as_uint64() > 0 );
+         BOOST_CHECK_EQUAL( total_memory_usage_drift( usage ), 0 );
+      }
+   }
+
+   // a registered account shows up in the cached account table at no less than its packed size,
+   // and the pending pool accounts for the registration until it is included in a block
+   const auto chain = clientb->get_chain();
+   const auto table_usage = [&]( const string& table ) -> fc::variant_object
+   {
+      return chain->get_memory_usage( true )["tables"].get_object()[table].get_object();
+   };
+   const fc::variant_object accounts_before = table_usage( "_account_db" );
+   exec( clientb, "wallet_account_register b-account delegate30" );
+   BOOST_CHECK_EQUAL( table_usage( "_pending_transactions" )["entries"].as_uint64(), 1u );
+   BOOST_CHECK( table_usage( "_pending_transactions" )["bytes"].as_uint64() > 0 );
+   produce_rounds( 1 );
+
+   const fc::variant_object accounts_after = table_usage( "_account_db" );
+   const oaccount_record registered = chain->get_account_record( "b-account" );
+   BOOST_REQUIRE( registered.valid() );
+   BOOST_CHECK_EQUAL( accounts_after["entries"].as_uint64(), accounts_before["entries"].as_uint64() + 1 );
+   BOOST_CHECK( accounts_after["bytes"].as_uint64() >= accounts_before["bytes"].as_uint64() + fc::raw::pack_size( *registered ) );
+   BOOST_CHECK_EQUAL( table_usage( "_pending_transactions" )["entries"].as_uint64(), 0u );
+   BOOST_CHECK_EQUAL( table_usage( "_pending_transactions" )["bytes"].as_uint64(), 0u );
+   BOOST_CHECK_EQUAL( total_memory_usage_drift( clientb->debug_get_memory_usage( true ) ), 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( pending_pool_limits, chain_fixture )
+{ try {
+   const auto chain = clienta->get_chain();
+   const auto wallet = clienta->get_wallet();
+   const share_type relay_fee = chain->get_relay_fee();
+   const address recipient( fc::ripemd160::hash( std::string( "pending pool recipient" ) ) );
+
+   double next_amount = 1;
+   const auto make_transfer = [&]( const share_type& fee ) -> signed_transaction
+   {
+      wallet->set_transaction_fee( asset( fee ) );
+      // distinct amounts keep every transaction unique
+      return wallet->transfer_asset_to_address( next_amount++, "PTS", "delegate31", recipient, "", vote_none, true ).trx;
+   };
+   const auto withdrawn_balance = []( const signed_transaction& trx ) -> balance_id_type
+   {
+      for( const operation& op : trx.operations )
+         if( operation_type_enum( op.type ) == withdraw_op_type )
+            return op.as<withdraw_operation>().balance_id;
+      return balance_id_type();
+   };
+   const auto deposited = []( const signed_transaction& trx ) -> share_type
+   {
+      share_type amount = 0;
+      for( const operation& op : trx.operations )
+         if( operation_type_enum( op.type ) == deposit_op_type )
+            amount += op.as<deposit_operation>().amount;
+      return amount;
+   };
+   const auto is_pending = [&]( const signed_transaction& trx ) -> bool
+   {
+      for( const auto& eval_state : chain->get_pending_transactions() )
+         if( eval_state->trx.id() == trx.id() )
+            return true;
+      return false;
+   };
+   std::map<transaction_id_type, share_type> fees_paid;
+   const auto store = [&]( const signed_transaction& trx )
+   {
+      fees_paid[ trx.id() ] = chain->store_pending_transaction( trx, false )->get_fees();
+   };
+   const auto required_relay_fee = [&]() { return chain->get_pending_pool_status()["required_relay_fee"].as_int64(); };
+
+   // room for four transfers and a half
+   vector<signed_transaction> stored;
+   stored.push_back( make_transfer( 2 * relay_fee ) );
+   const uint64_t transfer_size = fc::raw::pack_size( stored.front() );
+   chain->set_pending_pool_limits( 4 * transfer_size + transfer_size / 2, 100 );
+   BOOST_CHECK_EQUAL( required_relay_fee(), relay_fee );
+
+   // the relay fee stays flat until the pool is half full and then rises with it
+   store( stored.back() );
+   stored.push_back( make_transfer( 2 * relay_fee ) );
+   store( stored.back() );
+   BOOST_CHECK_EQUAL( required_relay_fee(), relay_fee );
+   stored.push_back( make_transfer( 2 * relay_fee ) );
+   store( stored.back() );
+   BOOST_CHECK( required_relay_fee() > 2 * relay_fee );
+   BOOST_CHECK_THROW( chain->store_pending_transaction( make_transfer( 2 * relay_fee ), false ), insufficient_relay_fee );
+
+   const signed_transaction high_fee = make_transfer( 5 * relay_fee );
+   store( high_fee );
+   const signed_transaction highest_fee = make_transfer( 10 * relay_fee );
+
+   // an insert at the cap evaluates only the new transaction, and the pending state is rebuilt
+   // once, in one pass over what is left, after this fiber yields
+   const auto evaluation_count = [&]() { return chain->get_pending_pool_status()["evaluation_count"].as_uint64(); };
+   const uint64_t evaluations_before_insert = evaluation_count();
+   store( highest_fee );
+   BOOST_CHECK_EQUAL( evaluation_count() - evaluations_before_insert, 1u );
+   BOOST_CHECK( chain->get_pending_pool_status()["rebuild_pending"].as_bool() );
+   fc::usleep( fc::milliseconds( 10 ) );
+   BOOST_CHECK( !chain->get_pending_pool_status()["rebuild_pending"].as_bool() );
+   BOOST_CHECK_EQUAL( evaluation_count() - evaluations_before_insert, 1u + 4u );
+
+   // overflowing the cap evicts the lowest fee per kilobyte, lowest id first among equals
+   std::pair<int64_t, transaction_id_type> lowest( std::numeric_limits<int64_t>::max(), transaction_id_type() );
+   for( const signed_transaction& trx : stored )
+   {
+      const int64_t fee_per_kb = (fees_paid[ trx.id() ] * 1000) / int64_t( fc::raw::pack_size( trx ) );
+      lowest = std::min( lowest, std::make_pair( fee_per_kb, trx.id() ) );
+   }
+   BOOST_CHECK_EQUAL( chain->get_pending_pool_status()["transaction_count"].as_uint64(), 4u );
+   BOOST_CHECK( chain->get_pending_pool_status()["bytes"].as_uint64() <= 4 * transfer_size + transfer_size / 2 );
+   BOOST_CHECK( is_pending( high_fee ) );
+   BOOST_CHECK( is_pending( highest_fee ) );
+   share_type pending_deposits = deposited( high_fee ) + deposited( highest_fee );
+   for( const signed_transaction& trx : stored )
+   {
+      BOOST_CHECK_EQUAL( is_pending( trx ), trx.id() != lowest.second );
+      if( trx.id() != lowest.second )
+         pending_deposits += deposited( trx );
+   }
+
+   // the evicted transfer is no longer applied to the pending state
+   deposit_operation deposit;
+   for( const operation& op : highest_fee.operations )
+      if( operation_type_enum( op.type ) == deposit_op_type )
+         deposit = op.as<deposit_operation>();
+   const obalance_record pending_balance = chain->get_pending_state()->get_balance_record( deposit.balance_id() );
+   BOOST_REQUIRE( pending_balance.valid() );
+   BOOST_CHECK_EQUAL( pending_balance->balance, pending_deposits );
+
+   // every transfer withdraws from the same balance, so a lower per-sender limit turns the next one away
+   BOOST_REQUIRE( withdrawn_balance( high_fee ) == withdrawn_balance( highest_fee ) );
+   chain->set_pending_pool_limits( 4 * transfer_size + transfer_size / 2, 4 );
+   const signed_transaction over_sender_limit = make_transfer( 20 * relay_fee );
+   BOOST_REQUIRE( withdrawn_balance( over_sender_limit ) == withdrawn_balance( highest_fee ) );
+   BOOST_CHECK_THROW( chain->store_pending_transaction( over_sender_limit, false ), pending_sender_limit );
+   BOOST_CHECK_EQUAL( chain->get_pending_pool_status()["transaction_count"].as_uint64(), 4u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( evaluation_results_keep_their_own_state, chain_fixture )
+{ try {
+   const auto chain = clienta->get_chain();
+   const auto wallet = clienta->get_wallet();
+   const auto deposit_balance = []( const signed_transaction& trx ) -> balance_id_type
+   {
+      for( const operation& op : trx.operations )
+         if( operation_type_enum( op.type ) == deposit_op_type )
+            return op.as<deposit_operation>().balance_id();
+      return balance_id_type();
+   };
+   const signed_transaction first_trx = wallet->transfer_asset_to_address( 1, "PTS", "delegate31",
+                                                                           address( fc::ripemd160::hash( std::string( "first recipient" ) ) ),
+                                                                           "", vote_none, true ).trx;
+   const signed_transaction second_trx = wallet->transfer_asset_to_address( 2, "PTS", "delegate31",
+                                                                            address( fc::ripemd160::hash( std::string( "second recipient" ) ) ),
+                                                                            "", vote_none, true ).trx;
+
+   // holding one result while evaluating another must not disturb the state the first one points at
+   const transaction_evaluation_state_ptr first = chain->evaluate_transaction( first_trx, 0 );
+   const transaction_evaluation_state_ptr second = chain->evaluate_transaction( second_trx, 0 );
+   BOOST_REQUIRE( first->_current_state != second->_current_state );
+   const pending_chain_state* first_state = dynamic_cast<const pending_chain_state*>( first->_current_state );
+   const pending_chain_state* second_state = dynamic_cast<const pending_chain_state*>( second->_current_state );
+   BOOST_REQUIRE( first_state != nullptr && second_state != nullptr );
+   BOOST_CHECK_EQUAL( first_state->balances.count( deposit_balance( first_trx ) ), 1u );
+   BOOST_CHECK_EQUAL( first_state->balances.count( deposit_balance( second_trx ) ), 0u );
+   BOOST_CHECK_EQUAL( second_state->balances.count( deposit_balance( second_trx ) ), 1u );
+   BOOST_CHECK( first->trx.id() == first_trx.id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( delegate_block_index, chain_fixture )
+{ try {
+   enable_block_production();
+   produce_rounds( 5 );
+
+   const auto chain = clienta->get_chain();
+   std::map<account_id_type, std::vector<uint32_t>> produced;
+   for( uint32_t block_num = 1; block_num <= chain->get_head_block_num(); ++block_num )
+   {
+      const oblock_record record = chain->get_block_record( block_num );
+      BOOST_REQUIRE( record.valid() && record->signee_id.valid() );
+      const account_id_type recovered_id = chain->get_delegate_record_for_signee( chain->get_block_header( block_num ).signee() ).id;
+      BOOST_CHECK_EQUAL( *record->signee_id, recovered_id );
+      BOOST_CHECK_EQUAL( chain->get_block_signee( block_num ).id, recovered_id );
+      produced[ recovered_id ].push_back( block_num );
+   }
+
+   for( const auto& item : produced )
+   {
+      const vector<block_record> blocks = chain->get_delegate_produced_blocks( item.first, 0, 1000 );
+      BOOST_REQUIRE_EQUAL( blocks.size(), item.second.size() );
+      for( size_t i = 0; i < blocks.size(); ++i )
+         BOOST_CHECK_EQUAL( blocks[ i ].block_num, item.second[ i ] );
+      BOOST_CHECK_EQUAL( chain->get_delegate_produced_blocks( item.first, item.second.back() + 1, 10 ).size(), 0 );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( delegate_reliability_ranking, chain_fixture )
+{ try {
+   enable_block_production();
+   produce_rounds( 3 );
+
+   const auto chain = clienta->get_chain();
+   const vector<delegate_production_stats> ranking = chain->get_delegates_by_reliability( 0, 1000 );
+   BOOST_REQUIRE( ranking.size() >= 2 );
+   std::set<string> producers;
+   for( size_t i = 0; i < 2; ++i )
+   {
+      producers.insert( ranking[ i ].delegate_name );
+      BOOST_CHECK_EQUAL( ranking[ i ].missed_in_a_row, 0 );
+      BOOST_CHECK_EQUAL( ranking[ i ].reliability.begin()->second, 100. );
+      BOOST_CHECK_EQUAL( ranking[ i ].blocks_produced, 3 );
+   }
+   BOOST_CHECK( producers.count( "delegate30" ) && producers.count( "delegate31" ) );
+
+   for( size_t i = 2; i < ranking.size(); ++i )
+   {
+      BOOST_CHECK( ranking[ i ].reliability.begin()->second < 100. );
+      BOOST_CHECK( ranking[ i ].missed_in_a_row > 0 );
+      BOOST_CHECK( ranking[ i - 1 ].reliability.begin()->second >= ranking[ i ].reliability.begin()->second );
+   }
+
+   // a different set of windows rebuilds the same statistics from the slot records
+   chain->set_delegate_reliability_windows( { 5, 50 } );
+   const vector<delegate_production_stats> rebuilt = chain->get_delegates_by_reliability( 50, 1000 );
+   BOOST_REQUIRE_EQUAL( rebuilt.size(), ranking.size() );
+   for( size_t i = 0; i < rebuilt.size(); ++i )
+      BOOST_CHECK_EQUAL( rebuilt[ i ].missed_in_a_row, ranking[ i ].missed_in_a_row );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( unclaimed_genesis_index, chain_fixture )
+{ try {
+   const auto chain = clienta->get_chain();
+   const auto scan_unclaimed_genesis = [&]() -> asset
+   {
+      asset total;
+      const auto genesis_timestamp = chain->get_genesis_timestamp();
+      chain->scan_balances( [&]( const balance_record& balance )
+      {
+         if( balance.genesis_info.valid() && balance.last_update <= genesis_timestamp )
+            total += balance.get_balance();
+      } );
+      return total;
+   };
+
+   const asset initial_total = chain->unclaimed_genesis();
+   BOOST_CHECK( initial_total.amount > 0 );
+   BOOST_CHECK( initial_total == scan_unclaimed_genesis() );
+
+   enable_block_production();
+   exec( clienta, "wallet_transfer 10 PTS delegate31 delegate30" );
+   produce_rounds( 1 );
+
+   BOOST_CHECK( chain->unclaimed_genesis() < initial_total );
+   BOOST_CHECK( chain->unclaimed_genesis() == scan_unclaimed_genesis() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( balance_indexes_survive_reopen, chain_fixture )
+{ try {
+   enable_block_production();
+   exec( clienta, "wallet_transfer 10 PTS delegate31 delegate30" );
+   produce_rounds( 1 );
+
+   const auto chain = clienta->get_chain();
+   std::map<address, vector<balance_id_type>> owners;
+   chain->scan_balances( [&]( const balance_record& balance )
+   {
+      owners[ balance.owner() ].push_back( balance.id() );
+   } );
+   const asset unclaimed = chain->unclaimed_genesis();
+   BOOST_REQUIRE( !owners.empty() );
+
+   // the owner and unclaimed genesis indexes are stored next to the balances rather than rebuilt from them
+   chain->close();
+   chain->open( clienta_dir.path() / "chain", clienta_dir.path() / "genesis.json" );
+
+   BOOST_CHECK( chain->unclaimed_genesis() == unclaimed );
+   for( auto& item : owners )
+   {
+      vector<balance_id_type> indexed;
+      for( const balance_record& balance : chain->get_balances_for_owner( item.first ) )
+         indexed.push_back( balance.id() );
+      std::sort( indexed.begin(), indexed.end() );
+      std::sort( item.second.begin(), item.second.end() );
+      BOOST_CHECK( indexed == item.second );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( collateral_expiration_index, chain_fixture )
+{ try {
+   const auto chain = clienta->get_chain();
+   const asset_id_type quote_id = 1;
+   const asset_id_type base_id = 0;
+   const time_point_sec now = chain->now();
+   const auto make_key = [&]( double call_price, const string& owner ) -> market_index_key
+   {
+      return market_index_key( price( call_price, quote_id, base_id ), address( fc::ripemd160::hash( owner ) ) );
+   };
+   const auto expired_owners = [&]( const time_point_sec& as_of, uint32_t limit ) -> vector<address>
+   {
+      vector<address> owners;
+      for( const market_order& cover : chain->get_expired_covers( quote_id, base_id, as_of, limit ) )
+         owners.push_back( cover.market_index.owner );
+      return owners;
+   };
+
+   // positions deep in the book by call price still come back in expiration order
+   const market_index_key early = make_key( 5, "early" );
+   const market_index_key middle = make_key( 1, "middle" );
+   const market_index_key late = make_key( 3, "late" );
+   chain->store_collateral_record( early, collateral_record( 100, 50, price(), now + 10 ) );
+   chain->store_collateral_record( middle, collateral_record( 100, 50, price(), now + 20 ) );
+   chain->store_collateral_record( late, collateral_record( 100, 50, price(), now + 30 ) );
+   // a position in another market never shows up, however overdue
+   chain->store_collateral_record( market_index_key( price( 2, quote_id + 1, base_id ), address( fc::ripemd160::hash( string( "other" ) ) ) ),
+                                   collateral_record( 100, 50, price(), now ) );
+
+   BOOST_CHECK( expired_owners( now + 5, 10 ).empty() );
+   BOOST_CHECK( expired_owners( now + 20, 10 ) == vector<address>( { early.owner, middle.owner } ) );
+   BOOST_CHECK( expired_owners( now + 30, 1 ) == vector<address>( { early.owner } ) );
+
+   // moving or closing a position moves or drops its index entry
+   chain->store_collateral_record( early, collateral_record( 100, 50, price(), now + 40 ) );
+   chain->store_collateral_record( middle, collateral_record() );
+   BOOST_CHECK( expired_owners( now + 30, 10 ) == vector<address>( { late.owner } ) );
+
+   // the index is stored next to the collateral table rather than rebuilt from it
+   chain->close();
+   chain->open( clienta_dir.path() / "chain", clienta_dir.path() / "genesis.json" );
+   BOOST_CHECK( expired_owners( now + 40, 10 ) == vector<address>( { late.owner, early.owner } ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( hosted_wallet_sessions, chain_fixture )
+{ try {
+   {
+      bts::wallet::wallet setup( clienta->get_chain() );
+      setup.set_data_directory( clienta->get_wallet()->get_data_directory() );
+      setup.create( "hosted", "hostedpassword" );
+      setup.close();
+   }
+   clienta->wallet_hosted_open( "hosted" );
+   const wallet_ptr hosted = clienta->get_hosted_wallet( "hosted" );
+   BOOST_CHECK( clienta->get_call_wallet() == clienta->get_wallet() );
+   {
+      // commands run from inside the call keep its wallet, while everything else still sees the primary one
+      bts::client::client::wallet_call_scope scope( *clienta, hosted );
+      BOOST_CHECK( clienta->get_call_wallet() == hosted );
+      BOOST_CHECK( clienta->get_wallet() != hosted );
+      exec( clienta, "wallet_unlock 99999999999 hostedpassword" );
+      exec( clienta, "wallet_set_transaction_scanning true" );
+      exec( clienta, "wallet_account_create hosted-account" );
+   }
+   BOOST_CHECK( clienta->get_call_wallet() == clienta->get_wallet() );
+   BOOST_REQUIRE( hosted->is_unlocked() );
+
+   // balances are routed by every address form a key can own them under, including the genesis ones
+   const public_key_type hosted_key = hosted->get_account_public_key( "hosted-account" );
+   const unordered_set<address> key_addresses = hosted->get_key_addresses();
+   BOOST_CHECK( key_addresses.count( address( hosted_key ) ) );
+   BOOST_CHECK( key_addresses.count( address( pts_address( hosted_key, false, 56 ) ) ) );
+   BOOST_CHECK( key_addresses.count( address( pts_address( hosted_key, true, 56 ) ) ) );
+   BOOST_CHECK( key_addresses.count( address( pts_address( hosted_key, false, 0 ) ) ) );
+   BOOST_CHECK( key_addresses.count( address( pts_address( hosted_key, true, 0 ) ) ) );
+
+   // a transfer from the primary wallet is picked up by the shared scan of the new block
+   exec( clienta, "wallet_transfer 100 PTS delegate31 " + std::string( hosted_key ) );
+   produce_block( clienta );
+   BOOST_CHECK( !hosted->is_scanning() );
+   BOOST_CHECK_EQUAL( hosted->get_last_scanned_block_number(), clienta->get_chain()->get_head_block_num() );
+   const auto balances = hosted->get_account_balances( "hosted-account" );
+   BOOST_REQUIRE( balances.count( "hosted-account" ) );
+   BOOST_CHECK_EQUAL( balances.at( "hosted-account" ).at( 0 ), share_type( 100 * BTS_BLOCKCHAIN_PRECISION ) );
+
+   clienta->wallet_hosted_close( "hosted" );
+   BOOST_CHECK_THROW( clienta->get_hosted_wallet( "hosted" ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( batch_commands, chain_fixture )
+{ try {
+   std::stringstream input;
+   input << "get_info\n"
+         << "wallet_lock\n"
+         << "wallet_unlock 99999999999\n"
+         << "{\"id\":\"json\",\"method\":\"wallet_get_info\"}\n"
+         << "execute_script commands.txt\n"
+         << "wallet_unlock 99999999999 masterpassword\n";
+   std::stringstream output;
+   bts::cli::cli batch( clienta.get(), nullptr, &output );
+   batch.set_batch_mode( true );
+   batch.process_batch( &input );
+
+   std::vector<fc::variant_object> responses;
+   std::string line;
+   while( std::getline( output, line ) )
+      responses.push_back( fc::json::from_string( line ).get_object() );
+   BOOST_REQUIRE_EQUAL( responses.size(), 6u );
+
+   // one response per command, in input order
+   const std::vector<fc::variant> ids{ fc::variant( 1 ), fc::variant( 2 ), fc::variant( 3 ),
+                                       fc::variant( "json" ), fc::variant( 5 ), fc::variant( 6 ) };
+   for( size_t i = 0; i < ids.size(); ++i )
+      BOOST_CHECK_EQUAL( fc::json::to_string( responses[i]["id"] ), fc::json::to_string( ids[i] ) );
+
+   BOOST_CHECK( responses[0].contains( "result" ) );
+   BOOST_CHECK( responses[1].contains( "result" ) );
+   // the missing passphrase fails the command instead of being read from the next line
+   BOOST_CHECK( responses[2].contains( "error" ) );
+   BOOST_CHECK( responses[3].contains( "result" ) );
+   BOOST_CHECK( responses[4].contains( "error" ) );
+   BOOST_CHECK( responses[5].contains( "result" ) );
+   BOOST_CHECK( clienta->get_wallet()->is_unlocked() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( switch_to_longer_fork, chain_fixture )
+{ try {
+   enable_block_production();
+   produce_rounds( 2 );
+   const auto chain_a = clienta->get_chain();
+   const auto chain_b = clientb->get_chain();
+   const uint32_t fork_point = chain_a->get_head_block_num();
+   BOOST_REQUIRE_EQUAL( chain_b->get_head_block_num(), fork_point );
+
+   // clientb builds two blocks and clienta one on top of the common head, neither seeing the other's
+   const full_block b1 = produce_unbroadcast_block( clientb );
+   const full_block b2 = produce_unbroadcast_block( clientb );
+   const full_block a1 = produce_unbroadcast_block( clienta );
+   BOOST_REQUIRE( chain_a->get_head_block_id() == a1.id() );
+
+   // the first block of the longer branch is only a side branch
+   chain_a->push_block( b1 );
+   BOOST_CHECK( chain_a->get_head_block_id() == a1.id() );
+
+   // a longer branch that fails to apply switches back, reapplying a1 from the delta cache
+   full_block bad_b2 = b2;
+   bad_b2.previous_secret = secret_hash_type();
+   BOOST_REQUIRE( bad_b2.id() != b2.id() );
+   chain_a->push_block( bad_b2 );
+   BOOST_CHECK( chain_a->get_head_block_id() == a1.id() );
+   BOOST_CHECK( chain_a->is_included_block( a1.id() ) );
+   BOOST_CHECK( chain_a->get_address_filter( a1.id() ).valid() );
+
+   // the second valid block makes the other branch the longest, reapplying b1 from the delta cache
+   const block_fork_data fork_data = chain_a->push_block( b2 );
+   BOOST_CHECK( fork_data.is_included );
+   BOOST_CHECK( chain_a->get_head_block_id() == b2.id() );
+   BOOST_CHECK_EQUAL( chain_a->get_head_block_num(), fork_point + 2 );
+   BOOST_CHECK( chain_a->get_block_id( fork_point + 1 ) == b1.id() );
+   BOOST_CHECK( !chain_a->is_included_block( a1.id() ) );
+   BOOST_CHECK( chain_a->get_address_filter( b1.id() ).valid() );
+   BOOST_CHECK( chain_a->get_address_filter( b2.id() ).valid() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( compact_block_reconstruction, chain_fixture )
+{ try {
+   enable_block_production();
+   produce_rounds( 1 );
+   const auto chain_b = clientb->get_chain();
+   const auto make_compact_block = []( const full_block& block ) -> bts::client::compact_block_message
+   {
+      const bts::net::message block_message( bts::client::block_message( block ) );
+      return bts::client::compact_block_message( block, block_message.id(), 42,
+                                                 []( const signed_transaction& ){ return false; } );
+   };
+
+   // every transaction is in clientb's pending pool, so the block is rebuilt without a round trip
+   exec( clienta, "wallet_transfer 10 PTS delegate31 delegate30" );
+   const full_block complete_block = produce_unbroadcast_block( clienta );
+   BOOST_REQUIRE_EQUAL( complete_block.user_transactions.size(), 1u );
+   const bts::net::compact_block_result complete_result = clientb->handle_compact_block( make_compact_block( complete_block ) );
+   BOOST_CHECK( complete_result.missing_transaction_indexes.empty() );
+   BOOST_CHECK( chain_b->get_head_block_id() == complete_block.id() );
+
+   // a transaction only clienta has is reported missing and completes the block once it is fetched
+   exec( clienta, "wallet_transfer 20 PTS delegate31 delegate30" );
+   const public_key_type recipient = fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "compact recipient" ) ) ).get_public_key();
+   const wallet_transaction_record unrelayed = clienta->get_wallet()->transfer_asset_to_address( 30, "PTS", "delegate31", address( recipient ),
+                                                                                                  "", vote_none, true );
+   clienta->get_chain()->store_pending_transaction( unrelayed.trx, true );
+   const full_block partial_block = produce_unbroadcast_block( clienta );
+   BOOST_REQUIRE_EQUAL( partial_block.user_transactions.size(), 2u );
+   const uint16_t unrelayed_index = partial_block.user_transactions[0].id() == unrelayed.trx.id() ? 0 : 1;
+   BOOST_REQUIRE( partial_block.user_transactions[unrelayed_index].id() == unrelayed.trx.id() );
+
+   const bts::net::compact_block_result partial_result = clientb->handle_compact_block( make_compact_block( partial_block ) );
+   BOOST_REQUIRE_EQUAL( partial_result.missing_transaction_indexes.size(), 1u );
+   BOOST_CHECK_EQUAL( partial_result.missing_transaction_indexes.front(), unrelayed_index );
+   BOOST_CHECK( chain_b->get_head_block_id() == complete_block.id() );
+
+   // transactions that don't fill the gaps are rejected instead of being pushed
+   const bts::client::compact_block_transactions_message wrong_transactions( partial_block.id(),
+                                                                              { partial_block.user_transactions[1 - unrelayed_index] } );
+   BOOST_CHECK_THROW( clientb->handle_compact_block( wrong_transactions ), fc::exception );
+
+   BOOST_REQUIRE( clientb->handle_compact_block( make_compact_block( partial_block ) ).missing_transaction_indexes.size() == 1 );
+   const bts::client::compact_block_transactions_message fetched_transactions( partial_block.id(),
+                                                                                { partial_block.user_transactions[unrelayed_index] } );
+   BOOST_CHECK( clientb->handle_compact_block( fetched_transactions ).missing_transaction_indexes.empty() );
+   BOOST_CHECK( chain_b->get_head_block_id() == partial_block.id() );
+
+   // a compact block stands in for the block message its receiver requested
+   BOOST_CHECK( make_compact_block( partial_block ).block_message_id ==
+                bts::net::message( bts::client::block_message( partial_block ) ).id() );
+} FC_LOG_AND_RETHROW() }
+
 #if 0
 BOOST_FIXTURE_TEST_CASE( malicious_trading, chain_fixture )
 { try {
@@ -725,6 +1271,709 @@ BOOST_FIXTURE_TEST_CASE( malicious_trading, chain_fixture )
 } FC_LOG_AND_RETHROW() }
 #endif
 
+/** delivers replication straight to another mail server in the same process */
+class local_replication_peer : public bts::mail::replication_peer
+{
+public:
+   local_replication_peer( const bts::mail::mail_server_ptr& server ) : _server( server ) {}
+
+   virtual vector<bts::mail::message_id_type> announce_inventory( const vector<bts::mail::message_id_type>& inventory_ids ) override
+   {
+      return _server->announce_inventory( inventory_ids );
+   }
+   virtual void store_replicated( const vector<bts::mail::message>& messages ) override
+   {
+      _server->store_replicated( messages );
+   }
+
+private:
+   bts::mail::mail_server_ptr _server;
+};
+
+static bts::mail::message make_mail_message( const address& recipient, char fill,
+                                             const fc::time_point_sec& timestamp = bts::blockchain::now() )
+{
+   bts::mail::message msg;
+   msg.type = bts::mail::encrypted;
+   msg.recipient = recipient;
+   msg.timestamp = timestamp;
+   msg.data = vector<char>( 64, fill );
+   while( msg.id() > BTS_MAIL_PROOF_OF_WORK_TARGET )
+      ++msg.nonce;
+   return msg;
+}
+
+BOOST_AUTO_TEST_CASE( mail_server_replication )
+{ try {
+   // three servers in a line: a <-> b <-> c
+   vector<fc::temp_directory> dirs( 3 );
+   vector<bts::mail::mail_server_ptr> servers;
+   for( auto& dir : dirs )
+   {
+      servers.push_back( std::make_shared<bts::mail::server>() );
+      servers.back()->open( dir.path() );
+   }
+   const auto link = [&]( size_t from, size_t to )
+   {
+      servers[ from ]->add_replication_peer( std::make_shared<local_replication_peer>( servers[ to ] ) );
+   };
+   link( 0, 1 ); link( 1, 0 );
+   link( 1, 2 ); link( 2, 1 );
+
+   const address recipient( fc::ripemd160::hash( std::string( "mail recipient" ) ) );
+   vector<bts::mail::message> messages;
+   vector<bts::mail::message_id_type> ids;
+   for( size_t i = 0; i < 10; ++i )
+   {
+      // clients upload each message to a single server, alternating between the two ends
+      messages.push_back( make_mail_message( recipient, char( 'a' + i ) ) );
+      servers[ i % 2 == 0 ? 0 : 2 ]->store( messages.back() );
+      ids.push_back( messages.back().id() );
+   }
+
+   const auto converged = [&]() -> bool
+   {
+      for( const auto& server : servers )
+         if( server->fetch_inventory( recipient, fc::time_point() ).size() != ids.size() )
+            return false;
+      return true;
+   };
+   for( uint32_t i = 0; i < 500 && !converged(); ++i )
+      fc::usleep( fc::milliseconds( 10 ) );
+   BOOST_REQUIRE( converged() );
+
+   for( const auto& server : servers )
+   {
+      BOOST_CHECK( server->announce_inventory( ids ).empty() );
+      for( const auto& id : ids )
+         BOOST_CHECK( server->fetch_message( id ).id() == id );
+   }
+
+   // a replicated copy still counts as stored for uploads
+   BOOST_CHECK_THROW( servers[ 1 ]->store( messages.front() ), bts::mail::message_already_stored );
+
+   for( const auto& server : servers )
+      server->close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( wallet_db_transaction_scope )
+{ try {
+   fc::temp_directory dir;
+   const fc::path wallet_file = dir.path() / "wallet";
+   {
+      wallet_db db;
+      db.open( wallet_file );
+      db.set_property( automatic_backups, fc::variant( true ) );
+
+      // leaving a scope by an exception undoes its writes in memory and never reaches the disk
+      try
+      {
+         wallet_db::transaction_scope scope( db );
+         db.set_property( automatic_backups, fc::variant( false ) );
+         db.set_property( transaction_expiration_sec, fc::variant( 5 ) );
+         BOOST_CHECK( !db.get_property( automatic_backups ).as_bool() );
+         FC_THROW( "scan interrupted" );
+      }
+      catch( const fc::exception& )
+      {
+      }
+      BOOST_CHECK( !db.in_transaction() );
+      BOOST_CHECK( db.get_property( automatic_backups ).as_bool() );
+      BOOST_CHECK( db.get_property( transaction_expiration_sec ).is_null() );
+
+      // an aborted inner scope discards the outer one as well
+      try
+      {
+         wallet_db::transaction_scope outer( db );
+         db.set_property( transaction_expiration_sec, fc::variant( 6 ) );
+         try
+         {
+            wallet_db::transaction_scope inner( db );
+            db.set_property( automatic_backups, fc::variant( false ) );
+            FC_THROW( "inner failure" );
+         }
+         catch( const fc::exception& )
+         {
+         }
+         BOOST_CHECK_THROW( outer.commit(), fc::exception );
+      }
+      catch( const fc::exception& )
+      {
+      }
+      BOOST_CHECK( !db.in_transaction() );
+      BOOST_CHECK( db.get_property( transaction_expiration_sec ).is_null() );
+
+      // an abort restores the wallet without yielding, so other fibers never see it partly loaded
+      db.set_property( transaction_expiration_sec, fc::variant( 8 ) );
+      bool saw_partial_wallet = false;
+      fc::future<void> observer = fc::async( [&]()
+      {
+         saw_partial_wallet = db.get_property( automatic_backups ).is_null()
+                              || db.get_property( transaction_expiration_sec ).is_null();
+      }, "wallet_db_observer" );
+      try
+      {
+         wallet_db::transaction_scope scope( db );
+         db.set_property( automatic_backups, fc::variant( false ) );
+         FC_THROW( "scan interrupted" );
+      }
+      catch( const fc::exception& )
+      {
+      }
+      observer.wait();
+      BOOST_CHECK( !saw_partial_wallet );
+      BOOST_CHECK( db.get_property( automatic_backups ).as_bool() );
+
+      {
+         wallet_db::transaction_scope scope( db );
+         db.set_property( transaction_expiration_sec, fc::variant( 7 ) );
+      }
+      db.close();
+   }
+
+   wallet_db db;
+   db.open( wallet_file );
+   BOOST_CHECK( db.get_property( automatic_backups ).as_bool() );
+   BOOST_CHECK_EQUAL( db.get_property( transaction_expiration_sec ).as_int64(), 7 );
+   db.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( mail_server_replicated_message_age )
+{ try {
+   fc::temp_directory dir;
+   const auto server = std::make_shared<bts::mail::server>();
+   server->open( dir.path() );
+
+   const address recipient( fc::ripemd160::hash( std::string( "mail recipient" ) ) );
+   const fc::time_point_sec now = bts::blockchain::now();
+   // too old to upload, but young enough to have waited in a replication queue
+   const bts::mail::message delayed = make_mail_message( recipient, 'd', now - fc::hours( 1 ) );
+   const bts::mail::message stale = make_mail_message( recipient, 's', now - BTS_MAIL_MAX_REPLICATED_MESSAGE_AGE - fc::hours( 1 ) );
+
+   BOOST_CHECK_THROW( server->store( delayed ), bts::mail::timestamp_too_old );
+   server->store_replicated( vector<bts::mail::message>{ delayed, stale } );
+
+   const vector<bts::mail::message_id_type> missing = server->announce_inventory( { delayed.id(), stale.id() } );
+   BOOST_REQUIRE_EQUAL( missing.size(), 1 );
+   BOOST_CHECK( missing.front() == stale.id() );
+   BOOST_CHECK_EQUAL( server->fetch_inventory( recipient, fc::time_point() ).size(), 1 );
+
+   server->close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( mail_inventory_paging )
+{ try {
+   fc::temp_directory dir;
+   const auto server = std::make_shared<bts::mail::server>();
+   server->open( dir.path() );
+
+   // more messages than fit in a page, all uploaded with the same timestamp
+   const address recipient( fc::ripemd160::hash( std::string( "mail recipient" ) ) );
+   const fc::time_point_sec timestamp = bts::blockchain::now();
+   std::set<bts::mail::message_id_type> stored;
+   for( size_t i = 0; i < 25; ++i )
+   {
+      const bts::mail::message msg = make_mail_message( recipient, char( 'a' + i ), timestamp );
+      server->store( msg );
+      stored.insert( msg.id() );
+   }
+
+   const auto fetch_page = [&]( const fc::time_point& start, uint32_t limit )
+   {
+      return server->fetch_inventory( recipient, start, limit );
+   };
+   vector<bts::mail::message_id_type> received;
+   uint32_t pages = 0;
+   bts::mail::page_inventory( fc::time_point(), 10, fetch_page, [&]( const bts::mail::inventory_type& page )
+   {
+      ++pages;
+      for( const auto& entry : page )
+         received.push_back( entry.second );
+   } );
+   BOOST_CHECK_EQUAL( pages, 3 );
+   BOOST_CHECK_EQUAL( received.size(), stored.size() );
+   BOOST_CHECK( std::set<bts::mail::message_id_type>( received.begin(), received.end() ) == stored );
+
+   // a server that only honours whole seconds keeps returning the start of the second; every message
+   // must still come back, once
+   const auto rounding_fetch_page = [&]( const fc::time_point& start, uint32_t limit )
+   {
+      return server->fetch_inventory( recipient, fc::time_point( fc::time_point_sec( start ) ), limit );
+   };
+   received.clear();
+   bts::mail::page_inventory( fc::time_point(), 10, rounding_fetch_page, [&]( const bts::mail::inventory_type& page )
+   {
+      for( const auto& entry : page )
+         received.push_back( entry.second );
+   } );
+   BOOST_CHECK_EQUAL( received.size(), stored.size() );
+   BOOST_CHECK( std::set<bts::mail::message_id_type>( received.begin(), received.end() ) == stored );
+
+   // entries sharing a timestamp across a page boundary are neither skipped nor repeated
+   const fc::time_point shared_time = fc::time_point::now();
+   bts::mail::inventory_type shared_inventory;
+   for( uint32_t i = 0; i < 7; ++i )
+      shared_inventory.push_back( std::make_pair( shared_time, bts::mail::message_id_type( fc::ripemd160::hash( std::to_string( i ) ) ) ) );
+   const auto shared_fetch_page = [&]( const fc::time_point& start, uint32_t limit )
+   {
+      bts::mail::inventory_type page;
+      for( const auto& entry : shared_inventory )
+         if( entry.first >= start && page.size() < limit )
+            page.push_back( entry );
+      return page;
+   };
+   received.clear();
+   bts::mail::page_inventory( fc::time_point(), 3, shared_fetch_page, [&]( const bts::mail::inventory_type& page )
+   {
+      for( const auto& entry : page )
+         received.push_back( entry.second );
+   } );
+   BOOST_CHECK_EQUAL( received.size(), shared_inventory.size() );
+   BOOST_CHECK_EQUAL( std::set<bts::mail::message_id_type>( received.begin(), received.end() ).size(), shared_inventory.size() );
+
+   server->close();
+} FC_LOG_AND_RETHROW() }
+
+/** the layout the mail client stores its archive in, written directly to build a version 1 database */
+struct test_mail_archive_record
+{
+   fc::ripemd160                        id;
+   bts::mail::client::mail_status       status;
+   string                               sender;
+   string                               recipient;
+   address                              recipient_address;
+   bts::mail::message                   content;
+   bts::mail::mail_server_list          mail_servers;
+};
+FC_REFLECT( test_mail_archive_record, (id)(status)(sender)(recipient)(recipient_address)(content)(mail_servers) )
+
+BOOST_AUTO_TEST_CASE( mail_archive_index_migration_and_paging )
+{ try {
+   fc::temp_directory dir;
+   const fc::time_point_sec timestamp = bts::blockchain::now();
+   const address bob_address( fc::ripemd160::hash( std::string( "bob" ) ) );
+   const address alice_address( fc::ripemd160::hash( std::string( "alice" ) ) );
+
+   // a version 1 database only has the archive; its indexes were rebuilt in memory on every open
+   {
+      bts::db::level_map<bts::mail::message_id_type, test_mail_archive_record> archive;
+      bts::db::level_map<string, fc::variant> properties;
+      archive.open( dir.path() / "archive" );
+      properties.open( dir.path() / "properties" );
+      properties.store( "version", 1 );
+
+      // 25 messages from alice to bob sharing one timestamp, and 5 replies a second later
+      for( size_t i = 0; i < 30; ++i )
+      {
+         bts::mail::signed_email_message email;
+         email.subject = "message " + fc::to_string( uint64_t( i ) );
+         test_mail_archive_record record;
+         record.content = bts::mail::message( email );
+         record.content.timestamp = i < 25 ? timestamp : timestamp + 1;
+         record.id = record.content.id();
+         record.status = bts::mail::client::received;
+         record.sender = i < 25 ? "alice" : "bob";
+         record.recipient = i < 25 ? "bob" : "alice";
+         record.recipient_address = i < 25 ? bob_address : alice_address;
+         archive.store( record.id, record );
+      }
+      archive.close();
+      properties.close();
+   }
+
+   auto mail = std::make_shared<bts::mail::client>( nullptr, nullptr );
+   mail->open( dir.path() );
+
+   BOOST_CHECK_EQUAL( mail->get_messages_by_sender( "alice", fc::time_point_sec(), 1000 ).size(), 25 );
+   BOOST_CHECK_EQUAL( mail->get_messages_by_recipient( "bob", fc::time_point_sec(), 1000 ).size(), 25 );
+   BOOST_CHECK_EQUAL( mail->get_messages_from_to( "bob", "alice", fc::time_point_sec(), 1000 ).size(), 5 );
+   BOOST_CHECK_EQUAL( mail->get_messages_in_conversation( "bob", "alice", fc::time_point_sec(), 1000 ).size(), 30 );
+   BOOST_CHECK_EQUAL( mail->get_messages_by_sender( "alice", timestamp + 1, 1000 ).size(), 0 );
+
+   // page through the conversation, resuming after the last header of each page
+   vector<bts::mail::email_header> received;
+   fc::time_point_sec start_time;
+   bts::mail::message_id_type start_after;
+   uint32_t pages = 0;
+   while( true )
+   {
+      const auto page = mail->get_messages_in_conversation( "alice", "bob", start_time, 10, start_after );
+      if( page.empty() ) break;
+      BOOST_REQUIRE( ++pages <= 3 );
+      received.insert( received.end(), page.begin(), page.end() );
+      start_time = page.back().timestamp;
+      start_after = page.back().id;
+   }
+   BOOST_CHECK_EQUAL( pages, 3 );
+   BOOST_REQUIRE_EQUAL( received.size(), 30 );
+   std::set<bts::mail::message_id_type> ids;
+   for( size_t i = 0; i < received.size(); ++i )
+   {
+      ids.insert( received[ i ].id );
+      if( i > 0 )
+         BOOST_CHECK( std::tie( received[ i - 1 ].timestamp, received[ i - 1 ].id ) <
+                      std::tie( received[ i ].timestamp, received[ i ].id ) );
+   }
+   BOOST_CHECK_EQUAL( ids.size(), 30 );
+
+   // removal drops the message from every index
+   mail->remove_message( received.front().id );
+   BOOST_CHECK_EQUAL( mail->get_messages_by_sender( "alice", fc::time_point_sec(), 1000 ).size(), 24 );
+   BOOST_CHECK_EQUAL( mail->get_messages_by_recipient( "bob", fc::time_point_sec(), 1000 ).size(), 24 );
+   BOOST_CHECK_EQUAL( mail->get_messages_in_conversation( "alice", "bob", fc::time_point_sec(), 1000 ).size(), 29 );
+   mail.reset();
+
+   bts::db::level_map<string, fc::variant> properties;
+   properties.open( dir.path() / "properties" );
+   BOOST_CHECK_EQUAL( properties.fetch( "version" ).as_int64(), 2 );
+   properties.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( transaction_precheck_on_worker_thread )
+{ try {
+   signed_transaction trx;
+   trx.expiration = fc::time_point_sec( 1000000 );
+   const digest_type chain_id = fc::sha256::hash( std::string( "precheck chain" ) );
+
+   // the id and size come back with the result, computed where the precheck ran
+   fc::thread worker( "precheck_test" );
+   const fc::time_point_sec now = trx.expiration - 60;
+   const transaction_precheck result = worker.async( [&]() { return transaction_evaluation_state::precheck( trx, chain_id, now ); },
+                                                     "transaction_precheck" ).wait();
+   BOOST_CHECK( result.id == trx.id() );
+   BOOST_CHECK_EQUAL( result.size, uint32_t( fc::raw::pack_size( trx ) ) );
+   BOOST_CHECK( result.signed_keys.empty() );
+
+   // expiration is checked against the time the caller passed in
+   BOOST_CHECK_THROW( transaction_evaluation_state::precheck( trx, chain_id, trx.expiration ), expired_transaction );
+   BOOST_CHECK_THROW( transaction_evaluation_state::precheck( trx, chain_id, trx.expiration - BTS_BLOCKCHAIN_MAX_TRANSACTION_EXPIRATION_SEC - 1 ),
+                      invalid_transaction_expiration );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( pending_state_reset_drops_property_cache )
+{ try {
+   const pending_chain_state_ptr base_state = std::make_shared<pending_chain_state>();
+   base_state->set_active_delegates( vector<account_id_type>{ 3 } );
+
+   // a reused overlay must not answer from decoded properties cached for the previous transaction
+   const pending_chain_state_ptr overlay = std::make_shared<pending_chain_state>( base_state );
+   overlay->set_active_delegates( vector<account_id_type>{ 1, 2 } );
+   BOOST_CHECK( overlay->is_active_delegate( 1 ) );
+
+   overlay->reset( base_state );
+   BOOST_CHECK( overlay->get_active_delegates() == vector<account_id_type>{ 3 } );
+   BOOST_CHECK( !overlay->is_active_delegate( 1 ) );
+   BOOST_CHECK( overlay->is_active_delegate( 3 ) );
+
+   overlay->set_active_delegates( vector<account_id_type>{ 4 } );
+   BOOST_CHECK( overlay->get_active_delegates() == vector<account_id_type>{ 4 } );
+   BOOST_CHECK( base_state->get_active_delegates() == vector<account_id_type>{ 3 } );
+} FC_LOG_AND_RETHROW() }
+
+/** just enough of a client for two p2p nodes to complete their handshake */
+class relay_test_delegate : public bts::net::node_delegate
+{
+public:
+   virtual bool has_item( const bts::net::item_id& id ) override { return false; }
+   virtual bool handle_message( const bts::net::message& message_to_handle, bool sync_mode ) override { return false; }
+   virtual bts::net::compact_block_result handle_compact_block( const bts::net::message& message_to_handle ) override
+   {
+      return bts::net::compact_block_result();
+   }
+   virtual std::vector<bts::net::item_hash_t> get_item_ids( uint32_t item_type,
+                                                            const std::vector<bts::net::item_hash_t>& blockchain_synopsis,
+                                                            uint32_t& remaining_item_count,
+                                                            uint32_t limit = 2000 ) override
+   {
+      remaining_item_count = 0;
+      return std::vector<bts::net::item_hash_t>();
+   }
+   virtual bts::net::message get_item( const bts::net::item_id& id ) override
+   {
+      FC_THROW_EXCEPTION( fc::key_not_found_exception, "test nodes don't serve items" );
+   }
+   virtual fc::sha256 get_chain_id() const override { return fc::sha256(); }
+   virtual std::vector<bts::net::item_hash_t> get_blockchain_synopsis( uint32_t item_type,
+                                                                       const bts::net::item_hash_t& reference_point = bts::net::item_hash_t(),
+                                                                       uint32_t number_of_blocks_after_reference_point = 0 ) override
+   {
+      return std::vector<bts::net::item_hash_t>();
+   }
+   virtual void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+   virtual void connection_count_changed( uint32_t c ) override {}
+   virtual uint32_t get_block_number( const bts::net::item_hash_t& block_id ) override { return 0; }
+   virtual fc::time_point_sec get_block_time( const bts::net::item_hash_t& block_id ) override { return fc::time_point_sec::min(); }
+   virtual fc::time_point_sec get_blockchain_now() override { return fc::time_point::now(); }
+   virtual bts::net::item_hash_t get_head_block_id() const override { return bts::net::item_hash_t(); }
+   virtual uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t unix_timestamp ) const override { return 0; }
+   virtual void error_encountered( const std::string& message, const fc::oexception& error ) override {}
+};
+
+/** a p2p node on the loopback interface that takes part in the delegate relay overlay */
+struct relay_test_node
+{
+   relay_test_node() : node( std::make_shared<bts::net::node>( "relay_test" ) )
+   {
+      node->load_configuration( dir.path() );
+      node->set_node_delegate( &delegate );
+      node->listen_on_port( 0, false );
+      node->set_delegate_relay_enabled( true );
+      node->listen_to_p2p_network();
+      node->sync_from( bts::net::item_id( bts::client::block_message_type, bts::net::item_hash_t() ), std::vector<uint32_t>() );
+      node->connect_to_p2p_network();
+   }
+   ~relay_test_node() { node->close(); }
+
+   fc::ip::endpoint endpoint()const
+   {
+      return fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), node->get_actual_listening_endpoint().port() );
+   }
+
+   fc::temp_directory       dir;
+   relay_test_delegate      delegate;
+   bts::net::node_ptr       node;
+};
+
+BOOST_AUTO_TEST_CASE( delegate_relay_requires_configured_peer )
+{ try {
+   relay_test_node hub;
+   relay_test_node listed;
+   relay_test_node unlisted;
+
+   // both peers advertise the relay in their hello, but the hub was only configured with one of them
+   hub.node->add_delegate_relay_peer( listed.endpoint() );
+   hub.node->connect_to( listed.endpoint() );
+   unlisted.node->connect_to( hub.endpoint() );
+   for( uint32_t i = 0; i < 500 && hub.node->get_connection_count() < 2; ++i )
+      fc::usleep( fc::milliseconds( 10 ) );
+   BOOST_REQUIRE_EQUAL( hub.node->get_connection_count(), 2 );
+
+   const fc::variant_object status = hub.node->get_delegate_relay_status();
+   BOOST_CHECK_EQUAL( status["connected_peer_count"].as_uint64(), 1 );
+   const vector<fc::variant_object> relay_peers = status["peers"].as<vector<fc::variant_object>>();
+   BOOST_REQUIRE_EQUAL( relay_peers.size(), 1 );
+   BOOST_CHECK( relay_peers.front()["endpoint"].as<fc::ip::endpoint>() == listed.endpoint() );
+
+   // the unlisted peer is an ordinary peer to the hub, and the hub is one to it
+   BOOST_CHECK_EQUAL( unlisted.node->get_delegate_relay_status()["connected_peer_count"].as_uint64(), 0 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( delegate_relay_push_counts_as_delivery )
+{ try {
+   relay_test_node hub;
+   relay_test_node relay;
+   hub.node->add_delegate_relay_peer( relay.endpoint() );
+   hub.node->connect_to( relay.endpoint() );
+   for( uint32_t i = 0; i < 500 && hub.node->get_delegate_relay_status()["connected_peer_count"].as_uint64() < 1; ++i )
+      fc::usleep( fc::milliseconds( 10 ) );
+   BOOST_REQUIRE_EQUAL( hub.node->get_delegate_relay_status()["connected_peer_count"].as_uint64(), 1 );
+
+   // blocks are only pushed once the relay peer is in sync with the hub, so keep producing until one is
+   full_block block;
+   for( uint32_t attempt = 0; ; ++attempt )
+   {
+      BOOST_REQUIRE( attempt < 500 );
+      block.block_num = attempt + 1;
+      const uint64_t pushed_before = hub.node->get_delegate_relay_status()["blocks_pushed"].as_uint64();
+      hub.node->broadcast( bts::client::block_message( block ) );
+      if( hub.node->get_delegate_relay_status()["blocks_pushed"].as_uint64() > pushed_before )
+         break;
+      fc::usleep( fc::milliseconds( 10 ) );
+   }
+
+   // the push is the relay peer's copy, so the block counts as delivered to it before it replies
+   const fc::optional<bts::net::block_delivery_data> delivery = hub.node->get_block_delivery_data( block.id() );
+   BOOST_REQUIRE( delivery.valid() );
+   BOOST_CHECK( delivery->first_peer_send_time.valid() );
+   BOOST_CHECK_EQUAL( delivery->peer_acknowledgement_times.size(), 1u );
+
+   // the relay peer advertising it back later is still one acknowledgement
+   fc::usleep( fc::milliseconds( 200 ) );
+   BOOST_CHECK_EQUAL( hub.node->get_block_delivery_data( block.id() )->peer_acknowledgement_times.size(), 1u );
+} FC_LOG_AND_RETHROW() }
+
+/** records the virtual time at which each message first reached a simulated node */
+class link_model_test_delegate : public relay_test_delegate
+{
+public:
+   link_model_test_delegate( bts::net::simulated_network& network ) : _network( network ) {}
+
+   virtual bool handle_message( const bts::net::message& message_to_handle, bool sync_mode ) override
+   {
+      receive_times.insert( std::make_pair( message_to_handle.id(), _network.get_virtual_time() ) );
+      return false;
+   }
+
+   std::map<bts::net::message_hash_type, fc::time_point> receive_times;
+
+private:
+   bts::net::simulated_network& _network;
+};
+
+static bts::net::message link_model_test_message( uint32_t data_size, char fill )
+{
+   bts::net::message item;
+   item.msg_type = bts::client::block_message_type;
+   item.data.assign( data_size, fill );
+   item.size = data_size;
+   return item;
+}
+
+/** which of a run of messages survive a lossy link, for a given seed */
+static vector<bool> link_model_deliveries( uint64_t seed, uint32_t message_count )
+{
+   bts::net::simulated_network network( "link_model_test" );
+   link_model_test_delegate sender( network );
+   link_model_test_delegate receiver( network );
+   network.add_node_delegate( &sender );
+   network.add_node_delegate( &receiver );
+   network.set_random_seed( seed );
+   bts::net::simulated_link_parameters parameters;
+   parameters.packet_loss_rate = 0.5;
+   network.set_default_link_parameters( parameters );
+
+   vector<bts::net::message_hash_type> ids;
+   for( uint32_t i = 0; i < message_count; ++i )
+   {
+      const bts::net::message item = link_model_test_message( 16, char( i ) );
+      ids.push_back( item.id() );
+      network.broadcast_from( 0, item );
+   }
+   network.run_until_idle();
+
+   vector<bool> delivered;
+   for( const bts::net::message_hash_type& id : ids )
+      delivered.push_back( receiver.receive_times.count( id ) > 0 );
+   BOOST_CHECK_EQUAL( network.get_statistics()["messages_lost"].as_uint64(),
+                      (uint64_t)std::count( delivered.begin(), delivered.end(), false ) );
+   return delivered;
+}
+
+BOOST_AUTO_TEST_CASE( simulated_network_link_model )
+{ try {
+   // latency and bandwidth: a link transmits one message at a time, then each arrives after the latency
+   {
+      bts::net::simulated_network network( "link_model_test" );
+      link_model_test_delegate sender( network );
+      link_model_test_delegate receiver( network );
+      network.add_node_delegate( &sender );
+      network.add_node_delegate( &receiver );
+      bts::net::simulated_link_parameters parameters;
+      parameters.latency = fc::milliseconds( 100 );
+      parameters.bandwidth_bytes_per_second = 1000;
+      network.set_default_link_parameters( parameters );
+
+      // with the header each message is 1000 bytes, one second on the wire
+      const uint32_t data_size = 1000 - sizeof( bts::net::message_header );
+      const bts::net::message first = link_model_test_message( data_size, 'a' );
+      const bts::net::message second = link_model_test_message( data_size, 'b' );
+      const fc::time_point start_time = network.get_virtual_time();
+      network.broadcast_from( 0, first );
+      network.broadcast_from( 0, second );
+      BOOST_CHECK_EQUAL( network.get_number_of_pending_deliveries(), 2u );
+
+      network.advance_virtual_time( fc::milliseconds( 1099 ) );
+      BOOST_CHECK( receiver.receive_times.empty() );
+      network.advance_virtual_time( fc::milliseconds( 1 ) );
+      BOOST_REQUIRE_EQUAL( receiver.receive_times.count( first.id() ), 1u );
+      BOOST_CHECK( receiver.receive_times[ first.id() ] == start_time + fc::milliseconds( 1100 ) );
+      BOOST_CHECK_EQUAL( receiver.receive_times.count( second.id() ), 0u );
+
+      network.run_until_idle();
+      BOOST_CHECK_EQUAL( network.get_number_of_pending_deliveries(), 0u );
+      BOOST_REQUIRE_EQUAL( receiver.receive_times.count( second.id() ), 1u );
+      BOOST_CHECK( receiver.receive_times[ second.id() ] == start_time + fc::milliseconds( 2100 ) );
+      BOOST_CHECK( sender.receive_times.empty() );
+
+      const fc::variant_object statistics = network.get_statistics();
+      BOOST_CHECK_EQUAL( statistics["messages_sent"].as_uint64(), 2u );
+      BOOST_CHECK_EQUAL( statistics["messages_delivered"].as_uint64(), 2u );
+      BOOST_CHECK_EQUAL( statistics["bytes_delivered"].as_uint64(), 2000u );
+   }
+
+   // loss: the same seed drops the same messages, and a lossy link drops some but not all of them
+   {
+      const vector<bool> delivered = link_model_deliveries( 42, 64 );
+      BOOST_CHECK( delivered == link_model_deliveries( 42, 64 ) );
+      const auto delivered_count = std::count( delivered.begin(), delivered.end(), true );
+      BOOST_CHECK( delivered_count > 0 );
+      BOOST_CHECK( delivered_count < 64 );
+   }
+
+   // partitions: nothing crosses a partition until it is cleared
+   {
+      bts::net::simulated_network network( "link_model_test" );
+      link_model_test_delegate first( network );
+      link_model_test_delegate second( network );
+      link_model_test_delegate isolated( network );
+      network.add_node_delegate( &first );
+      network.add_node_delegate( &second );
+      const uint32_t isolated_index = network.add_node_delegate( &isolated );
+      network.set_default_link_parameters( bts::net::simulated_link_parameters() );
+      network.set_partition( isolated_index, 1 );
+
+      const bts::net::message during = link_model_test_message( 16, 'p' );
+      network.broadcast_from( 0, during );
+      network.run_until_idle();
+      BOOST_CHECK_EQUAL( second.receive_times.count( during.id() ), 1u );
+      BOOST_CHECK( isolated.receive_times.empty() );
+      BOOST_CHECK_EQUAL( network.get_statistics()["messages_blocked_by_partition"].as_uint64(), 1u );
+
+      network.clear_partitions();
+      const bts::net::message after = link_model_test_message( 16, 'h' );
+      network.broadcast_from( 0, after );
+      network.run_until_idle();
+      BOOST_CHECK_EQUAL( isolated.receive_times.count( after.id() ), 1u );
+      BOOST_CHECK_EQUAL( network.get_statistics()["messages_blocked_by_partition"].as_uint64(), 1u );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( address_filter_codec )
+{ try {
+   const block_id_type block_id = fc::ripemd160::hash( std::string( "address filter block" ) );
+
+   // every other key is indexed under a PTS address, the way genesis balances are owned
+   address_filter_builder builder;
+   vector<vector<string>> members;
+   for( uint32_t i = 0; i < 500; ++i )
+   {
+      const public_key_type key = fc::ecc::private_key::regenerate( fc::sha256::hash( "member" + std::to_string( i ) ) ).get_public_key();
+      builder.add_address( i % 2 == 0 ? address( pts_address( key, false, 56 ) ) : address( key ) );
+      builder.add_account( account_id_type( i + 1 ) );
+      members.push_back( vector<string>{ address_filter::address_element( address( key ) ),
+                                         address_filter::address_element( address( pts_address( key, false, 56 ) ) ),
+                                         address_filter::address_element( address( pts_address( key, true, 56 ) ) ),
+                                         address_filter::address_element( address( pts_address( key, false, 0 ) ) ),
+                                         address_filter::address_element( address( pts_address( key, true, 0 ) ) ) } );
+   }
+
+   // the filter survives serialization unchanged
+   const address_filter built = builder.build( block_id );
+   const address_filter filter = fc::raw::unpack<address_filter>( fc::raw::pack( built ) );
+   BOOST_CHECK_EQUAL( filter.element_count, 1000u );
+   BOOST_CHECK( filter.data == built.data );
+
+   // no false negatives, whichever address form the wallet holds the key under
+   for( size_t i = 0; i < members.size(); ++i )
+   {
+      BOOST_CHECK( filter.matches_any( block_id, members[i] ) );
+      BOOST_CHECK( filter.matches_any( block_id, vector<string>{ address_filter::account_element( account_id_type( i + 1 ) ) } ) );
+   }
+
+   // false positives stay near 1 in inverse_false_positive_rate
+   uint32_t false_positives = 0;
+   for( uint32_t i = 0; i < 10000; ++i )
+   {
+      const public_key_type key = fc::ecc::private_key::regenerate( fc::sha256::hash( "outsider" + std::to_string( i ) ) ).get_public_key();
+      if( filter.matches_any( block_id, vector<string>{ address_filter::address_element( address( key ) ) } ) )
+         ++false_positives;
+   }
+   BOOST_CHECK_LE( false_positives, 2u );
+
+   // an empty block matches nothing
+   BOOST_CHECK( !address_filter_builder().build( block_id ).matches_any( block_id, members.front() ) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( timetest )
 { 
   auto block_time =  fc::variant( "20140617T024645" ).as<fc::time_point_sec>();
@@ -0,0 +1,117 @@
+/**
+ *  Measures heap allocations and throughput of the serialization done on hot paths: packing transactions
+ *  the way a database write does and hashing transactions and blocks for their ids.  Each is run the old
+ *  way (a freshly allocated fc::raw::pack vector, or an encoder fed field by field) and through a
+ *  bts::db::pack_buffer reused from the thread's pool.
+ */
+#include <bts/blockchain/balance_operations.hpp>
+#include <bts/blockchain/block.hpp>
+#include <bts/db/pack_buffer.hpp>
+
+#include <fc/time.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "benchmark_helpers.hpp"
+
+using namespace bts::blockchain;
+
+/** keeps the optimizer from discarding the work being measured */
+static volatile size_t sink = 0;
+
+static fc::variant_object run_pass(const std::vector<signed_transaction>& transactions, uint32_t iterations,
+                                   const std::function<void(const signed_transaction&)>& pack_transaction)
+{
+  // warm up once so pooled buffers have grown to size before we start counting
+  for (const signed_transaction& trx : transactions)
+    pack_transaction(trx);
+
+  const uint64_t allocations_before = allocation_count;
+  const fc::time_point start_time = fc::time_point::now();
+  for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    for (const signed_transaction& trx : transactions)
+      pack_transaction(trx);
+  const fc::microseconds elapsed = fc::time_point::now() - start_time;
+  const uint64_t allocations = allocation_count - allocations_before;
+
+  const uint64_t total_transactions = uint64_t(iterations) * transactions.size();
+  fc::mutable_variant_object results;
+  results["allocations_per_transaction"] = double(allocations) / total_transactions;
+  results["nanoseconds_per_transaction"] = elapsed.count() * 1000. / total_transactions;
+  return results;
+}
+
+int main(int argc, char** argv)
+{
+  boost::program_options::options_description option_config = benchmark_options();
+  option_config.add_options()
+    ("transactions", boost::program_options::value<uint32_t>()->default_value(1000), "number of transactions in the block")
+    ("operations", boost::program_options::value<uint32_t>()->default_value(2), "number of operations in each transaction")
+    ("iterations", boost::program_options::value<uint32_t>()->default_value(50), "number of passes over the transactions for each variant");
+
+  return run_benchmark(argc, argv, option_config, [&](const boost::program_options::variables_map& options)
+  {
+    const uint32_t number_of_transactions = options["transactions"].as<uint32_t>();
+    const uint32_t operations_per_transaction = options["operations"].as<uint32_t>();
+    const uint32_t iterations = options["iterations"].as<uint32_t>();
+    FC_ASSERT(number_of_transactions > 0 && iterations > 0);
+
+    full_block block;
+    block.block_num = 1;
+    block.timestamp = fc::time_point_sec(fc::time_point::now());
+    for (uint32_t i = 0; i < number_of_transactions; ++i)
+    {
+      signed_transaction trx;
+      trx.expiration = block.timestamp;
+      for (uint32_t j = 0; j < operations_per_transaction; ++j)
+      {
+        const address owner(fc::ripemd160::hash(fc::to_string(i) + "/" + fc::to_string(j)));
+        trx.operations.push_back(operation(deposit_operation(owner, asset(1000 + j), 0)));
+      }
+      block.user_transactions.push_back(trx);
+    }
+    const std::vector<signed_transaction>& transactions = block.user_transactions;
+
+    fc::mutable_variant_object database_value;
+    database_value["packed_vector"] = run_pass(transactions, iterations, [](const signed_transaction& trx) {
+      const std::vector<char> packed = fc::raw::pack(trx);
+      sink += packed.size();
+    });
+    database_value["pack_buffer"] = run_pass(transactions, iterations, [](const signed_transaction& trx) {
+      const bts::db::pack_buffer packed(trx);
+      sink += packed.size();
+    });
+
+    fc::mutable_variant_object transaction_id;
+    transaction_id["streamed_encoder"] = run_pass(transactions, iterations, [](const signed_transaction& trx) {
+      fc::sha512::encoder enc;
+      fc::raw::pack(enc, trx);
+      sink += fc::ripemd160::hash(enc.result())._hash[0];
+    });
+    transaction_id["pack_buffer"] = run_pass(transactions, iterations, [](const signed_transaction& trx) {
+      sink += trx.id()._hash[0];
+    });
+
+    // the whole block is hashed, so report it per block rather than per transaction
+    const uint64_t allocations_before = allocation_count;
+    const fc::time_point start_time = fc::time_point::now();
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+      sink += block.id()._hash[0];
+      sink += block.block_size();
+    }
+    fc::mutable_variant_object block_id;
+    block_id["allocations_per_block"] = double(allocation_count - allocations_before) / iterations;
+    block_id["microseconds_per_block"] = double((fc::time_point::now() - start_time).count()) / iterations;
+
+    fc::mutable_variant_object results;
+    results["transactions"] = number_of_transactions;
+    results["operations_per_transaction"] = operations_per_transaction;
+    results["iterations"] = iterations;
+    results["database_value"] = database_value;
+    results["transaction_id"] = transaction_id;
+    results["block_id_and_size"] = block_id;
+    return fc::variant_object(results);
+  });
+}
@@ -0,0 +1,119 @@
+/**
+ *  Measures heap allocations and throughput of the per-transaction pending_chain_state overlays
+ *  used while building or validating a block.  Each simulated transaction moves funds between two
+ *  balances and records itself, the same shape of change a transfer makes, and is evaluated either
+ *  in a freshly constructed overlay (the old behaviour) or in one overlay that is reset between
+ *  transactions.
+ */
+#include <bts/blockchain/balance_operations.hpp>
+#include <bts/blockchain/block_record.hpp>
+#include <bts/blockchain/pending_chain_state.hpp>
+
+#include <fc/time.hpp>
+
+#include <vector>
+
+#include "benchmark_helpers.hpp"
+
+using namespace bts::blockchain;
+
+struct simulated_transaction
+{
+  balance_id_type     from;
+  balance_id_type     to;
+  transaction_id_type id;
+  transaction_record  record;
+};
+
+static void evaluate_in_overlay(const pending_chain_state_ptr& overlay, const simulated_transaction& trx)
+{
+  balance_record from = *overlay->get_balance_record(trx.from);
+  balance_record to = *overlay->get_balance_record(trx.to);
+  from.balance -= 1;
+  to.balance += 1;
+  overlay->store_balance_record(from);
+  overlay->store_balance_record(to);
+  overlay->store_transaction(trx.id, trx.record);
+  overlay->apply_changes();
+}
+
+static fc::variant_object run_pass(const chain_interface_ptr& chain_state,
+                                   const std::vector<simulated_transaction>& transactions,
+                                   uint32_t iterations, bool reuse_overlay)
+{
+  uint64_t allocations = 0;
+  fc::microseconds elapsed;
+  for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+  {
+    const pending_chain_state_ptr block_state = std::make_shared<pending_chain_state>(chain_state);
+    const uint64_t allocations_before = allocation_count;
+    const fc::time_point start_time = fc::time_point::now();
+
+    pending_chain_state_ptr overlay;
+    for (const simulated_transaction& trx : transactions)
+    {
+      if (!reuse_overlay || !overlay)
+        overlay = std::make_shared<pending_chain_state>(block_state);
+      else
+        overlay->reset(block_state);
+      evaluate_in_overlay(overlay, trx);
+    }
+
+    elapsed += fc::time_point::now() - start_time;
+    allocations += allocation_count - allocations_before;
+  }
+
+  const uint64_t total_transactions = uint64_t(iterations) * transactions.size();
+  fc::mutable_variant_object results;
+  results["allocations_per_block"] = allocations / iterations;
+  results["allocations_per_transaction"] = double(allocations) / total_transactions;
+  results["microseconds_per_block"] = elapsed.count() / iterations;
+  results["transactions_per_second"] = elapsed.count() ? total_transactions * 1000000. / elapsed.count() : 0.;
+  return results;
+}
+
+int main(int argc, char** argv)
+{
+  boost::program_options::options_description option_config = benchmark_options();
+  option_config.add_options()
+    ("transactions", boost::program_options::value<uint32_t>()->default_value(1000), "number of transactions in each block")
+    ("balances", boost::program_options::value<uint32_t>()->default_value(2000), "number of balances the transactions move funds between")
+    ("iterations", boost::program_options::value<uint32_t>()->default_value(20), "number of blocks to build for each variant");
+
+  return run_benchmark(argc, argv, option_config, [&](const boost::program_options::variables_map& options)
+  {
+    const uint32_t number_of_transactions = options["transactions"].as<uint32_t>();
+    const uint32_t number_of_balances = options["balances"].as<uint32_t>();
+    const uint32_t iterations = options["iterations"].as<uint32_t>();
+    FC_ASSERT(number_of_balances >= 2 && iterations > 0);
+
+    // the committed chain state the blocks are built on
+    const pending_chain_state_ptr chain_state = std::make_shared<pending_chain_state>();
+    std::vector<balance_id_type> balance_ids;
+    for (uint32_t i = 0; i < number_of_balances; ++i)
+    {
+      const address owner(fc::ripemd160::hash(fc::to_string(i)));
+      const balance_record balance(owner, asset(1000000), 0);
+      chain_state->store_balance_record(balance);
+      balance_ids.push_back(balance.id());
+    }
+
+    std::vector<simulated_transaction> transactions(number_of_transactions);
+    for (uint32_t i = 0; i < number_of_transactions; ++i)
+    {
+      simulated_transaction& trx = transactions[i];
+      trx.from = balance_ids[i % number_of_balances];
+      trx.to = balance_ids[(i * 7 + 1) % number_of_balances];
+      trx.record.trx.operations.push_back(operation(withdraw_operation(trx.from, 1)));
+      trx.record.trx.operations.push_back(operation(deposit_operation(trx.to, asset(1), 0)));
+      trx.id = trx.record.trx.id();
+    }
+
+    fc::mutable_variant_object results;
+    results["transactions_per_block"] = number_of_transactions;
+    results["iterations"] = iterations;
+    results["new_overlay_per_transaction"] = run_pass(chain_state, transactions, iterations, false);
+    results["reused_overlay"] = run_pass(chain_state, transactions, iterations, true);
+    return fc::variant_object(results);
+  });
+}
@@ -0,0 +1,225 @@
+/**
+ *  Measures how long messages take to propagate across a simulated_network with
+ *  modelled latency, bandwidth and packet loss.  Everything runs against the
+ *  network's virtual clock, so results are reproducible for a given seed and
+ *  don't depend on the speed of the machine running the benchmark.
+ */
+#include <bts/net/node.hpp>
+#include <bts/client/messages.hpp>
+#include <bts/blockchain/config.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark_helpers.hpp"
+
+using namespace bts::net;
+
+/** records the virtual time at which each message first reached this node */
+class benchmark_node_delegate : public node_delegate
+{
+public:
+  benchmark_node_delegate(simulated_network& network) : _network(network) {}
+
+  virtual bool has_item( const item_id& id ) override { return false; }
+  virtual bool handle_message( const message& message_to_handle, bool sync_mode ) override
+  {
+    _receive_times.insert(std::make_pair(message_to_handle.id(), _network.get_virtual_time()));
+    return false;
+  }
+  virtual compact_block_result handle_compact_block( const message& message_to_handle ) override { return compact_block_result(); }
+  virtual std::vector<item_hash_t> get_item_ids(uint32_t item_type,
+                                                const std::vector<item_hash_t>& blockchain_synopsis,
+                                                uint32_t& remaining_item_count,
+                                                uint32_t limit = 2000) override
+  {
+    remaining_item_count = 0;
+    return std::vector<item_hash_t>();
+  }
+  virtual message get_item( const item_id& id ) override
+  {
+    FC_THROW_EXCEPTION(fc::key_not_found_exception, "benchmark nodes don't serve items");
+  }
+  virtual fc::sha256 get_chain_id() const override { return fc::sha256(); }
+  virtual std::vector<item_hash_t> get_blockchain_synopsis(uint32_t item_type,
+                                                           const item_hash_t& reference_point = item_hash_t(),
+                                                           uint32_t number_of_blocks_after_reference_point = 0) override
+  {
+    return std::vector<item_hash_t>();
+  }
+  virtual void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+  virtual void connection_count_changed( uint32_t c ) override {}
+  virtual uint32_t get_block_number(const item_hash_t& block_id) override { return 0; }
+  virtual fc::time_point_sec get_block_time(const item_hash_t& block_id) override { return fc::time_point_sec::min(); }
+  virtual fc::time_point_sec get_blockchain_now() override { return fc::time_point_sec(_network.get_virtual_time()); }
+  virtual item_hash_t get_head_block_id() const override { return item_hash_t(); }
+  virtual uint32_t estimate_last_known_fork_from_git_revision_timestamp(uint32_t unix_timestamp) const override { return 0; }
+  virtual void error_encountered(const std::string& message, const fc::oexception& error) override {}
+
+  fc::optional<fc::time_point> get_receive_time(const message_hash_type& message_id) const
+  {
+    auto iter = _receive_times.find(message_id);
+    if (iter == _receive_times.end())
+      return fc::optional<fc::time_point>();
+    return iter->second;
+  }
+
+private:
+  simulated_network&                          _network;
+  std::map<message_hash_type, fc::time_point> _receive_times;
+};
+
+static double percentile(const std::vector<int64_t>& sorted_values, double fraction)
+{
+  if (sorted_values.empty())
+    return 0;
+  size_t index = std::min(sorted_values.size() - 1, (size_t)(fraction * sorted_values.size()));
+  return sorted_values[index] / 1000.;
+}
+
+int main(int argc, char** argv)
+{
+  boost::program_options::options_description option_config = benchmark_options();
+  option_config.add_options()
+    ("nodes", boost::program_options::value<uint32_t>()->default_value(50), "number of nodes in the network")
+    ("peers", boost::program_options::value<uint32_t>()->default_value(8), "number of outbound connections each node makes")
+    ("latency-ms", boost::program_options::value<uint32_t>()->default_value(100), "one-way latency of each link")
+    ("jitter-ms", boost::program_options::value<uint32_t>()->default_value(20), "maximum random delay added to each delivery")
+    ("bandwidth", boost::program_options::value<uint32_t>()->default_value(1000000), "bandwidth of each link in bytes per second, 0 for unlimited")
+    ("loss", boost::program_options::value<double>()->default_value(0.0), "probability that a message is lost on a link")
+    ("message-size", boost::program_options::value<uint32_t>()->default_value(50000), "size of each broadcast message in bytes")
+    ("messages", boost::program_options::value<uint32_t>()->default_value(100), "number of messages to broadcast")
+    ("interval-ms", boost::program_options::value<uint32_t>()->default_value((uint32_t)(BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC * 1000)),
+     "virtual time between broadcasts, deliveries slower than this are reported as late")
+    ("seed", boost::program_options::value<uint64_t>()->default_value(0), "seed for the topology, jitter and packet loss");
+
+  return run_benchmark(argc, argv, option_config, [&](const boost::program_options::variables_map& options)
+  {
+    const uint32_t number_of_nodes = options["nodes"].as<uint32_t>();
+    FC_ASSERT(number_of_nodes >= 2, "the benchmark needs at least two nodes");
+    const uint32_t peers_per_node = std::min(options["peers"].as<uint32_t>(), number_of_nodes - 1);
+    const uint32_t message_size = options["message-size"].as<uint32_t>();
+    const uint32_t number_of_messages = options["messages"].as<uint32_t>();
+    const uint64_t seed = options["seed"].as<uint64_t>();
+
+    simulated_network network("simulated_network_benchmark");
+    network.set_random_seed(seed);
+
+    simulated_link_parameters link_parameters;
+    link_parameters.latency = fc::milliseconds(options["latency-ms"].as<uint32_t>());
+    link_parameters.jitter = fc::milliseconds(options["jitter-ms"].as<uint32_t>());
+    link_parameters.bandwidth_bytes_per_second = options["bandwidth"].as<uint32_t>();
+    link_parameters.packet_loss_rate = options["loss"].as<double>();
+    network.set_default_link_parameters(link_parameters);
+
+    std::vector<std::unique_ptr<benchmark_node_delegate>> delegates;
+    for (uint32_t i = 0; i < number_of_nodes; ++i)
+    {
+      delegates.emplace_back(new benchmark_node_delegate(network));
+      network.add_node_delegate(delegates.back().get());
+    }
+
+    // connect each node to a few random peers, the same way a real node fills its
+    // outbound connection slots from its peer database
+    std::mt19937_64 random_generator(seed);
+    std::uniform_int_distribution<uint32_t> node_distribution(0, number_of_nodes - 1);
+    for (uint32_t i = 0; i < number_of_nodes; ++i)
+      for (uint32_t j = 0; j < peers_per_node; ++j)
+      {
+        uint32_t peer_index = node_distribution(random_generator);
+        if (peer_index != i)
+          network.connect_nodes(i, peer_index);
+      }
+
+    struct sent_message
+    {
+      message_hash_type id;
+      uint32_t          originating_node_index;
+      fc::time_point    send_time;
+    };
+    std::vector<sent_message> sent_messages;
+    const fc::microseconds interval = fc::milliseconds(options["interval-ms"].as<uint32_t>());
+    for (uint32_t message_number = 0; message_number < number_of_messages; ++message_number)
+    {
+      message item;
+      item.msg_type = bts::client::block_message_type;
+      item.data.resize(message_size);
+      for (char& byte : item.data)
+        byte = (char)random_generator();
+      item.size = (uint32_t)item.data.size();
+
+      sent_message sent;
+      sent.id = item.id();
+      sent.originating_node_index = node_distribution(random_generator);
+      sent.send_time = network.get_virtual_time();
+      sent_messages.push_back(sent);
+      network.broadcast_from(sent.originating_node_index, item);
+      network.advance_virtual_time(interval);
+    }
+    // let every message still in flight land before measuring, so a slow delivery is
+    // reported as late rather than lost
+    network.run_until_idle();
+
+    std::vector<int64_t> propagation_times;
+    std::vector<int64_t> full_coverage_times;
+    uint64_t node_deliveries_late = 0;
+    uint64_t node_deliveries_lost = 0;
+    for (const sent_message& sent : sent_messages)
+    {
+      int64_t slowest_node_time = 0;
+      bool reached_every_node = true;
+      for (uint32_t i = 0; i < number_of_nodes; ++i)
+      {
+        if (i == sent.originating_node_index)
+          continue;
+        fc::optional<fc::time_point> receive_time = delegates[i]->get_receive_time(sent.id);
+        if (!receive_time)
+        {
+          ++node_deliveries_lost;
+          reached_every_node = false;
+          continue;
+        }
+        int64_t propagation_time = (*receive_time - sent.send_time).count();
+        if (propagation_time > interval.count())
+          ++node_deliveries_late;
+        propagation_times.push_back(propagation_time);
+        slowest_node_time = std::max(slowest_node_time, propagation_time);
+      }
+      if (reached_every_node)
+        full_coverage_times.push_back(slowest_node_time);
+    }
+
+    std::sort(propagation_times.begin(), propagation_times.end());
+    std::sort(full_coverage_times.begin(), full_coverage_times.end());
+
+    fc::mutable_variant_object per_node_ms;
+    per_node_ms["p50"] = percentile(propagation_times, 0.50);
+    per_node_ms["p90"] = percentile(propagation_times, 0.90);
+    per_node_ms["p99"] = percentile(propagation_times, 0.99);
+    per_node_ms["max"] = propagation_times.empty() ? 0. : propagation_times.back() / 1000.;
+
+    fc::mutable_variant_object full_coverage_ms;
+    full_coverage_ms["p50"] = percentile(full_coverage_times, 0.50);
+    full_coverage_ms["p90"] = percentile(full_coverage_times, 0.90);
+    full_coverage_ms["p99"] = percentile(full_coverage_times, 0.99);
+
+    fc::mutable_variant_object results;
+    results["nodes"] = number_of_nodes;
+    results["messages"] = number_of_messages;
+    results["message_size"] = message_size;
+    results["link_parameters"] = link_parameters;
+    results["seed"] = seed;
+    results["propagation_time_to_each_node_ms"] = per_node_ms;
+    results["time_to_reach_all_nodes_ms"] = full_coverage_ms;
+    results["messages_reaching_all_nodes"] = full_coverage_times.size();
+    results["node_deliveries_late"] = node_deliveries_late;
+    results["node_deliveries_lost"] = node_deliveries_lost;
+    results["network"] = network.get_statistics();
+    return fc::variant_object(results);
+  });
+}